@@ -1,11 +1,33 @@
 #include <x86.h>
 #include <trap.h>
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <error.h>
 #include <picirq.h>
+#include <lapic.h>
+#include <sched.h>
+#include <proc.h>
+#include <smp.h>
+#include <pmm.h>
+#include <time.h>
+#include <sig.h>
+#include <clock.h>
 
 /* *
  * Support for time-related hardware gadgets - the 8253 timer,
  * which generates interruptes on IRQ-0.
+ *
+ * Where there is a local APIC its timer takes the place of the 8253, in
+ * one-shot mode: clock_program arms it for the next event of the cpu, the
+ * next tick of the scheduler while the cpu has a process to run, and on
+ * cpu 0 the next timer of the timer wheel. An idle cpu does not tick, it
+ * halts until its next timer or an interrupt. The time itself comes from
+ * the TSC, in units of 1/TIMER_HZ second.
+ *
+ * The TSC, calibrated against the 8253, is also the clock of clock_gettime,
+ * in nanoseconds since boot, and the CMOS RTC read at boot gives the time of
+ * day. The scale goes to the time page, which every process maps read-only.
  * */
 
 #define IO_TIMER1           0x040               // 8253 Timer #1
@@ -23,27 +45,314 @@
 #define TIMER_RATEGEN   0x04                    // mode 2, rate generator
 #define TIMER_16BIT     0x30                    // r/w counter 16 bits, LSB first
 
+// channel 2 counts the calibration window, its gate is in the speaker port
+#define IO_TIMER_CH2    (IO_TIMER1 + 2)
+#define TIMER_SEL2      0x80                    // select counter 2
+#define TIMER_ONESHOT   0x00                    // mode 0, interrupt on terminal count
+#define TIMER_GATE      0x061                   // bit 0: channel 2 gate, bit 5: channel 2 output
+
+#define IO_RTC          0x070                   // CMOS RTC: the index port, then the data port
+#define RTC_SEC         0x00
+#define RTC_MIN         0x02
+#define RTC_HOUR        0x04
+#define RTC_DAY         0x07
+#define RTC_MON         0x08
+#define RTC_YEAR        0x09
+#define RTC_STATUSA     0x0A
+#define RTC_UIP         0x80                    //   update in progress
+#define RTC_STATUSB     0x0B
+#define RTC_24H         0x02                    //   24 hour clock, else 12 with bit 7 for pm
+#define RTC_BINARY      0x04                    //   binary, else BCD
+#define RTC_CENTURY     0x32
+
+#define CPUID_TSC       (1 << 4)                // cpuid(1).edx: time-stamp counter
+
+#define TIMEPAGE_STUB   0x800                   // where the SYSENTER stub goes in the time page
+#define TIMEPAGE_SIGRET 0xC00                   // and the trampoline signal handlers return to
+
+// is tick a before tick b? they may wrap around
+#define clock_before(a, b)          ((int)((a) - (b)) < 0)
+
 volatile size_t ticks;
 
+// the local APIC timer runs one-shot, and clock_units reads the TSC
+static bool tickless = 0;
+static uint64_t tsc_base;
+static uint32_t tsc_per_unit;
+static uint32_t tsc_khz;
+// the unit at which ticks was last counted
+static unsigned int tick_base;
+
+// the time page, its tsc_base is the tsc_base above
+static struct Page *timepage_page;
+static struct timepage *timepage;
+
+// the unit of the next tick of each cpu, and of the event its timer is armed for
+static unsigned int next_tick[NCPU];
+static unsigned int next_event[NCPU];
+static bool event_armed[NCPU];
+
 long SYSTEM_READ_TIMER( void ){
     return ticks;
 }
 
+// pit_window_start - let channel 2 of the 8253 count down CALIBRATE_MSEC
+void
+pit_window_start(void) {
+    uint32_t count = TIMER_FREQ / (1000 / CALIBRATE_MSEC);
+    outb(TIMER_GATE, (inb(TIMER_GATE) & ~0x02) | 0x01);             // gate on, speaker off
+    outb(TIMER_MODE, TIMER_SEL2 | TIMER_ONESHOT | TIMER_16BIT);
+    outb(IO_TIMER_CH2, count & 0xFF);
+    outb(IO_TIMER_CH2, count >> 8);
+}
+
+// pit_window_over - mode 0 raises the output when the count reaches 0
+bool
+pit_window_over(void) {
+    return (inb(TIMER_GATE) & 0x20) != 0;
+}
+
+// tsc_calibrate - the TSC cycles in CALIBRATE_MSEC
+static uint32_t
+tsc_calibrate(void) {
+    uint64_t start;
+    pit_window_start();
+    start = rdtsc();
+    while (!pit_window_over()) {
+        /* do nothing */;
+    }
+    return (uint32_t)(rdtsc() - start);
+}
+
+static uint32_t
+rtc_read(int reg) {
+    outb(IO_RTC, reg);
+    return inb(IO_RTC + 1);
+}
+
+// rtc_mktime - seconds since 1970-01-01 00:00:00, years start in March so February comes last
+static uint32_t
+rtc_mktime(uint32_t year, uint32_t mon, uint32_t day, uint32_t hour, uint32_t min, uint32_t sec) {
+    if (mon <= 2) {
+        year --, mon += 12;
+    }
+    uint32_t days = year * 365 + year / 4 - year / 100 + year / 400 + (153 * (mon - 3) + 2) / 5 + day - 719469;
+    return ((days * 24 + hour) * 60 + min) * 60 + sec;
+}
+
+// rtc_time - the time of day in the CMOS RTC, read again if it changed meanwhile
+static uint32_t
+rtc_time(void) {
+    uint32_t t[7], last[7], status;
+    int i, regs[7] = {RTC_SEC, RTC_MIN, RTC_HOUR, RTC_DAY, RTC_MON, RTC_YEAR, RTC_CENTURY};
+    memset(t, 0xFF, sizeof(t));
+    do {
+        for (i = 0; i < 7; i ++) {
+            last[i] = t[i];
+        }
+        while (rtc_read(RTC_STATUSA) & RTC_UIP) {
+            /* do nothing */;
+        }
+        for (i = 0; i < 7; i ++) {
+            t[i] = rtc_read(regs[i]);
+        }
+    } while (memcmp(t, last, sizeof(t)) != 0);
+
+    status = rtc_read(RTC_STATUSB);
+    bool pm = !(status & RTC_24H) && (t[2] & 0x80);
+    t[2] &= 0x7F;
+    if (!(status & RTC_BINARY)) {
+        for (i = 0; i < 7; i ++) {
+            t[i] = (t[i] >> 4) * 10 + (t[i] & 0xF);
+        }
+    }
+    if (!(status & RTC_24H) && pm != (t[2] == 12)) {
+        t[2] = (t[2] + 12) % 24;
+    }
+    // the century register is not in every RTC
+    t[5] += (t[6] >= 19 && t[6] <= 21) ? t[6] * 100 : 2000;
+    return rtc_mktime(t[5], t[4], t[3], t[2], t[1], t[0]);
+}
+
+// timepage_init - the TSC scale and the time of day for clock_gettime, in the time page
+static void
+timepage_init(void) {
+    if ((timepage_page = alloc_page()) == NULL) {
+        panic("clock: no memory for the time page.\n");
+    }
+    // the kernel holds it for good, and fork shares it as it shares the text
+    set_page_ref(timepage_page, 1);
+    SetPageText(timepage_page);
+    timepage = page2kva(timepage_page);
+    memset(timepage, 0, PGSIZE);
+
+    timepage->realtime_sec = rtc_time();
+    timepage->tsc_base = tsc_base;
+    if (tsc_khz != 0) {
+        // the most precise mult that fits in 32 bits: mult = 10^6 << shift / tsc_khz
+        uint32_t shift = 32;
+        uint64_t mult;
+        do {
+            mult = (uint64_t)1000000 << shift;
+            do_div(mult, tsc_khz);
+        } while ((mult >> 32) != 0 && -- shift > 0);
+        timepage->mult = (uint32_t)mult, timepage->shift = shift;
+    }
+    timepage->sysenter = sysenter_install((void *)timepage + TIMEPAGE_STUB, TIMEPAGE_VA + TIMEPAGE_STUB);
+    signal_install((void *)timepage + TIMEPAGE_SIGRET, TIMEPAGE_VA + TIMEPAGE_SIGRET);
+}
+
 /* *
- * clock_init - initialize 8253 clock to interrupt 100 times per second,
- * and then enable IRQ_TIMER.
+ * clock_init - initialize the local APIC timer for one-shot events with
+ * CONFIG_TICKLESS or CONFIG_SMP, or else the 8253 clock to interrupt HZ times
+ * per second, and then enable IRQ_TIMER.
  * */
 void
 clock_init(void) {
-    // set 8253 timer-chip
-    outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
-    outb(IO_TIMER1, TIMER_DIV(100) % 256);
-    outb(IO_TIMER1, TIMER_DIV(100) / 256);
-
     // initialize time counter 'ticks' to zero
     ticks = 0;
 
+    uint32_t edx;
+    cpuid(1, NULL, NULL, NULL, &edx);
+    if (edx & CPUID_TSC) {
+        uint32_t cycles = tsc_calibrate();
+        tsc_khz = cycles / CALIBRATE_MSEC;
+        tsc_per_unit = cycles / (TIMER_HZ * CALIBRATE_MSEC / 1000);
+    }
+    tsc_base = rdtsc();
+    timepage_init();
+
+#if defined(CONFIG_TICKLESS) || defined(CONFIG_SMP)
+    // smp_init turned on the local APIC of each cpu, or find the one of this cpu
+    lapic_detect();
+    if (lapic != NULL && tsc_per_unit != 0) {
+        lapic_timer_init();
+        tick_base = 0;
+        tickless = 1;
+        // the tick starts when the idle thread schedules a process, see schedule
+        cprintf("++ setup timer interrupts, tickless, %d MHz tsc\n", tsc_per_unit / (1000000 / TIMER_HZ));
+        return ;
+    }
+#endif
+
+    // set 8253 timer-chip
+    outb(TIMER_MODE, TIMER_SEL0 | TIMER_RATEGEN | TIMER_16BIT);
+    outb(IO_TIMER1, TIMER_DIV(HZ) % 256);
+    outb(IO_TIMER1, TIMER_DIV(HZ) / 256);
+
     cprintf("++ setup timer interrupts\n");
     pic_enable(IRQ_TIMER);
 }
 
+// clock_timepage - the page to map read-only at TIMEPAGE_VA in a process
+struct Page *
+clock_timepage(void) {
+    return timepage_page;
+}
+
+// do_clock_gettime - the time of clock clockid, from the TSC, or from the ticks without one
+int
+do_clock_gettime(int clockid, struct timespec *ts) {
+    if (timepage->mult != 0) {
+        return timepage_gettime(timepage, rdtsc(), clockid, ts);
+    }
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC) {
+        return -E_INVAL;
+    }
+    size_t now = ticks;
+    ts->tv_sec = now / HZ;
+    ts->tv_nsec = now % HZ * (NSEC_PER_SEC / HZ);
+    if (clockid == CLOCK_REALTIME) {
+        ts->tv_sec += timepage->realtime_sec;
+    }
+    return 0;
+}
+
+// clock_units - the time since clock_init in units of 1/TIMER_HZ second, it wraps around
+unsigned int
+clock_units(void) {
+    if (!tickless) {
+        return ticks * TICK_UNITS;
+    }
+    uint64_t tsc = rdtsc() - tsc_base;
+    do_div(tsc, tsc_per_unit);
+    return (unsigned int)tsc;
+}
+
+// clock_tick - called at each timer interrupt, is a tick of the scheduler due on this cpu?
+bool
+clock_tick(void) {
+    if (!tickless) {
+        if (cpunum() == 0) {
+            ticks ++;
+        }
+        return 1;
+    }
+    int id = cpunum();
+    unsigned int now = clock_units(), n;
+    // the ticks of the time all the cpus were idle
+    if (!clock_before(now, tick_base) && (n = (now - tick_base) / TICK_UNITS) != 0) {
+        ticks += n;
+        tick_base += n * TICK_UNITS;
+    }
+    if (clock_before(now, next_tick[id])) {
+        return 0;
+    }
+    next_tick[id] += TICK_UNITS;
+    if (clock_before(next_tick[id], now)) {
+        next_tick[id] = now + TICK_UNITS;
+    }
+    return 1;
+}
+
+// clock_program - arm the timer of this cpu for its next event; busy: it has a process to tick
+void
+clock_program(bool busy) {
+    if (!tickless) {
+        return ;
+    }
+    int id = cpunum();
+    unsigned int now = clock_units(), expires, next = 0;
+    bool armed = 0;
+    if (busy) {
+        next = next_tick[id], armed = 1;
+    }
+    if (id == 0 && timer_next_event(&expires)) {
+        if (!armed || clock_before(expires, next)) {
+            next = expires, armed = 1;
+        }
+    }
+    next_event[id] = next, event_armed[id] = armed;
+    if (!armed) {
+        lapic_timer_stop();
+    }
+    else {
+        lapic_timer_arm(clock_before(now, next) ? next - now : 1);
+    }
+}
+
+// clock_resume - an idle cpu, which does not tick, has a process to run now
+void
+clock_resume(void) {
+    if (tickless) {
+        next_tick[cpunum()] = clock_units() + TICK_UNITS;
+        clock_program(1);
+    }
+}
+
+// clock_timer_added - a timer expiring at expires was added, make cpu 0 wake up for it in time
+void
+clock_timer_added(unsigned int expires) {
+    if (!tickless || (event_armed[0] && !clock_before(expires, next_event[0]))) {
+        return ;
+    }
+    if (cpunum() == 0) {
+        clock_program(current != idleproc);
+    }
+#ifdef CONFIG_SMP
+    else {
+        lapic_ipi(cpus[0].apicid, IRQ_OFFSET + IRQ_IPI_TIMER);
+    }
+#endif
+}
+
@@ -3,9 +3,33 @@
 
 #include <defs.h>
 
+// the scheduler ticks HZ times per second on a cpu with a process to run, e.g. make HZ=250
+#ifndef HZ
+#define HZ                  100
+#endif
+
+// the timers count in units of 1/TIMER_HZ second
+#define TIMER_HZ            10000
+#define TICK_UNITS          (TIMER_HZ / HZ)
+
+// the length of the window channel 2 of the 8253 gives to calibrate the other clocks
+#define CALIBRATE_MSEC      10
+
 extern volatile size_t ticks;
 
+struct Page;
+struct timespec;
+
 void clock_init(void);
+unsigned int clock_units(void);
+bool clock_tick(void);
+void clock_program(bool busy);
+void clock_resume(void);
+void clock_timer_added(unsigned int expires);
+struct Page *clock_timepage(void);
+int do_clock_gettime(int clockid, struct timespec *ts);
+void pit_window_start(void);
+bool pit_window_over(void);
 
 long SYSTEM_READ_TIMER( void );
 
@@ -0,0 +1,63 @@
+#include <defs.h>
+#include <stdio.h>
+#include <trap.h>
+#include <ioapic.h>
+
+/* *
+ * The I/O APIC delivers the device interrupts to the local APICs, in place
+ * of the 8259A when there are several cpus. See the 82093AA datasheet.
+ * */
+
+#define IOAPIC_REG_ID       0x00        // register index: ID
+#define IOAPIC_REG_VER      0x01        // register index: version
+#define IOAPIC_REG_TABLE    0x10        // redirection table base
+
+// the redirection table starts at IOAPIC_REG_TABLE and uses two registers
+// for each interrupt: the low one has the vector and the flags below, the
+// high one the local APIC id of the cpu that gets the interrupt
+#define IOAPIC_INT_DISABLED 0x00010000  // interrupt disabled
+
+// the registers are reached through an index (reg) and a data window (data)
+struct ioapic {
+    uint32_t reg;
+    uint32_t pad[3];
+    uint32_t data;
+};
+
+volatile struct ioapic *ioapic = NULL;
+
+static uint32_t
+ioapic_read(int reg) {
+    ioapic->reg = reg;
+    return ioapic->data;
+}
+
+static void
+ioapic_write(int reg, uint32_t data) {
+    ioapic->reg = reg;
+    ioapic->data = data;
+}
+
+// ioapic_init - mask every interrupt, pic_enable unmasks them one at a time
+void
+ioapic_init(volatile struct ioapic *regs, uint8_t id) {
+    int i, maxintr;
+    ioapic = regs;
+    maxintr = (ioapic_read(IOAPIC_REG_VER) >> 16) & 0xFF;
+    if (((ioapic_read(IOAPIC_REG_ID) >> 24) & 0x0F) != id) {
+        cprintf("ioapic: id isn't equal to ioapicid; not a MP.\n");
+    }
+    // edge triggered, active high, disabled, and not routed to any cpu
+    for (i = 0; i <= maxintr; i ++) {
+        ioapic_write(IOAPIC_REG_TABLE + 2 * i, IOAPIC_INT_DISABLED | (IRQ_OFFSET + i));
+        ioapic_write(IOAPIC_REG_TABLE + 2 * i + 1, 0);
+    }
+}
+
+// ioapic_enable - deliver irq to the cpu with local APIC id apicid, edge triggered and active high
+void
+ioapic_enable(int irq, uint8_t apicid) {
+    ioapic_write(IOAPIC_REG_TABLE + 2 * irq, IRQ_OFFSET + irq);
+    ioapic_write(IOAPIC_REG_TABLE + 2 * irq + 1, apicid << 24);
+}
+
@@ -0,0 +1,15 @@
+#ifndef __KERN_DRIVER_IOAPIC_H__
+#define __KERN_DRIVER_IOAPIC_H__
+
+#include <defs.h>
+
+struct ioapic;
+
+// the registers of the I/O APIC, NULL while the 8259A is used
+extern volatile struct ioapic *ioapic;
+
+void ioapic_init(volatile struct ioapic *regs, uint8_t id);
+void ioapic_enable(int irq, uint8_t apicid);
+
+#endif /* !__KERN_DRIVER_IOAPIC_H__ */
+
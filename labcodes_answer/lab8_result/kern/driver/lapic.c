@@ -0,0 +1,226 @@
+#include <defs.h>
+#include <x86.h>
+#include <trap.h>
+#include <memlayout.h>
+#include <pmm.h>
+#include <clock.h>
+#include <lapic.h>
+#include <ioapic.h>
+#include <smp.h>
+
+/* *
+ * The local APIC of each cpu: its timer, the interrupts from the other cpus
+ * (IPIs) and the INIT-SIPI sequence that starts an AP. The registers are
+ * memory mapped, smp_init or lapic_detect maps them and sets lapic. See the
+ * Intel SDM volume 3, chapter 10.
+ * */
+
+// the registers, divided by 4 for use as indices of lapic[]
+#define LAPIC_ID            (0x0020 / 4)        // ID
+#define LAPIC_VER           (0x0030 / 4)        // version
+#define LAPIC_TPR           (0x0080 / 4)        // task priority
+#define LAPIC_EOI           (0x00B0 / 4)        // end of interrupt
+#define LAPIC_SVR           (0x00F0 / 4)        // spurious interrupt vector
+#define LAPIC_ENABLE        0x00000100          //   unit enable
+#define LAPIC_ESR           (0x0280 / 4)        // error status
+#define LAPIC_ICRLO         (0x0300 / 4)        // interrupt command
+#define LAPIC_INIT          0x00000500          //   INIT/RESET
+#define LAPIC_STARTUP       0x00000600          //   startup IPI
+#define LAPIC_DELIVS        0x00001000          //   delivery status
+#define LAPIC_ASSERT        0x00004000          //   assert interrupt (vs deassert)
+#define LAPIC_LEVEL         0x00008000          //   level triggered
+#define LAPIC_BCAST         0x00080000          //   send to all APICs, including self
+#define LAPIC_EXTINT        0x00000700          //   deliver the interrupts of the 8259A
+#define LAPIC_ICRHI         (0x0310 / 4)        // interrupt command [63:32]
+#define LAPIC_TIMER         (0x0320 / 4)        // local vector table 0 (TIMER)
+#define LAPIC_X1            0x0000000B          //   divide counts by 1
+#define LAPIC_PCINT         (0x0340 / 4)        // performance counter LVT
+#define LAPIC_LINT0         (0x0350 / 4)        // local vector table 1 (LINT0)
+#define LAPIC_LINT1         (0x0360 / 4)        // local vector table 2 (LINT1)
+#define LAPIC_ERROR         (0x0370 / 4)        // local vector table 3 (ERROR)
+#define LAPIC_MASKED        0x00010000          //   interrupt masked
+#define LAPIC_TICR          (0x0380 / 4)        // timer initial count
+#define LAPIC_TCCR          (0x0390 / 4)        // timer current count
+#define LAPIC_TDCR          (0x03E0 / 4)        // timer divide configuration
+
+#define MSR_APIC_BASE       0x1B                // physical address of the registers
+#define CPUID_APIC          (1 << 9)            // cpuid(1).edx: local APIC
+
+#define CMOS_PORT           0x70
+#define CMOS_RETURN         0x71
+
+volatile uint32_t *lapic = NULL;
+
+// lapic timer counts in a unit of the timers (1/TIMER_HZ second), measured once by the boot cpu
+static uint32_t lapic_timer_count = 0;
+
+static void
+lapicw(int index, uint32_t value) {
+    lapic[index] = value;
+    lapic[LAPIC_ID];                // wait for the write to finish, by reading
+}
+
+// lapic_delay - wait about usec microseconds, a write to port 0x80 takes one
+static void
+lapic_delay(int usec) {
+    while (usec -- > 0) {
+        outb(0x80, 0);
+    }
+}
+
+// lapic_init - set up the local APIC of this cpu, the timer is left to lapic_timer_init
+void
+lapic_init(void) {
+    if (lapic == NULL) {
+        return ;
+    }
+
+    // enable the local APIC, and set the spurious interrupt vector
+    lapicw(LAPIC_SVR, LAPIC_ENABLE | (IRQ_OFFSET + IRQ_SPURIOUS));
+    lapicw(LAPIC_TIMER, LAPIC_MASKED);
+
+    // without an I/O APIC the interrupts of the 8259A still come in through LINT0
+    lapicw(LAPIC_LINT0, (ioapic == NULL && cpunum() == 0) ? LAPIC_EXTINT : LAPIC_MASKED);
+    lapicw(LAPIC_LINT1, LAPIC_MASKED);
+
+    // disable performance counter overflow interrupts, where there is such an entry
+    if (((lapic[LAPIC_VER] >> 16) & 0xFF) >= 4) {
+        lapicw(LAPIC_PCINT, LAPIC_MASKED);
+    }
+
+    // map error interrupts to IRQ_ERROR, and clear the error status (two writes)
+    lapicw(LAPIC_ERROR, IRQ_OFFSET + IRQ_ERROR);
+    lapicw(LAPIC_ESR, 0);
+    lapicw(LAPIC_ESR, 0);
+
+    // ack any outstanding interrupts
+    lapicw(LAPIC_EOI, 0);
+
+    // send an INIT level de-assert to synchronise the arbitration ids
+    lapicw(LAPIC_ICRHI, 0);
+    lapicw(LAPIC_ICRLO, LAPIC_BCAST | LAPIC_INIT | LAPIC_LEVEL);
+    while (lapic[LAPIC_ICRLO] & LAPIC_DELIVS) {
+        /* do nothing */;
+    }
+
+    // accept all interrupts
+    lapicw(LAPIC_TPR, 0);
+}
+
+/* *
+ * lapic_detect - find the local APIC of a cpu without an MP configuration
+ * table, through CPUID and its base MSR, and turn it on for its timer.
+ * */
+void
+lapic_detect(void) {
+    uint32_t edx;
+    cpuid(1, NULL, NULL, NULL, &edx);
+    if (lapic != NULL || !(edx & CPUID_APIC)) {
+        return ;
+    }
+    lapic = mmio_map(rdmsr(MSR_APIC_BASE) & ~(PGSIZE - 1), PGSIZE);
+    lapic_init();
+}
+
+// lapic_calibrate - count the timer down while channel 2 of the 8253 counts CALIBRATE_MSEC
+static uint32_t
+lapic_calibrate(void) {
+    lapicw(LAPIC_TDCR, LAPIC_X1);
+    pit_window_start();
+    lapicw(LAPIC_TICR, 0xFFFFFFFF);
+    while (!pit_window_over()) {
+        /* do nothing */;
+    }
+    uint32_t count = 0xFFFFFFFF - lapic[LAPIC_TCCR];
+    lapicw(LAPIC_TICR, 0);
+    return count / (TIMER_HZ * CALIBRATE_MSEC / 1000);
+}
+
+// lapic_timer_init - set the timer of this cpu to interrupt with IRQ_TIMER once, when armed
+void
+lapic_timer_init(void) {
+    if (lapic == NULL) {
+        return ;
+    }
+    if (lapic_timer_count == 0) {
+        lapic_timer_count = lapic_calibrate();
+    }
+    lapicw(LAPIC_TDCR, LAPIC_X1);
+    lapicw(LAPIC_TIMER, IRQ_OFFSET + IRQ_TIMER);
+    lapicw(LAPIC_TICR, 0);
+}
+
+// lapic_timer_arm - interrupt this cpu after units (1/TIMER_HZ second), or sooner when that is too far
+void
+lapic_timer_arm(uint32_t units) {
+    if (units == 0) {
+        units = 1;
+    }
+    if (units > 0xFFFFFFFF / lapic_timer_count) {
+        units = 0xFFFFFFFF / lapic_timer_count;
+    }
+    lapicw(LAPIC_TICR, units * lapic_timer_count);
+}
+
+// lapic_timer_stop - disarm the timer of this cpu
+void
+lapic_timer_stop(void) {
+    lapicw(LAPIC_TICR, 0);
+}
+
+int
+lapic_id(void) {
+    return (lapic != NULL) ? (lapic[LAPIC_ID] >> 24) : 0;
+}
+
+// lapic_eoi - acknowledge the interrupt being handled
+void
+lapic_eoi(void) {
+    if (lapic != NULL) {
+        lapicw(LAPIC_EOI, 0);
+    }
+}
+
+/* *
+ * lapic_startap - start the AP with local APIC id apicid at the real mode
+ * code at addr, which must be page aligned and below 1M: the universal
+ * startup algorithm of the MultiProcessor Specification, appendix B.4.
+ * */
+void
+lapic_startap(uint8_t apicid, uintptr_t addr) {
+    int i;
+    uint16_t *wrv;
+
+    // the BSP must set the CMOS shutdown code to 0AH and the warm reset
+    // vector (DWORD based at 40:67) to point at the AP startup code
+    outb(CMOS_PORT, 0xF);
+    outb(CMOS_RETURN, 0x0A);
+    wrv = (uint16_t *)(KERNBASE + ((0x40 << 4) | 0x67));
+    wrv[0] = 0;
+    wrv[1] = addr >> 4;
+
+    // an INIT interrupt resets the AP
+    lapicw(LAPIC_ICRHI, apicid << 24);
+    lapicw(LAPIC_ICRLO, LAPIC_INIT | LAPIC_LEVEL | LAPIC_ASSERT);
+    lapic_delay(200);
+    lapicw(LAPIC_ICRLO, LAPIC_INIT | LAPIC_LEVEL);
+    lapic_delay(100);
+
+    // then two startup IPIs make it run at addr, the second one in case the first was lost
+    for (i = 0; i < 2; i ++) {
+        lapicw(LAPIC_ICRHI, apicid << 24);
+        lapicw(LAPIC_ICRLO, LAPIC_STARTUP | (addr >> 12));
+        lapic_delay(200);
+    }
+}
+
+// lapic_ipi - interrupt the cpu with local APIC id apicid with vector
+void
+lapic_ipi(uint8_t apicid, int vector) {
+    lapicw(LAPIC_ICRHI, apicid << 24);
+    lapicw(LAPIC_ICRLO, vector);
+    while (lapic[LAPIC_ICRLO] & LAPIC_DELIVS) {
+        /* do nothing */;
+    }
+}
+
@@ -0,0 +1,20 @@
+#ifndef __KERN_DRIVER_LAPIC_H__
+#define __KERN_DRIVER_LAPIC_H__
+
+#include <defs.h>
+
+// the registers of the local APIC of each cpu, NULL while the 8259A and 8253 are used
+extern volatile uint32_t *lapic;
+
+void lapic_init(void);
+void lapic_detect(void);
+void lapic_timer_init(void);
+void lapic_timer_arm(uint32_t units);
+void lapic_timer_stop(void);
+int lapic_id(void);
+void lapic_eoi(void);
+void lapic_startap(uint8_t apicid, uintptr_t addr);
+void lapic_ipi(uint8_t apicid, int vector);
+
+#endif /* !__KERN_DRIVER_LAPIC_H__ */
+
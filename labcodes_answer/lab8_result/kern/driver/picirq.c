@@ -1,6 +1,8 @@
 #include <defs.h>
 #include <x86.h>
 #include <picirq.h>
+#include <lapic.h>
+#include <ioapic.h>
 
 // I/O Addresses of the two programmable interrupt controllers
 #define IO_PIC1             0x20    // Master (IRQs 0-7)
@@ -24,6 +26,11 @@ pic_setmask(uint16_t mask) {
 
 void
 pic_enable(unsigned int irq) {
+    // with an I/O APIC, the 8259A stays masked and the boot cpu gets the irq from the I/O APIC
+    if (ioapic != NULL) {
+        ioapic_enable(irq, lapic_id());
+        return ;
+    }
     pic_setmask(irq_mask & ~(1 << irq));
 }
 
@@ -32,6 +39,17 @@ void
 pic_init(void) {
     did_init = 1;
 
+    // the irqs enabled before smp_init found an I/O APIC move to it
+    if (ioapic != NULL) {
+        int irq;
+        for (irq = 0; irq < 16; irq ++) {
+            if (irq != IRQ_SLAVE && !(irq_mask & (1 << irq))) {
+                ioapic_enable(irq, lapic_id());
+            }
+        }
+        irq_mask = 0xFFFF;
+    }
+
     // mask all interrupts
     outb(IO_PIC1 + 1, 0xFF);
     outb(IO_PIC2 + 1, 0xFF);
@@ -4,6 +4,7 @@
 #include <sync.h>
 #include <proc.h>
 #include <sched.h>
+#include <sig.h>
 #include <dev.h>
 #include <vfs.h>
 #include <iobuf.h>
@@ -59,6 +60,9 @@ dev_stdin_read(char *buf, size_t len) {
                 if (wait->wakeup_flags == WT_KBD) {
                     goto try_again;
                 }
+                if (ret == 0 && signal_pending(current)) {
+                    ret = -E_INTR;
+                }
                 break;
             }
         }
@@ -135,6 +135,16 @@ fd2file(int fd, struct file **file_store) {
     return -E_INVAL;
 }
 
+// file_inode - the inode of an opened fd, NULL if fd is not opened
+struct inode *
+file_inode(int fd) {
+    struct file *file;
+    if (fd2file(fd, &file) != 0) {
+        return NULL;
+    }
+    return file->node;
+}
+
 // file_testfd - test file is readble or writable?
 bool
 file_testfd(int fd, bool readable, bool writable) {
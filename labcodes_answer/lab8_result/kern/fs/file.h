@@ -28,6 +28,7 @@ void fd_array_open(struct file *file);
 void fd_array_close(struct file *file);
 void fd_array_dup(struct file *to, struct file *from);
 bool file_testfd(int fd, bool readable, bool writable);
+struct inode *file_inode(int fd);
 
 int file_open(char *path, uint32_t open_flags);
 int file_close(int fd);
@@ -12,6 +12,7 @@
 #include <bitmap.h>
 #include <error.h>
 #include <assert.h>
+#include <textcache.h>
 
 static const struct inode_ops sfs_node_dirops;  // dir operations
 static const struct inode_ops sfs_node_fileops; // file operations
@@ -652,6 +653,9 @@ sfs_io(struct inode *node, struct iobuf *iob, bool write) {
     struct sfs_fs *sfs = fsop_info(vop_fs(node), sfs);
     struct sfs_inode *sin = vop_info(node, sfs_inode);
     int ret;
+    if (write) {
+        textcache_invalidate(node);
+    }
     lock_sin(sin);
     {
         size_t alen = iob->io_resid;
@@ -867,6 +871,8 @@ sfs_reclaim(struct inode *node) {
     unlock_sfs_fs(sfs);
 
     if (sin->din->nlinks == 0) {
+        // the inode number may be reused by a new file
+        textcache_invalidate(node);
         sfs_block_free(sfs, sin->ino);
         if ((ent = sin->din->indirect) != 0) {
             sfs_block_free(sfs, ent);
@@ -936,6 +942,7 @@ sfs_truncfile(struct inode *node, off_t len) {
         return 0;
     }
 
+    textcache_invalidate(node);
     lock_sin(sin);
 	// old number of disk blocks of file
     nblks = din->blocks;
@@ -252,15 +252,29 @@ sysfile_getcwd(char *buf, size_t len) {
         return -E_INVAL;
     }
 
-    int ret = -E_INVAL;
-    lock_mm(mm);
-    {
-        if (user_mem_check(mm, (uintptr_t)buf, len, 1)) {
-            struct iobuf __iob, *iob = iobuf_init(&__iob, buf, len, 0);
-            ret = vfs_getcwd(iob);
+    // the path is built in a kernel buffer, a fault on buf must not happen in the fs
+    if (len > FS_MAX_FPATH_LEN + 1) {
+        len = FS_MAX_FPATH_LEN + 1;
+    }
+    char *buffer;
+    if ((buffer = kmalloc(len)) == NULL) {
+        return -E_NO_MEM;
+    }
+
+    int ret;
+    struct iobuf __iob, *iob = iobuf_init(&__iob, buffer, len, 0);
+    if ((ret = vfs_getcwd(iob)) == 0) {
+        // and the '\0' after it
+        size_t alen = iobuf_used(iob) + 1;
+        lock_mm(mm);
+        {
+            if (!copy_to_user(mm, buf, buffer, (alen < len) ? alen : len)) {
+                ret = -E_INVAL;
+            }
         }
+        unlock_mm(mm);
     }
-    unlock_mm(mm);
+    kfree(buffer);
     return ret;
 }
 
@@ -0,0 +1,311 @@
+#include <defs.h>
+#include <string.h>
+#include <error.h>
+#include <assert.h>
+#include <sync.h>
+#include <wait.h>
+#include <sem.h>
+#include <kmalloc.h>
+#include <vmm.h>
+#include <proc.h>
+#include <sched.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sysfile.h>
+#include <uring.h>
+#include <sig.h>
+#include <sysuring.h>
+
+/* *
+ * The ring itself stays in user memory, the kernel reads and writes it with
+ * copy_from_user and copy_to_user like any other system call argument.
+ * Without a worker, uring_enter runs the entries itself before it returns.
+ * With URING_SETUP_WORKER, a kernel thread started by uring_setup shares
+ * the mm and the files of the process (CLONE_VM | CLONE_FS) and runs them
+ * while the process goes on; uring_enter only wakes it up, and sleeps until
+ * min_complete completions are in the queue.
+ * */
+
+#define URING_MASK                  (URING_ENTRIES - 1)
+
+struct uring_ctx {
+    struct uring *ring;             // in the user memory of the process
+    struct proc_struct *worker;     // the kernel thread of URING_SETUP_WORKER, NULL without one
+    int ref;                        // the process and its worker
+    semaphore_t sem;                // one batch runs at a time
+    uint32_t submits;               // bumped by uring_enter, the worker sleeps until it changes
+    uint32_t completes;             // bumped by the worker, uring_enter sleeps until it changes
+    wait_queue_t worker_queue;      // the worker waits for submits here
+    wait_queue_t done_queue;        // uring_enter waits for completions here
+};
+
+// the indices at the head of struct uring
+struct uring_index {
+    uint32_t sq_head, sq_tail, cq_head, cq_tail;
+};
+
+static bool
+uring_copy_in(struct mm_struct *mm, void *dst, const void *src, size_t len) {
+    bool ret;
+    lock_mm(mm);
+    {
+        ret = copy_from_user(mm, dst, src, len, 1);
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+static bool
+uring_copy_out(struct mm_struct *mm, void *dst, const void *src, size_t len) {
+    bool ret;
+    lock_mm(mm);
+    {
+        ret = copy_to_user(mm, dst, src, len);
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+static void
+uring_put(struct uring_ctx *ctx) {
+    bool intr_flag, last;
+    local_intr_save(intr_flag);
+    {
+        last = (-- ctx->ref == 0);
+    }
+    local_intr_restore(intr_flag);
+    if (last) {
+        kfree(ctx);
+    }
+}
+
+// uring_op - do what the system call of the entry does
+static int
+uring_op(struct uring_sqe *sqe) {
+    switch (sqe->opcode) {
+    case URING_OP_NOP:
+        return 0;
+    case URING_OP_READ:
+        return sysfile_read(sqe->fd, (void *)sqe->addr, sqe->len);
+    case URING_OP_WRITE:
+        return sysfile_write(sqe->fd, (void *)sqe->addr, sqe->len);
+    case URING_OP_OPEN:
+        return sysfile_open((const char *)sqe->addr, sqe->len);
+    case URING_OP_CLOSE:
+        return sysfile_close(sqe->fd);
+    case URING_OP_GETDIRENTRY:
+        return sysfile_getdirentry(sqe->fd, (struct dirent *)sqe->addr);
+    }
+    return -E_INVAL;
+}
+
+// uring_run - run up to max entries, while there is room for their completions, return how many
+static int
+uring_run(struct uring_ctx *ctx, uint32_t max) {
+    struct mm_struct *mm = current->mm;
+    struct uring *ring = ctx->ring;
+    struct uring_index idx;
+    struct uring_sqe sqe;
+    struct uring_cqe cqe;
+    uint32_t n;
+
+    for (n = 0; n < max; n ++) {
+        if (!uring_copy_in(mm, &idx, ring, sizeof(struct uring_index))) {
+            return -E_FAULT;
+        }
+        if (idx.sq_head == idx.sq_tail || idx.cq_tail - idx.cq_head >= URING_ENTRIES) {
+            break;
+        }
+        if (!uring_copy_in(mm, &sqe, ring->sq + (idx.sq_head & URING_MASK), sizeof(struct uring_sqe))) {
+            return -E_FAULT;
+        }
+        // the slot is free for the process again before the operation runs
+        idx.sq_head ++;
+        if (!uring_copy_out(mm, (void *)&(ring->sq_head), &(idx.sq_head), sizeof(uint32_t))) {
+            return -E_FAULT;
+        }
+
+        cqe.user_data = sqe.user_data;
+        cqe.res = uring_op(&sqe);
+
+        // the completion first, then the index that shows it
+        if (!uring_copy_out(mm, ring->cq + (idx.cq_tail & URING_MASK), &cqe, sizeof(struct uring_cqe))) {
+            return -E_FAULT;
+        }
+        idx.cq_tail ++;
+        if (!uring_copy_out(mm, (void *)&(ring->cq_tail), &(idx.cq_tail), sizeof(uint32_t))) {
+            return -E_FAULT;
+        }
+    }
+    return n;
+}
+
+// uring_worker - the kernel thread of a ring, until the process exits or execs
+static int
+uring_worker(void *arg) {
+    struct uring_ctx *ctx = (struct uring_ctx *)arg;
+    uint32_t submits;
+    bool intr_flag;
+    int ret;
+
+    while (!(current->flags & PF_EXITING)) {
+        submits = ctx->submits;
+        down(&(ctx->sem));
+        ret = uring_run(ctx, URING_ENTRIES);
+        up(&(ctx->sem));
+
+        local_intr_save(intr_flag);
+        if (ret > 0) {
+            ctx->completes ++;
+            wakeup_queue(&(ctx->done_queue), WT_URING, 1);
+        }
+        else if (submits == ctx->submits && !(current->flags & PF_EXITING)) {
+            // nothing to do, or no room for completions: wait for the next uring_enter
+            wait_t __wait, *wait = &__wait;
+            wait_current_set(&(ctx->worker_queue), wait, WT_URING);
+            local_intr_restore(intr_flag);
+
+            schedule();
+
+            local_intr_save(intr_flag);
+            wait_current_del(&(ctx->worker_queue), wait);
+        }
+        local_intr_restore(intr_flag);
+    }
+
+    local_intr_save(intr_flag);
+    {
+        ctx->worker = NULL;
+        wakeup_queue(&(ctx->done_queue), WT_URING, 1);
+    }
+    local_intr_restore(intr_flag);
+    uring_put(ctx);
+    return 0;
+}
+
+// do_uring_setup - called by sys_uring_setup, use the struct uring at ring
+int
+do_uring_setup(uintptr_t ring, uint32_t flags) {
+    struct mm_struct *mm = current->mm;
+    struct uring_ctx *ctx;
+    bool ok;
+    int pid;
+
+    if (current->uring != NULL) {
+        return -E_BUSY;
+    }
+    if (ring % sizeof(uint32_t) != 0 || (flags & ~URING_SETUP_WORKER) != 0) {
+        return -E_INVAL;
+    }
+    lock_mm(mm);
+    {
+        ok = user_mem_check(mm, ring, sizeof(struct uring), 1);
+    }
+    unlock_mm(mm);
+    if (!ok) {
+        return -E_INVAL;
+    }
+
+    if ((ctx = kmalloc(sizeof(struct uring_ctx))) == NULL) {
+        return -E_NO_MEM;
+    }
+    ctx->ring = (struct uring *)ring;
+    ctx->worker = NULL;
+    ctx->ref = 1;
+    sem_init(&(ctx->sem), 1);
+    ctx->submits = ctx->completes = 0;
+    wait_queue_init(&(ctx->worker_queue));
+    wait_queue_init(&(ctx->done_queue));
+
+    if (flags & URING_SETUP_WORKER) {
+        if ((pid = kernel_thread(uring_worker, ctx, CLONE_FS)) < 0) {
+            kfree(ctx);
+            return pid;
+        }
+        ctx->worker = find_proc(pid);
+        ctx->ref ++;
+        set_proc_name(ctx->worker, "uring");
+        // wait in the process must not see its worker
+        proc_reparent_init(ctx->worker);
+    }
+    current->uring = ctx;
+    return 0;
+}
+
+/* *
+ * do_uring_enter - called by sys_uring_enter: run to_submit entries and
+ * return how many ran; or, with a worker, wake it up, wait until there are
+ * min_complete completions in the queue and return how many there are.
+ * */
+int
+do_uring_enter(uint32_t to_submit, uint32_t min_complete) {
+    struct uring_ctx *ctx = current->uring;
+    struct uring_index idx;
+    uint32_t completes;
+    bool intr_flag;
+    int ret;
+
+    if (ctx == NULL) {
+        return -E_INVAL;
+    }
+    if (ctx->worker == NULL) {
+        down(&(ctx->sem));
+        ret = uring_run(ctx, to_submit);
+        up(&(ctx->sem));
+        return ret;
+    }
+
+    local_intr_save(intr_flag);
+    {
+        ctx->submits ++;
+        wakeup_queue(&(ctx->worker_queue), WT_URING, 1);
+    }
+    local_intr_restore(intr_flag);
+
+    if (min_complete > URING_ENTRIES) {
+        min_complete = URING_ENTRIES;
+    }
+    while (1) {
+        completes = ctx->completes;
+        if (!uring_copy_in(current->mm, &idx, ctx->ring, sizeof(struct uring_index))) {
+            return -E_FAULT;
+        }
+        if (idx.cq_tail - idx.cq_head >= min_complete) {
+            break;
+        }
+        if (ctx->worker == NULL || (current->flags & PF_EXITING)) {
+            return -E_KILLED;
+        }
+        if (signal_pending(current)) {
+            return -E_INTR;
+        }
+        local_intr_save(intr_flag);
+        if (completes == ctx->completes && ctx->worker != NULL) {
+            wait_t __wait, *wait = &__wait;
+            wait_current_set(&(ctx->done_queue), wait, WT_URING);
+            local_intr_restore(intr_flag);
+
+            schedule();
+
+            local_intr_save(intr_flag);
+            wait_current_del(&(ctx->done_queue), wait);
+        }
+        local_intr_restore(intr_flag);
+    }
+    return idx.cq_tail - idx.cq_head;
+}
+
+// uring_release - proc exits or execs: stop the worker, and forget the ring
+void
+uring_release(struct proc_struct *proc) {
+    struct uring_ctx *ctx = proc->uring;
+    if (ctx == NULL) {
+        return ;
+    }
+    proc->uring = NULL;
+    if (ctx->worker != NULL) {
+        do_kill(ctx->worker->pid);
+    }
+    uring_put(ctx);
+}
+
@@ -0,0 +1,19 @@
+#ifndef __KERN_FS_SYSURING_H__
+#define __KERN_FS_SYSURING_H__
+
+#include <defs.h>
+
+/* *
+ * The submission/completion ring of a process (libs/uring.h): uring_enter
+ * runs a batch of file system calls for the price of one trap, or hands
+ * them to a kernel thread of the process, which shares its mm and files.
+ * */
+
+struct proc_struct;
+
+int do_uring_setup(uintptr_t ring, uint32_t flags);
+int do_uring_enter(uint32_t to_submit, uint32_t min_complete);
+void uring_release(struct proc_struct *proc);
+
+#endif /* !__KERN_FS_SYSURING_H__ */
+
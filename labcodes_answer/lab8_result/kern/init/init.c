@@ -13,6 +13,10 @@
 #include <swap.h>
 #include <proc.h>
 #include <fs.h>
+#include <futex.h>
+#include <textcache.h>
+#include <fpu.h>
+#include <smp.h>
 
 int kern_init(void) __attribute__((noreturn));
 
@@ -33,19 +37,24 @@ kern_init(void) {
     grade_backtrace();
 
     pmm_init();                 // init physical memory management
+    smp_init();                 // find the other cpus and the APICs
 
     pic_init();                 // init interrupt controller
     idt_init();                 // init interrupt descriptor table
+    fpu_init();                 // init lazy FPU switching
 
     vmm_init();                 // init virtual memory management
     sched_init();               // init scheduler
+    futex_init();               // init futex wait queues
     proc_init();                // init process table
     
     ide_init();                 // init ide devices
     swap_init();                // init swap
     fs_init();                  // init fs
+    textcache_init();           // init shared text page cache
     
     clock_init();               // init clock interrupt
+    smp_boot();                 // start the other cpus
     intr_enable();              // enable irq interrupt
 
     //LAB1: CAHLLENGE 1 If you try to do it, uncomment lab1_switch_test()
@@ -30,6 +30,8 @@
  *                                                              kernel/user
  *
  *     4G ------------------> +---------------------------------+
+ *                            |    Local and I/O APICs (SMP)    | RW/--
+ *     MMIOBASE ------------> +---------------------------------+ 0xFEC00000
  *                            |                                 |
  *                            |         Empty Memory (*)        |
  *                            |                                 |
@@ -37,7 +39,9 @@
  *                            |   Cur. Page Table (Kern, RW)    | RW/-- PTSIZE
  *     VPT -----------------> +---------------------------------+ 0xFAC00000
  *                            |        Invalid Memory (*)       | --/--
- *     KERNTOP -------------> +---------------------------------+ 0xF8000000
+ *                            +---------------------------------+ 0xF8400000
+ *                            |  Temporary High Memory Mappings | RW/-- PTSIZE
+ *     KERNTOP, KMAPBASE ---> +---------------------------------+ 0xF8000000
  *                            |                                 |
  *                            |    Remapped Physical Memory     | RW/-- KMEMSIZE
  *                            |                                 |
@@ -54,6 +58,8 @@
  *                            ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
  *                            |       User Program & Heap       |
  *     UTEXT ---------------> +---------------------------------+ 0x00800000
+ *                            |            Time Page            | R-/R- PGSIZE
+ *     TIMEPAGE_VA ---------> +---------------------------------+ 0x007FF000
  *                            |        Invalid Memory (*)       | --/--
  *                            |  - - - - - - - - - - - - - - -  |
  *                            |    User STAB Data (optional)    |
@@ -71,6 +77,18 @@
 #define KMEMSIZE            0x38000000                  // the maximum amount of physical memory
 #define KERNTOP             (KERNBASE + KMEMSIZE)
 
+/* *
+ * Physical memory above KMEMSIZE (high memory) is not mapped by the kernel,
+ * it holds user pages only. The kernel reaches such a page through a
+ * temporary mapping (kmap) in this window.
+ * */
+#define KMAPBASE            KERNTOP
+#define KMAPSIZE            PTSIZE
+#define KMAPTOP             (KMAPBASE + KMAPSIZE)
+
+/* physical memory beyond this can only be reached with PAE */
+#define MAXPA               0x100000000ULL
+
 /* *
  * Virtual page table. Entry PDX[VPT] in the PD (Page Directory) contains
  * a pointer to the page directory itself, thereby turning the PD into a page
@@ -79,6 +97,15 @@
  * */
 #define VPT                 0xFAC00000
 
+/* *
+ * The registers of the local and I/O APICs are mapped at their physical
+ * address, above all of the memory, with caching off.
+ * */
+#define MMIOBASE            0xFEC00000
+
+/* the APs start at this page, in real mode, see smp_boot */
+#define AP_BOOT_PA          0x7000
+
 #define KSTACKPAGE          2                           // # of pages in kernel stack
 #define KSTACKSIZE          (KSTACKPAGE * PGSIZE)       // sizeof kernel stack
 
@@ -139,6 +166,8 @@ struct Page {
 /* Flags describing the status of a page frame */
 #define PG_reserved                 0       // the page descriptor is reserved for kernel or unusable
 #define PG_property                 1       // the member 'property' is valid
+#define PG_text                     3       // the page is read-only and fork shares it: the text cache, the time page
+#define PG_swappable                4       // the page is on the pra list of its mm, swap_out may pick it
 
 #define SetPageReserved(page)       set_bit(PG_reserved, &((page)->flags))
 #define ClearPageReserved(page)     clear_bit(PG_reserved, &((page)->flags))
@@ -146,6 +175,11 @@ struct Page {
 #define SetPageProperty(page)       set_bit(PG_property, &((page)->flags))
 #define ClearPageProperty(page)     clear_bit(PG_property, &((page)->flags))
 #define PageProperty(page)          test_bit(PG_property, &((page)->flags))
+#define SetPageText(page)           set_bit(PG_text, &((page)->flags))
+#define PageText(page)              test_bit(PG_text, &((page)->flags))
+#define SetPageSwappable(page)      set_bit(PG_swappable, &((page)->flags))
+#define ClearPageSwappable(page)    clear_bit(PG_swappable, &((page)->flags))
+#define PageSwappable(page)         test_bit(PG_swappable, &((page)->flags))
 
 // convert list entry to page
 #define le2page(le, member)                 \
@@ -260,6 +260,8 @@ struct taskstate {
 #define CR0_CD          0x40000000              // Cache Disable
 #define CR0_PG          0x80000000              // Paging
 
+#define CR4_OSXMMEXCPT  0x00000400              // OS supports unmasked SIMD exceptions
+#define CR4_OSFXSR      0x00000200              // OS supports FXSAVE/FXRSTOR and SSE
 #define CR4_PCE         0x00000100              // Performance counter enable
 #define CR4_MCE         0x00000040              // Machine Check Enable
 #define CR4_PSE         0x00000010              // Page Size Extensions
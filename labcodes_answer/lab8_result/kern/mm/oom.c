@@ -0,0 +1,68 @@
+#include <defs.h>
+#include <list.h>
+#include <stdio.h>
+#include <sync.h>
+#include <vmm.h>
+#include <proc.h>
+#include <sched.h>
+#include <oom.h>
+
+/* *
+ * The oom killer runs when alloc_pages finds no free page for a single page
+ * request and neither swapping out nor dropping caches helps. It kills the
+ * process whose exit releases the most memory, counting its swapped out
+ * pages too, then yields so the victim can reach do_exit, and lets the
+ * allocation retry. A failed request of n > 1 pages just fails.
+ * */
+
+// badness - the pages released when proc exits, 0 if killing proc is useless
+static size_t
+badness(struct proc_struct *proc) {
+    if (proc->mm == NULL || proc->state == PROC_ZOMBIE) {
+        return 0;
+    }
+    struct mm_struct *mm = proc->mm;
+    return mm->rss + mm->swap + mm_pgtable_pages(mm);
+}
+
+// out_of_memory - kill a process to free memory, return true if the allocation of n pages should be retried
+bool
+out_of_memory(size_t n, int retries) {
+    if (current == NULL || retries >= OOM_MAX_RETRIES) {
+        return 0;
+    }
+    struct proc_struct *victim = NULL;
+    size_t points, max_points = 0;
+    bool dying = 0, intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = &proc_list, *le = list;
+        while ((le = list_next(le)) != list) {
+            struct proc_struct *proc = le2proc(le, list_link);
+            if ((points = badness(proc)) == 0) {
+                continue;
+            }
+            if (proc->flags & PF_EXITING) {
+                dying = 1;
+            }
+            else if (points > max_points) {
+                victim = proc, max_points = points;
+            }
+        }
+        // a victim killed by a previous round is still releasing its memory
+        if (!dying && victim != NULL) {
+            cprintf("oom: out of memory for %d pages, kill process %d (%s) holding %d pages.\n",
+                    n, victim->pid, victim->name, max_points);
+            do_kill(victim->pid);
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if ((!dying && victim == NULL) || (current->flags & PF_EXITING)) {
+        // nothing left to kill, or current is the victim and must fail to exit
+        return 0;
+    }
+    schedule();
+    return 1;
+}
+
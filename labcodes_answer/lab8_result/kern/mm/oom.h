@@ -0,0 +1,12 @@
+#ifndef __KERN_MM_OOM_H__
+#define __KERN_MM_OOM_H__
+
+#include <defs.h>
+
+// times an allocation is retried after the oom killer ran, before it fails
+#define OOM_MAX_RETRIES             16
+
+bool out_of_memory(size_t n, int retries);
+
+#endif /* !__KERN_MM_OOM_H__ */
+
@@ -5,12 +5,16 @@
 #include <mmu.h>
 #include <memlayout.h>
 #include <pmm.h>
+#include <trap.h>
 #include <default_pmm.h>
 #include <sync.h>
 #include <error.h>
 #include <swap.h>
 #include <vmm.h>
 #include <kmalloc.h>
+#include <oom.h>
+#include <sched.h>
+#include <smp.h>
 
 /* *
  * Task State Segment:
@@ -38,6 +42,19 @@ static struct taskstate ts = {0};
 struct Page *pages;
 // amount of physical memory (in pages)
 size_t npage = 0;
+// amount of physical memory mapped at KERNBASE (in pages), the rest is high memory
+size_t npage_low = 0;
+
+// free high memory pages, linked through page_link
+static list_entry_t highmem_free_list;
+static size_t nr_free_highmem = 0;
+
+// caches to shrink before the oom killer runs
+static list_entry_t shrinker_list;
+
+// page table of the kmap window, and a bitmap of its slots in use
+static pte_t *kmap_pgtable = NULL;
+static uint32_t kmap_slots[KMAPSIZE / PGSIZE / 32];
 
 // virtual address of boot-time page directory
 extern pde_t __boot_pgdir;
@@ -90,6 +107,13 @@ static struct pseudodesc gdt_pd = {
     sizeof(gdt) - 1, (uintptr_t)gdt
 };
 
+#ifdef CONFIG_SMP
+// an AP can not load the TSS of the boot cpu, a TSS descriptor is busy
+// while it is loaded: each AP has a TSS and a GDT of its own
+static struct taskstate ap_ts[NCPU];
+static struct segdesc ap_gdt[NCPU][SEG_TSS + 1];
+#endif
+
 static void check_alloc_page(void);
 static void check_pgdir(void);
 static void check_boot_pgdir(void);
@@ -117,6 +141,13 @@ lgdt(struct pseudodesc *pd) {
  * */
 void
 load_esp0(uintptr_t esp0) {
+#ifdef CONFIG_SMP
+    int id = cpunum();
+    if (id != 0) {
+        ap_ts[id].ts_esp0 = esp0;
+        return ;
+    }
+#endif
     ts.ts_esp0 = esp0;
 }
 
@@ -135,8 +166,26 @@ gdt_init(void) {
 
     // load the TSS
     ltr(GD_TSS);
+    sysenter_init(&ts);
 }
 
+#ifdef CONFIG_SMP
+/* gdt_init_ap - the GDT and TSS of an AP, a copy of those of the boot cpu */
+void
+gdt_init_ap(void) {
+    int id = cpunum();
+    struct pseudodesc pd = {sizeof(gdt) - 1, (uintptr_t)ap_gdt[id]};
+
+    memcpy(ap_gdt[id], gdt, sizeof(gdt));
+    ap_ts[id].ts_ss0 = KERNEL_DS;
+    ap_gdt[id][SEG_TSS] = SEGTSS(STS_T32A, (uintptr_t)(ap_ts + id), sizeof(struct taskstate), DPL_KERNEL);
+
+    lgdt(&pd);
+    ltr(GD_TSS);
+    sysenter_init(ap_ts + id);
+}
+#endif
+
 //init_pmm_manager - initialize a pmm_manager instance
 static void
 init_pmm_manager(void) {
@@ -156,6 +205,7 @@ struct Page *
 alloc_pages(size_t n) {
     struct Page *page=NULL;
     bool intr_flag;
+    int retries = 0;
     
     while (1)
     {
@@ -165,11 +215,19 @@ alloc_pages(size_t n) {
          }
          local_intr_restore(intr_flag);
 
-         if (page != NULL || n > 1 || swap_init_ok == 0) break;
+         if (page != NULL) break;
          
          extern struct mm_struct *check_mm_struct;
-         //cprintf("page %x, call swap_out in alloc_pages %d\n",page, n);
-         swap_out(check_mm_struct, n, 0);
+         if (n == 1 && swap_init_ok && check_mm_struct != NULL) {
+              //cprintf("page %x, call swap_out in alloc_pages %d\n",page, n);
+              swap_out(check_mm_struct, n, 0);
+              continue;
+         }
+         // swap out a page of the processes before dropping caches or killing one
+         if (n == 1 && swap_reclaim(n) != 0) continue;
+         if (shrink_caches() != 0) continue;
+         // n > 1 fails for want of contiguous pages, killing a process may not free any
+         if (n != 1 || !out_of_memory(n, retries ++)) break;
     }
     //cprintf("n %d,get page %x, No %d in alloc_pages\n",n,page,(page-pages));
     return page;
@@ -181,7 +239,18 @@ free_pages(struct Page *base, size_t n) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        pmm_manager->free_pages(base, n);
+        if (PageSwappable(base)) {
+            swap_page_freed(base);
+        }
+        if (PageHighMem(base)) {
+            assert(n == 1);
+            base->flags = 0;
+            list_add(&highmem_free_list, &(base->page_link));
+            nr_free_highmem ++;
+        }
+        else {
+            pmm_manager->free_pages(base, n);
+        }
     }
     local_intr_restore(intr_flag);
 }
@@ -194,12 +263,111 @@ nr_free_pages(void) {
     bool intr_flag;
     local_intr_save(intr_flag);
     {
-        ret = pmm_manager->nr_free_pages();
+        ret = pmm_manager->nr_free_pages() + nr_free_highmem;
     }
     local_intr_restore(intr_flag);
     return ret;
 }
 
+//register_shrinker - add a cache to be shrunk under memory pressure
+void
+register_shrinker(struct shrinker *shrinker) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_add_before(&shrinker_list, &(shrinker->shrinker_link));
+    }
+    local_intr_restore(intr_flag);
+}
+
+//shrink_caches - empty every registered cache, return the number of pages freed
+size_t
+shrink_caches(void) {
+    size_t freed = 0;
+    list_entry_t *le = &shrinker_list;
+    while ((le = list_next(le)) != &shrinker_list) {
+        freed += le2shrinker(le, shrinker_link)->shrink();
+    }
+    return freed;
+}
+
+//alloc_highpage - allocate a page for user data, from high memory when there is some left
+struct Page *
+alloc_highpage(void) {
+    struct Page *page = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (!list_empty(&highmem_free_list)) {
+            list_entry_t *le = list_next(&highmem_free_list);
+            list_del(le);
+            nr_free_highmem --;
+            page = le2page(le, page_link);
+        }
+    }
+    local_intr_restore(intr_flag);
+    return (page != NULL) ? page : alloc_page();
+}
+
+//nr_free_highpages - the number of free high memory pages, included in nr_free_pages
+size_t
+nr_free_highpages(void) {
+    return nr_free_highmem;
+}
+
+//kmap - get a kernel virtual address for page; a high memory page is mapped
+//     - into a free slot of the kmap window until kunmap
+void *
+kmap(struct Page *page) {
+    if (!PageHighMem(page)) {
+        return page2kva(page);
+    }
+    int slot;
+    bool intr_flag;
+    while (1) {
+        local_intr_save(intr_flag);
+        {
+            for (slot = 0; slot < KMAPSIZE / PGSIZE; slot ++) {
+                if (!(kmap_slots[slot >> 5] & (1 << (slot & 31)))) {
+                    kmap_slots[slot >> 5] |= (1 << (slot & 31));
+                    kmap_pgtable[slot] = page2pa(page) | PTE_P | PTE_W;
+                    break;
+                }
+            }
+        }
+        local_intr_restore(intr_flag);
+        if (slot < KMAPSIZE / PGSIZE) {
+            break;
+        }
+        // every slot is taken, wait for a kunmap
+        schedule();
+    }
+    // the TLB of this cpu may still hold the page the slot mapped before,
+    // unmapped on another cpu
+    invlpg((void *)(KMAPBASE + slot * PGSIZE));
+    return (void *)(KMAPBASE + slot * PGSIZE);
+}
+
+//kunmap - release the mapping made by kmap
+void
+kunmap(void *kva) {
+    uintptr_t va = (uintptr_t)kva;
+    if (va < KMAPBASE || va >= KMAPTOP) {
+        return;
+    }
+    int slot = (va - KMAPBASE) / PGSIZE;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        // only this cpu: kmap flushes the slot on the cpu that takes it next,
+        // and sched_steal the whole TLB of a cpu a process moves to
+        kmap_pgtable[slot] = 0;
+        invlpg((void *)ROUNDDOWN(va, PGSIZE));
+        kmap_slots[slot >> 5] &= ~(1 << (slot & 31));
+    }
+    local_intr_restore(intr_flag);
+}
+
 /* pmm_init - initialize the physical memory management */
 static void
 page_init(void) {
@@ -213,19 +381,41 @@ page_init(void) {
         cprintf("  memory: %08llx, [%08llx, %08llx], type = %d.\n",
                 memmap->map[i].size, begin, end - 1, memmap->map[i].type);
         if (memmap->map[i].type == E820_ARM) {
-            if (maxpa < end && begin < KMEMSIZE) {
+            if (maxpa < end && begin < MAXPA) {
                 maxpa = end;
             }
         }
     }
-    if (maxpa > KMEMSIZE) {
-        maxpa = KMEMSIZE;
+    if (maxpa > MAXPA) {
+        maxpa = MAXPA;
     }
 
     extern char end[];
 
     npage = maxpa / PGSIZE;
-    pages = (struct Page *)ROUNDUP((void *)end, PGSIZE);
+    npage_low = ((maxpa > KMEMSIZE) ? KMEMSIZE : maxpa) / PGSIZE;
+
+    // entry.S maps only the first 4MB, map the rest of the pages array with
+    // page tables taken from the free memory in front of it
+    uintptr_t freeva = ROUNDUP((uintptr_t)end, PGSIZE);
+    size_t n, npt = 0, pages_size = sizeof(struct Page) * npage;
+    while (freeva + npt * PGSIZE + pages_size > KERNBASE + (npt + 1) * PTSIZE) {
+        npt ++;
+    }
+    assert(freeva + npt * PGSIZE <= KERNBASE + PTSIZE);
+    for (n = 0; n < npt; n ++) {
+        pte_t *pt = (pte_t *)(freeva + n * PGSIZE);
+        uintptr_t pa = (n + 1) * PTSIZE;
+        for (i = 0; i < NPTEENTRY; i ++) {
+            pt[i] = (pa + i * PGSIZE) | PTE_P | PTE_W;
+        }
+        boot_pgdir[PDX(KERNBASE) + n + 1] = PADDR(pt) | PTE_P | PTE_W;
+    }
+    if (npt != 0) {
+        lcr3(rcr3());
+    }
+
+    pages = (struct Page *)(freeva + npt * PGSIZE);
 
     for (i = 0; i < npage; i ++) {
         SetPageReserved(pages + i);
@@ -253,6 +443,47 @@ page_init(void) {
     }
 }
 
+//highmem_init - set up the kmap window, and hand the memory above KMEMSIZE
+//             - to the high memory free list
+static void
+highmem_init(void) {
+    list_init(&highmem_free_list);
+    if (npage_low == npage) {
+        return;
+    }
+
+    struct Page *page;
+    if ((page = alloc_page()) == NULL) {
+        panic("highmem_init: cannot allocate the kmap page table.\n");
+    }
+    kmap_pgtable = page2kva(page);
+    memset(kmap_pgtable, 0, PGSIZE);
+    boot_pgdir[PDX(KMAPBASE)] = page2pa(page) | PTE_P | PTE_W;
+
+    struct e820map *memmap = (struct e820map *)(0x8000 + KERNBASE);
+    int i;
+    for (i = 0; i < memmap->nr_map; i ++) {
+        uint64_t begin = memmap->map[i].addr, end = begin + memmap->map[i].size;
+        if (memmap->map[i].type == E820_ARM) {
+            if (begin < KMEMSIZE) {
+                begin = KMEMSIZE;
+            }
+            if (end > MAXPA) {
+                end = MAXPA;
+            }
+            for (begin = ROUNDUP(begin, PGSIZE); begin + PGSIZE <= end; begin += PGSIZE) {
+                page = pa2page(begin);
+                page->flags = page->property = 0;
+                set_page_ref(page, 0);
+                list_add_before(&highmem_free_list, &(page->page_link));
+                nr_free_highmem ++;
+            }
+        }
+    }
+    cprintf("highmem: %d pages above %dMB, mapped on demand at 0x%08x.\n",
+            nr_free_highmem, KMEMSIZE / 1024 / 1024, KMAPBASE);
+}
+
 //boot_map_segment - setup&enable the paging mechanism
 // parameters
 //  la:   linear address of this memory need to map (after x86 segment map)
@@ -272,6 +503,16 @@ boot_map_segment(pde_t *pgdir, uintptr_t la, size_t size, uintptr_t pa, uint32_t
     }
 }
 
+//mmio_map - map the device registers at pa, above all of the memory, at the same
+//         - virtual address with caching off; called before the first process exists,
+//         - as the page directories of the processes copy the kernel part of boot_pgdir
+void *
+mmio_map(uintptr_t pa, size_t size) {
+    assert(pa >= MMIOBASE && pa + size > pa);
+    boot_map_segment(boot_pgdir, pa, size, pa, PTE_W | PTE_PCD | PTE_PWT);
+    return (void *)pa;
+}
+
 //boot_alloc_page - allocate one page using pmm->alloc_pages(1) 
 // return value: the kernel virtual address of this allocated page
 //note: this function is used to get the memory for PDT(Page Directory Table)&PT(Page Table)
@@ -291,6 +532,8 @@ pmm_init(void) {
     // We've already enabled paging
     boot_cr3 = PADDR(boot_pgdir);
 
+    list_init(&shrinker_list);
+
     //We need to alloc/free the physical memory (granularity is 4KB or other size). 
     //So a framework of physical memory manager (struct pmm_manager)is defined in pmm.h
     //First we should init a physical memory manager(pmm) based on the framework.
@@ -328,6 +571,8 @@ pmm_init(void) {
     check_boot_pgdir();
 
     print_pgdir();
+
+    highmem_init();
     
     kmalloc_init();
 
@@ -440,6 +685,10 @@ page_remove_pte(pde_t *pgdir, uintptr_t la, pte_t *ptep) {
         *ptep = 0;
         tlb_invalidate(pgdir, la);
     }
+    else if (*ptep != 0) {
+        swap_free(*ptep);
+        *ptep = 0;
+    }
 }
 
 void
@@ -480,12 +729,17 @@ exit_range(pde_t *pgdir, uintptr_t start, uintptr_t end) {
  * @from:  the addr of process A's Page Directory
  * @share: flags to indicate to dup OR share. We just use dup method, so it didn't be used.
  *
+ * Pages of the text cache are read-only and shared instead of copied, a
+ * swapped out page gets a swap entry of its own with a copy of the page.
+ * Return the number of pages copied, or -E_NO_MEM.
+ *
  * CALL GRAPH: copy_mm-->dup_mmap-->copy_range
  */
 int
 copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share) {
     assert(start % PGSIZE == 0 && end % PGSIZE == 0);
     assert(USER_ACCESS(start, end));
+    int copied = 0;
     // copy content by page unit.
     do {
         //call get_pte to find process A's pte according to the addr start
@@ -502,10 +756,19 @@ copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share) {
         uint32_t perm = (*ptep & PTE_USER);
         //get page from ptep
         struct Page *page = pte2page(*ptep);
+        if (PageText(page)) {
+            if (page_insert(to, page, start, perm) != 0) {
+                return -E_NO_MEM;
+            }
+            start += PGSIZE;
+            continue ;
+        }
         // alloc a page for process B
-        struct Page *npage=alloc_page();
+        struct Page *npage=alloc_highpage();
         assert(page!=NULL);
-        assert(npage!=NULL);
+        if (npage == NULL) {
+            return -E_NO_MEM;
+        }
         int ret=0;
         /* LAB5:EXERCISE2 YOUR CODE
          * replicate content of page to npage, build the map of phy addr of nage with the linear addr start
@@ -521,17 +784,27 @@ copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share) {
          * (3) memory copy from src_kvaddr to dst_kvaddr, size is PGSIZE
          * (4) build the map of phy addr of  nage with the linear addr start
          */
-        void * kva_src = page2kva(page);
-        void * kva_dst = page2kva(npage);
+        void * kva_src = kmap(page);
+        void * kva_dst = kmap(npage);
     
         memcpy(kva_dst, kva_src, PGSIZE);
+        kunmap(kva_dst);
+        kunmap(kva_src);
 
-        ret = page_insert(to, npage, start, perm);
-        assert(ret == 0);
+        if ((ret = page_insert(to, npage, start, perm)) != 0) {
+            free_page(npage);
+            return ret;
+        }
+        copied ++;
+        }
+        else if (*ptep != 0) {
+            if ((nptep = get_pte(to, start, 1)) == NULL || (*nptep = swap_dup(*ptep)) == 0) {
+                return -E_NO_MEM;
+            }
         }
         start += PGSIZE;
     } while (start != 0 && start < end);
-    return 0;
+    return copied;
 }
 
 //page_remove - free an Page which is related linear address la and has an validated pte
@@ -579,39 +852,41 @@ tlb_invalidate(pde_t *pgdir, uintptr_t la) {
     if (rcr3() == PADDR(pgdir)) {
         invlpg((void *)la);
     }
+#ifdef CONFIG_SMP
+    // and on the other cpus running threads of the same process
+    tlb_shootdown(PADDR(pgdir));
+#endif
 }
 
-// pgdir_alloc_page - call alloc_page & page_insert functions to 
-//                  - allocate a page size memory & setup an addr map
-//                  - pa<->la with linear address la and the PDT pgdir
-struct Page *
-pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm) {
-    struct Page *page = alloc_page();
+//pgdir_map_new_page - map the page just allocated, if any, at la
+static struct Page *
+pgdir_map_new_page(pde_t *pgdir, uintptr_t la, uint32_t perm, struct Page *page) {
     if (page != NULL) {
         if (page_insert(pgdir, page, la, perm) != 0) {
             free_page(page);
             return NULL;
         }
-        if (swap_init_ok){
-            if(check_mm_struct!=NULL) {
-                swap_map_swappable(check_mm_struct, la, page, 0);
-                page->pra_vaddr=la;
-                assert(page_ref(page) == 1);
-                //cprintf("get No. %d  page: pra_vaddr %x, pra_link.prev %x, pra_link_next %x in pgdir_alloc_page\n", (page-pages), page->pra_vaddr,page->pra_page_link.prev, page->pra_page_link.next);
-            } 
-            else  {  //now current is existed, should fix it in the future
-                //swap_map_swappable(current->mm, la, page, 0);
-                //page->pra_vaddr=la;
-                //assert(page_ref(page) == 1);
-                //panic("pgdir_alloc_page: no pages. now current is existed, should fix it in the future\n");
-            }
-        }
-
+        // the caller knows the mm, and hands the page to the swap manager, see do_pgfault
     }
 
     return page;
 }
 
+// pgdir_alloc_page - call alloc_page & page_insert functions to 
+//                  - allocate a page size memory & setup an addr map
+//                  - pa<->la with linear address la and the PDT pgdir
+//                  - the page comes from high memory while there is some, see pgdir_alloc_lowpage
+struct Page *
+pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm) {
+    return pgdir_map_new_page(pgdir, la, perm, alloc_highpage());
+}
+
+//pgdir_alloc_lowpage - pgdir_alloc_page with a page of low memory
+struct Page *
+pgdir_alloc_lowpage(pde_t *pgdir, uintptr_t la, uint32_t perm) {
+    return pgdir_map_new_page(pgdir, la, perm, alloc_page());
+}
+
 static void
 check_alloc_page(void) {
     pmm_manager->check();
@@ -620,7 +895,7 @@ check_alloc_page(void) {
 
 static void
 check_pgdir(void) {
-    assert(npage <= KMEMSIZE / PGSIZE);
+    assert(npage_low <= KMEMSIZE / PGSIZE);
     assert(boot_pgdir != NULL && (uint32_t)PGOFF(boot_pgdir) == 0);
     assert(get_page(boot_pgdir, 0x0, NULL) == NULL);
 
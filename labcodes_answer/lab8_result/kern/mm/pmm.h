@@ -6,6 +6,7 @@
 #include <memlayout.h>
 #include <atomic.h>
 #include <assert.h>
+#include <list.h>
 
 // pmm_manager is a physical memory management class. A special pmm manager - XXX_pmm_manager
 // only needs to implement the methods in pmm_manager class, then XXX_pmm_manager can be used
@@ -31,18 +32,38 @@ void pmm_init(void);
 struct Page *alloc_pages(size_t n);
 void free_pages(struct Page *base, size_t n);
 size_t nr_free_pages(void);
+struct Page *alloc_highpage(void);
+size_t nr_free_highpages(void);
 
 #define alloc_page() alloc_pages(1)
 #define free_page(page) free_pages(page, 1)
 
+void *kmap(struct Page *page);
+void kunmap(void *kva);
+
+// a shrinker gives the memory held by a cache back when alloc_pages runs short
+struct shrinker {
+    size_t (*shrink)(void);                 // empty the cache, return the number of pages freed
+    list_entry_t shrinker_link;             // entry in the shrinker list
+};
+
+#define le2shrinker(le, member)                 \
+    to_struct((le), struct shrinker, member)
+
+void register_shrinker(struct shrinker *shrinker);
+size_t shrink_caches(void);
+
 pte_t *get_pte(pde_t *pgdir, uintptr_t la, bool create);
 struct Page *get_page(pde_t *pgdir, uintptr_t la, pte_t **ptep_store);
 void page_remove(pde_t *pgdir, uintptr_t la);
 int page_insert(pde_t *pgdir, struct Page *page, uintptr_t la, uint32_t perm);
 
 void load_esp0(uintptr_t esp0);
+void gdt_init_ap(void);
+void *mmio_map(uintptr_t pa, size_t size);
 void tlb_invalidate(pde_t *pgdir, uintptr_t la);
 struct Page *pgdir_alloc_page(pde_t *pgdir, uintptr_t la, uint32_t perm);
+struct Page *pgdir_alloc_lowpage(pde_t *pgdir, uintptr_t la, uint32_t perm);
 void unmap_range(pde_t *pgdir, uintptr_t start, uintptr_t end);
 void exit_range(pde_t *pgdir, uintptr_t start, uintptr_t end);
 int copy_range(pde_t *to, pde_t *from, uintptr_t start, uintptr_t end, bool share);
@@ -69,7 +90,7 @@ void print_pgdir(void);
 #define KADDR(pa) ({                                                    \
             uintptr_t __m_pa = (pa);                                    \
             size_t __m_ppn = PPN(__m_pa);                               \
-            if (__m_ppn >= npage) {                                     \
+            if (__m_ppn >= npage_low) {                                 \
                 panic("KADDR called with invalid pa %08lx", __m_pa);    \
             }                                                           \
             (void *) (__m_pa + KERNBASE);                               \
@@ -77,12 +98,16 @@ void print_pgdir(void);
 
 extern struct Page *pages;
 extern size_t npage;
+extern size_t npage_low;
 
 static inline ppn_t
 page2ppn(struct Page *page) {
     return page - pages;
 }
 
+// a high memory page has no permanent kernel mapping, use kmap to reach it
+#define PageHighMem(page)       (page2ppn(page) >= npage_low)
+
 static inline uintptr_t
 page2pa(struct Page *page) {
     return page2ppn(page) << PGSHIFT;
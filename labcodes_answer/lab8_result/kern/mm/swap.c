@@ -1,6 +1,7 @@
 #include <swap.h>
 #include <swapfs.h>
 #include <swap_fifo.h>
+#include <zram.h>
 #include <stdio.h>
 #include <string.h>
 #include <memlayout.h>
@@ -8,6 +9,11 @@
 #include <mmu.h>
 #include <default_pmm.h>
 #include <kdebug.h>
+#include <error.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <x86.h>
+#include <proc.h>
 
 // the valid vaddr for check is between 0~CHECK_VALID_VADDR-1
 #define CHECK_VALID_VIR_PAGE_NUM 5
@@ -21,6 +27,14 @@
 static struct swap_manager *sm;
 size_t max_swap_offset;
 
+/* *
+ * swap_map - bit n is set while swap offset n holds a page, offset 0 is never
+ * given out. Every page going out gets an offset of its own, which is also
+ * its key in zram: the same vaddr of two processes must not share a slot.
+ * */
+static uint32_t *swap_map;
+static size_t swap_map_words;
+
 volatile int swap_init_ok = 0;
 
 unsigned int swap_page[CHECK_VALID_VIR_PAGE_NUM];
@@ -29,15 +43,61 @@ unsigned int swap_in_seq_no[MAX_SEQ_NO],swap_out_seq_no[MAX_SEQ_NO];
 
 static void check_swap(void);
 
+static void
+swap_map_init(void)
+{
+     size_t i;
+     swap_map_words = ROUNDUP(max_swap_offset, 32) / 32;
+     if ((swap_map = kmalloc(swap_map_words * sizeof(uint32_t))) == NULL) {
+          panic("swap: cannot allocate the swap map.\n");
+     }
+     memset(swap_map, 0, swap_map_words * sizeof(uint32_t));
+     swap_map[0] |= 1;
+     // the bits past the end of the swap disk
+     for (i = max_swap_offset; i < swap_map_words * 32; i ++) {
+          swap_map[i / 32] |= (1U << (i % 32));
+     }
+}
+
+// swap_alloc - a free swap entry, the first free offset after the last one given out; 0 if the disk is full
+static swap_entry_t
+swap_alloc(void)
+{
+     static size_t last = 0;
+     swap_entry_t entry = 0;
+     uint32_t free;
+     size_t w, i;
+     bool intr_flag;
+     local_intr_save(intr_flag);
+     {
+          w = (last + 1) / 32 % swap_map_words;
+          free = ~swap_map[w] & (~0U << ((last + 1) % 32));
+          // at most one full turn, back to the low bits of the first word
+          for (i = 0; free == 0 && i < swap_map_words; i ++) {
+               w = (w + 1) % swap_map_words;
+               free = ~swap_map[w];
+          }
+          if (free != 0) {
+               last = w * 32 + bsf(free);
+               swap_map[w] |= (1U << (last % 32));
+               entry = last << 8;
+          }
+     }
+     local_intr_restore(intr_flag);
+     return entry;
+}
+
 int
 swap_init(void)
 {
      swapfs_init();
+     zram_init();
 
      if (!(1024 <= max_swap_offset && max_swap_offset < MAX_SWAP_OFFSET_LIMIT))
      {
           panic("bad max_swap_offset %08x.\n", max_swap_offset);
      }
+     swap_map_init();
      
 
      sm = &swap_manager_fifo;
@@ -65,12 +125,26 @@ swap_tick_event(struct mm_struct *mm)
      return sm->tick_event(mm);
 }
 
+// swap_map_swappable - page is mapped at addr of mm, swap_out may pick it from now on
 int
 swap_map_swappable(struct mm_struct *mm, uintptr_t addr, struct Page *page, int swap_in)
 {
+     if (!swap_init_ok || mm->sm_priv == NULL) {
+          return 0;
+     }
+     page->pra_vaddr = addr;
+     SetPageSwappable(page);
      return sm->map_swappable(mm, addr, page, swap_in);
 }
 
+// swap_page_freed - a swappable page is freed, take it off the list of its mm
+void
+swap_page_freed(struct Page *page)
+{
+     list_del(&(page->pra_page_link));
+     ClearPageSwappable(page);
+}
+
 int
 swap_set_unswappable(struct mm_struct *mm, uintptr_t addr)
 {
@@ -95,6 +169,7 @@ swap_out(struct mm_struct *mm, int n, int in_tick)
                   break;
           }          
           //assert(!PageReserved(page));
+          ClearPageSwappable(page);
 
           //cprintf("SWAP: choose victim page 0x%08x\n", page);
           
@@ -102,41 +177,123 @@ swap_out(struct mm_struct *mm, int n, int in_tick)
           pte_t *ptep = get_pte(mm->pgdir, v, 0);
           assert((*ptep & PTE_P) != 0);
 
-          if (swapfs_write( (page->pra_vaddr/PGSIZE+1)<<8, page) != 0) {
+          swap_entry_t entry = swap_alloc();
+          if (entry == 0) {
                     cprintf("SWAP: failed to save\n");
-                    sm->map_swappable(mm, v, page, 0);
-                    continue;
-          }
-          else {
-                    cprintf("swap_out: i %d, store page in vaddr 0x%x to disk swap entry %d\n", i, v, page->pra_vaddr/PGSIZE+1);
-                    *ptep = (page->pra_vaddr/PGSIZE+1)<<8;
-                    free_page(page);
+                    swap_map_swappable(mm, v, page, 0);
+                    break;
           }
-          
+          // unmap the page before saving it: a thread of mm on another cpu
+          // may write to it until the TLB shootdown
+          pte_t pte = *ptep;
+          *ptep = entry;
           tlb_invalidate(mm->pgdir, v);
+
+          bool in_zram = (zram_store(entry, page) == 0);
+          if (!in_zram && swapfs_write(entry, page) != 0) {
+                    cprintf("SWAP: failed to save\n");
+                    *ptep = pte;
+                    swap_free(entry);
+                    swap_map_swappable(mm, v, page, 0);
+                    break;
+          }
+          cprintf("swap_out: i %d, store page in vaddr 0x%x to %s swap entry %d\n", i, v, in_zram ? "zram" : "disk", swap_offset(entry));
+          mm->rss --, mm->swap ++;
+          free_page(page);
      }
      return i;
 }
 
+/* *
+ * swap_reclaim - called by alloc_pages when memory runs out: swap out up to
+ * n pages of the process holding the most resident pages, return how many.
+ * An mm under lock_mm is being changed (dup_mmap, mm_map, a system call
+ * copying to it) and is left alone.
+ * */
+int
+swap_reclaim(int n)
+{
+     struct mm_struct *mm, *victim = NULL;
+     bool intr_flag;
+     if (!swap_init_ok) {
+          return 0;
+     }
+     local_intr_save(intr_flag);
+     {
+          list_entry_t *list = &proc_list, *le = list;
+          while ((le = list_next(le)) != list) {
+               struct proc_struct *proc = le2proc(le, list_link);
+               if ((mm = proc->mm) == NULL || (proc->flags & PF_EXITING) || mm->locked_by != 0
+                   || mm->sm_priv == NULL || list_empty(&(mm->pra_list))) {
+                    continue;
+               }
+               if (victim == NULL || mm->rss > victim->rss) {
+                    victim = mm;
+               }
+          }
+     }
+     local_intr_restore(intr_flag);
+     return (victim != NULL) ? swap_out(victim, n, 0) : 0;
+}
+
+// swap_dup - a new swap entry holding a copy of the page in entry, for fork; 0 if there is no room
+swap_entry_t
+swap_dup(swap_entry_t entry)
+{
+     struct Page *page;
+     swap_entry_t copy;
+     if ((page = alloc_page()) == NULL) {
+          return 0;
+     }
+     if ((copy = swap_alloc()) != 0) {
+          if (zram_copy(entry, page) != 0
+              || (zram_store(copy, page) != 0 && swapfs_write(copy, page) != 0)) {
+               swap_free(copy);
+               copy = 0;
+          }
+     }
+     free_page(page);
+     return copy;
+}
+
 int
 swap_in(struct mm_struct *mm, uintptr_t addr, struct Page **ptr_result)
 {
      struct Page *result = alloc_page();
-     assert(result!=NULL);
+     if (result == NULL) {
+          return -E_NO_MEM;
+     }
 
      pte_t *ptep = get_pte(mm->pgdir, addr, 0);
      // cprintf("SWAP: load ptep %x swap entry %d to vaddr 0x%08x, page %x, No %d\n", ptep, (*ptep)>>8, addr, result, (result-pages));
     
      int r;
-     if ((r = swapfs_read((*ptep), result)) != 0)
+     if ((r = zram_load((*ptep), result)) != 0)
      {
         assert(r!=0);
      }
-     cprintf("swap_in: load disk swap entry %d with swap_page in vadr 0x%x\n", (*ptep)>>8, addr);
+     cprintf("swap_in: load swap entry %d with swap_page in vadr 0x%x\n", (*ptep)>>8, addr);
+     // the page holds the data now, do_pgfault maps it over the entry
+     swap_free(*ptep);
      *ptr_result=result;
      return 0;
 }
 
+// swap_free - the swap entry is no longer referenced by any pte
+void
+swap_free(swap_entry_t entry)
+{
+     size_t offset = swap_offset(entry);
+     bool intr_flag;
+     zram_invalidate(entry);
+     local_intr_save(intr_flag);
+     {
+          assert(swap_map[offset / 32] & (1U << (offset % 32)));
+          swap_map[offset / 32] &= ~(1U << (offset % 32));
+     }
+     local_intr_restore(intr_flag);
+}
+
 
 
 static inline void
@@ -187,7 +344,7 @@ check_swap(void)
         assert(PageProperty(p));
         count ++, total += p->property;
      }
-     assert(total == nr_free_pages());
+     assert(total + nr_free_highpages() == nr_free_pages());
      cprintf("BEGIN check_swap: count %d, total %d\n",count,total);
      
      //now we set the phy pages env     
@@ -198,6 +355,8 @@ check_swap(void)
      assert(check_mm_struct == NULL);
 
      check_mm_struct = mm;
+     // the faults below must be served from the few low pages left free
+     mm->lowmem = 1;
 
      pde_t *pgdir = mm->pgdir = boot_pgdir;
      assert(pgdir[0] == 0);
@@ -261,6 +420,22 @@ check_swap(void)
          free_pages(check_rp[i],1);
      } 
 
+     //drop the swap entries still held by the check pages
+     for (i=0;i<CHECK_VALID_VIR_PAGE_NUM;i++) {
+         pte_t *ptep = get_pte(pgdir, BEING_CHECK_VALID_VADDR + i*0x1000, 0);
+         if (ptep != NULL && *ptep != 0 && !(*ptep & PTE_P)) {
+             swap_free(*ptep);
+             *ptep = 0;
+         }
+     }
+     print_zram_stat();
+
+     // the same vaddr swapped out of two processes gets two slots
+     swap_entry_t entry1 = swap_alloc(), entry2 = swap_alloc();
+     assert(entry1 != 0 && entry2 != 0 && entry1 != entry2);
+     swap_free(entry1);
+     swap_free(entry2);
+
      //free_page(pte2page(*temp_ptep));
     free_page(pde2page(pgdir[0]));
      pgdir[0] = 0;
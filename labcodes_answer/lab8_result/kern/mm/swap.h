@@ -57,7 +57,11 @@ int swap_tick_event(struct mm_struct *mm);
 int swap_map_swappable(struct mm_struct *mm, uintptr_t addr, struct Page *page, int swap_in);
 int swap_set_unswappable(struct mm_struct *mm, uintptr_t addr);
 int swap_out(struct mm_struct *mm, int n, int in_tick);
+int swap_reclaim(int n);
 int swap_in(struct mm_struct *mm, uintptr_t addr, struct Page **ptr_result);
+swap_entry_t swap_dup(swap_entry_t entry);
+void swap_free(swap_entry_t entry);
+void swap_page_freed(struct Page *page);
 
 //#define MEMBER_OFFSET(m,t) ((int)(&((t *)0)->m))
 //#define FROM_MEMBER(m,t,a) ((t *)((char *)(a) - MEMBER_OFFSET(m,t)))
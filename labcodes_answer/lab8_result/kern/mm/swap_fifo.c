@@ -5,6 +5,7 @@
 #include <swap.h>
 #include <swap_fifo.h>
 #include <list.h>
+#include <error.h>
 
 /* [wikipedia]The simplest Page Replacement Algorithm(PRA) is a FIFO algorithm. The first-in, first-out
  * page replacement algorithm is a low-overhead algorithm that requires little book-keeping on
@@ -25,16 +26,15 @@
  *              le2page (in memlayout.h), (in future labs: le2vma (in vmm.h), le2proc (in proc.h),etc.
  */
 
-list_entry_t pra_list_head;
 /*
- * (2) _fifo_init_mm: init pra_list_head and let  mm->sm_priv point to the addr of pra_list_head.
- *              Now, From the memory control struct mm_struct, we can access FIFO PRA
+ * (2) _fifo_init_mm: init the pra list of mm and let  mm->sm_priv point to it: every mm queues
+ *              its own pages. Now, From the memory control struct mm_struct, we can access FIFO PRA
  */
 static int
 _fifo_init_mm(struct mm_struct *mm)
 {     
-     list_init(&pra_list_head);
-     mm->sm_priv = &pra_list_head;
+     list_init(&(mm->pra_list));
+     mm->sm_priv = &(mm->pra_list);
      //cprintf(" mm->sm_priv %x in fifo_init_mm\n",mm->sm_priv);
      return 0;
 }
@@ -70,7 +70,10 @@ _fifo_swap_out_victim(struct mm_struct *mm, struct Page ** ptr_page, int in_tick
      //(2)  assign the value of *ptr_page to the addr of this page
      /* Select the tail */
      list_entry_t *le = head->prev;
-     assert(head!=le);
+     if (le == head) {
+          // nothing of mm left to swap out
+          return -E_NO_MEM;
+     }
      struct Page *p = le2page(le, pra_page_link);
      list_del(le);
      assert(p !=NULL);
@@ -0,0 +1,239 @@
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <inode.h>
+#include <iobuf.h>
+#include <textcache.h>
+
+/* *
+ * All the pages of one file hash to the same list, by the SFS inode number,
+ * so a write only has to look at one list to drop them. The lru list keeps
+ * the pages in the order they were last mapped; when the cache is full, the
+ * first page there that no process maps any more makes room for the new one.
+ * */
+
+#define TEXTCACHE_HASH_SHIFT        6
+#define TEXTCACHE_HASH_LIST_SIZE    (1 << TEXTCACHE_HASH_SHIFT)
+#define textcache_hashfn(ino)       (hash32(ino, TEXTCACHE_HASH_SHIFT))
+
+struct text_page {
+    list_entry_t hash_link;     // the entry linked in text cache hash list
+    list_entry_t lru_link;      // the entry linked in text cache lru list
+    struct fs *fs;              // the file system of the binary
+    uint32_t ino;               // the SFS inode number of the binary
+    off_t offset;               // file offset of the data in the page
+    uintptr_t la;               // user address the page is mapped at
+    size_t size;                // bytes read from the file, the rest of the page is zero
+    struct Page *page;          // the shared page
+};
+
+#define le2tpage(le, member)                \
+    to_struct((le), struct text_page, member)
+
+static list_entry_t hash_list[TEXTCACHE_HASH_LIST_SIZE];
+static list_entry_t lru_list;
+
+// bumped by every invalidation, a page read across one is not cached
+static uint32_t textcache_gen;
+
+static struct textcache_stat tstat;
+
+// textcache_release - drop the reference of the cache on tp's page, and free tp
+static void
+textcache_release(struct text_page *tp) {
+    list_del(&(tp->hash_link));
+    list_del(&(tp->lru_link));
+    if (page_ref_dec(tp->page) == 0) {
+        free_page(tp->page);
+    }
+    kfree(tp);
+    tstat.cached_pages --;
+}
+
+// textcache_lookup - find the cached page, must be called with interrupts disabled
+static struct text_page *
+textcache_lookup(struct fs *fs, uint32_t ino, off_t offset, uintptr_t la, size_t size) {
+    list_entry_t *list = hash_list + textcache_hashfn(ino), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct text_page *tp = le2tpage(le, hash_link);
+        if (tp->fs == fs && tp->ino == ino && tp->offset == offset && tp->la == la && tp->size == size) {
+            return tp;
+        }
+    }
+    return NULL;
+}
+
+// textcache_evict - free the least recently mapped page no process maps any more
+static bool
+textcache_evict(void) {
+    list_entry_t *le = &lru_list;
+    while ((le = list_next(le)) != &lru_list) {
+        struct text_page *tp = le2tpage(le, lru_link);
+        if (page_ref(tp->page) == 1) {
+            textcache_release(tp);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// textcache_shrink - free all the pages only the cache holds
+static size_t
+textcache_shrink(void) {
+    size_t freed = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le = list_next(&lru_list);
+        while (le != &lru_list) {
+            struct text_page *tp = le2tpage(le, lru_link);
+            le = list_next(le);
+            if (page_ref(tp->page) == 1) {
+                textcache_release(tp);
+                freed ++;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return freed;
+}
+
+static struct shrinker textcache_shrinker = {
+    .shrink = textcache_shrink,
+};
+
+void
+textcache_init(void) {
+    int i;
+    for (i = 0; i < TEXTCACHE_HASH_LIST_SIZE; i ++) {
+        list_init(hash_list + i);
+    }
+    list_init(&lru_list);
+    register_shrinker(&textcache_shrinker);
+}
+
+/* *
+ * textcache_get - get the page mapped at la by a read-only segment of the binary node
+ * @offset:  file offset of the first byte of the segment in this page
+ * @off:     page offset of that byte
+ * @size:    bytes of the file in this page
+ *
+ * The page holds the file data at @off and zero around it. It is returned
+ * with one reference for the caller, which maps it and then drops that
+ * reference. NULL means the page can not be cached, the caller loads a
+ * private copy instead.
+ * */
+struct Page *
+textcache_get(struct inode *node, off_t offset, uintptr_t la, size_t off, size_t size) {
+    assert(la % PGSIZE == 0 && off + size <= PGSIZE);
+    if (!check_inode_type(node, sfs_inode)) {
+        return NULL;
+    }
+    struct fs *fs = vop_fs(node);
+    uint32_t ino = vop_info(node, sfs_inode)->ino, gen;
+
+    struct text_page *tp;
+    struct Page *page = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if ((tp = textcache_lookup(fs, ino, offset, la, size)) != NULL) {
+            page = tp->page;
+            page_ref_inc(page);
+            list_del(&(tp->lru_link));
+            list_add_before(&lru_list, &(tp->lru_link));
+            tstat.hits ++;
+        }
+        gen = textcache_gen;
+    }
+    local_intr_restore(intr_flag);
+    if (page != NULL) {
+        return page;
+    }
+
+    if ((tp = kmalloc(sizeof(struct text_page))) == NULL) {
+        return NULL;
+    }
+    if ((page = alloc_highpage()) == NULL) {
+        goto failed_cleanup_tp;
+    }
+    void *kva = kmap(page);
+    memset(kva, 0, PGSIZE);
+    struct iobuf __iob, *iob = iobuf_init(&__iob, kva + off, size, offset);
+    int ret = vop_read(node, iob);
+    kunmap(kva);
+    if (ret != 0 || iobuf_used(iob) != size) {
+        goto failed_cleanup_page;
+    }
+
+    local_intr_save(intr_flag);
+    {
+        struct text_page *found;
+        if ((found = textcache_lookup(fs, ino, offset, la, size)) != NULL) {
+            // another exec of the binary read it first
+            page_ref_inc(found->page);
+            free_page(page);
+            page = found->page;
+            tstat.hits ++;
+        }
+        else {
+            set_page_ref(page, 1);
+            if (gen == textcache_gen && (tstat.cached_pages < TEXTCACHE_MAX_PAGES || textcache_evict())) {
+                tp->fs = fs, tp->ino = ino, tp->offset = offset, tp->la = la, tp->size = size;
+                tp->page = page;
+                page_ref_inc(page);
+                SetPageText(page);
+                list_add(hash_list + textcache_hashfn(ino), &(tp->hash_link));
+                list_add_before(&lru_list, &(tp->lru_link));
+                tstat.cached_pages ++, tstat.misses ++;
+                tp = NULL;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (tp != NULL) {
+        kfree(tp);
+    }
+    return page;
+
+failed_cleanup_page:
+    free_page(page);
+failed_cleanup_tp:
+    kfree(tp);
+    return NULL;
+}
+
+// textcache_invalidate - drop the cached pages of node, called before the file changes
+void
+textcache_invalidate(struct inode *node) {
+    if (!check_inode_type(node, sfs_inode)) {
+        return ;
+    }
+    struct fs *fs = vop_fs(node);
+    uint32_t ino = vop_info(node, sfs_inode)->ino;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = hash_list + textcache_hashfn(ino), *le = list_next(list);
+        while (le != list) {
+            struct text_page *tp = le2tpage(le, hash_link);
+            le = list_next(le);
+            if (tp->fs == fs && tp->ino == ino) {
+                textcache_release(tp);
+            }
+        }
+        textcache_gen ++;
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+textcache_get_stat(struct textcache_stat *stat) {
+    *stat = tstat;
+}
+
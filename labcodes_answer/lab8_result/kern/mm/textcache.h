@@ -0,0 +1,36 @@
+#ifndef __KERN_MM_TEXTCACHE_H__
+#define __KERN_MM_TEXTCACHE_H__
+
+#include <defs.h>
+#include <memlayout.h>
+
+/* *
+ * textcache - the pages of read-only PT_LOAD segments, shared by every
+ * process running the same binary.
+ *
+ * load_icode asks the cache for each page of a read-only segment. A page is
+ * found by the SFS inode number and the file offset it was read from, so it
+ * outlives the in-memory inode; the first exec of a binary reads it from the
+ * disk, later ones just map it read-only. The cache keeps one reference on
+ * each page, every mapping one more, and pages only the cache still holds
+ * are given back by a shrinker. A write or a truncate of the file drops its
+ * pages from the cache; processes running the old text keep their copy.
+ * */
+
+#define TEXTCACHE_MAX_PAGES         512         // never cache more pages than this
+
+struct inode;
+
+struct textcache_stat {
+    size_t cached_pages;        // pages held by the cache
+    size_t hits;                // pages mapped from the cache by exec
+    size_t misses;              // pages read from the disk into the cache
+};
+
+void textcache_init(void);
+struct Page *textcache_get(struct inode *node, off_t offset, uintptr_t la, size_t off, size_t size);
+void textcache_invalidate(struct inode *node);
+void textcache_get_stat(struct textcache_stat *stat);
+
+#endif /* !__KERN_MM_TEXTCACHE_H__ */
+
@@ -55,6 +55,10 @@ mm_create(void) {
         
         set_mm_count(mm, 0);
         sem_init(&(mm->mm_sem), 1);
+        mm->mem_limit = 0;
+        mm->rss = mm->swap = 0;
+        mm->minflt = mm->majflt = mm->copies = 0;
+        mm->lowmem = 0;
     }    
     return mm;
 }
@@ -187,10 +191,119 @@ out:
     return ret;
 }
 
+// mm_unmap_range - unmap the pages of [start, end) and take them off mm's counters
+static void
+mm_unmap_range(struct mm_struct *mm, uintptr_t start, uintptr_t end) {
+    uintptr_t la;
+    for (la = start; la < end; la += PGSIZE) {
+        pte_t *ptep = get_pte(mm->pgdir, la, 0);
+        if (ptep == NULL) {
+            la = ROUNDDOWN(la + PTSIZE, PTSIZE) - PGSIZE;
+        }
+        else if (*ptep & PTE_P) {
+            mm->rss --;
+        }
+        else if (*ptep != 0) {
+            mm->swap --;
+        }
+    }
+    unmap_range(mm->pgdir, start, end);
+}
+
+// mm_unmap - remove the mappings of [addr, addr + len), the vmas cut by the range are split
+int
+mm_unmap(struct mm_struct *mm, uintptr_t addr, size_t len) {
+    uintptr_t start = ROUNDDOWN(addr, PGSIZE), end = ROUNDUP(addr + len, PGSIZE);
+    if (!USER_ACCESS(start, end)) {
+        return -E_INVAL;
+    }
+
+    assert(mm != NULL);
+
+    list_entry_t *list = &(mm->mmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct vma_struct *vma = le2vma(le, list_link);
+        if (vma->vm_end <= start) {
+            continue;
+        }
+        if (vma->vm_start >= end) {
+            break;
+        }
+        if (vma->vm_start < start && end < vma->vm_end) {
+            // a hole in the middle, the upper part becomes a new vma
+            struct vma_struct *nvma;
+            if ((nvma = vma_create(end, vma->vm_end, vma->vm_flags)) == NULL) {
+                return -E_NO_MEM;
+            }
+            vma->vm_end = start;
+            insert_vma_struct(mm, nvma);
+            mm_unmap_range(mm, start, end);
+            break;
+        }
+        if (vma->vm_start < start) {
+            mm_unmap_range(mm, start, vma->vm_end);
+            vma->vm_end = start;
+        }
+        else if (end < vma->vm_end) {
+            mm_unmap_range(mm, vma->vm_start, end);
+            vma->vm_start = end;
+        }
+        else {
+            mm_unmap_range(mm, vma->vm_start, vma->vm_end);
+            le = list_prev(le);
+            list_del(&(vma->list_link));
+            kfree(vma);
+            mm->map_count --;
+        }
+    }
+    mm->mmap_cache = NULL;
+    return 0;
+}
+
+// get_unmapped_area - find a hole of len bytes in the user address space, the highest one first
+uintptr_t
+get_unmapped_area(struct mm_struct *mm, size_t len) {
+    uintptr_t top = USERTOP;
+    list_entry_t *list = &(mm->mmap_list), *le = list;
+    while ((le = list_prev(le)) != list) {
+        struct vma_struct *vma = le2vma(le, list_link);
+        if (top - vma->vm_end >= len) {
+            return top - len;
+        }
+        top = vma->vm_start;
+    }
+    return (top - USERBASE >= len) ? top - len : 0;
+}
+
+// mm_map_swappable - hand the resident pages of mm but the shared ones (text, the time page)
+//                  - to the swap manager
+void
+mm_map_swappable(struct mm_struct *mm) {
+    list_entry_t *list = &(mm->mmap_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct vma_struct *vma = le2vma(le, list_link);
+        uintptr_t la;
+        for (la = vma->vm_start; la < vma->vm_end; la += PGSIZE) {
+            pte_t *ptep = get_pte(mm->pgdir, la, 0);
+            if (ptep == NULL) {
+                la = ROUNDDOWN(la, PTSIZE) + PTSIZE - PGSIZE;
+                continue;
+            }
+            struct Page *page;
+            if ((*ptep & PTE_P) && !PageText(page = pte2page(*ptep)) && page_ref(page) == 1
+                && !PageSwappable(page)) {
+                swap_map_swappable(mm, la, page, 0);
+            }
+        }
+    }
+}
+
 int
 dup_mmap(struct mm_struct *to, struct mm_struct *from) {
     assert(to != NULL && from != NULL);
     list_entry_t *list = &(from->mmap_list), *le = list;
+    size_t copies = 0;
+    int ret;
     while ((le = list_prev(le)) != list) {
         struct vma_struct *vma, *nvma;
         vma = le2vma(le, list_link);
@@ -202,10 +315,15 @@ dup_mmap(struct mm_struct *to, struct mm_struct *from) {
         insert_vma_struct(to, nvma);
 
         bool share = 0;
-        if (copy_range(to->pgdir, from->pgdir, vma->vm_start, vma->vm_end, share) != 0) {
+        if ((ret = copy_range(to->pgdir, from->pgdir, vma->vm_start, vma->vm_end, share)) < 0) {
             return -E_NO_MEM;
         }
+        copies += ret;
     }
+    mm_map_swappable(to);
+    // fork copies every resident page but the shared text, and every swapped out page to a swap entry of its own
+    to->rss = from->rss, to->swap = from->swap, to->copies = copies;
+    to->mem_limit = from->mem_limit;
     return 0;
 }
 
@@ -218,10 +336,26 @@ exit_mmap(struct mm_struct *mm) {
         struct vma_struct *vma = le2vma(le, list_link);
         unmap_range(pgdir, vma->vm_start, vma->vm_end);
     }
-    while ((le = list_next(le)) != list) {
+    // exec may have left page tables outside the vmas, see mm_recycle
+    exit_range(pgdir, USERBASE, USERTOP);
+}
+
+// mm_recycle - empty an mm nobody else uses, for exec: unmap and free every vma,
+//            - but keep the page directory and the page tables for the next program
+void
+mm_recycle(struct mm_struct *mm) {
+    assert(mm != NULL && mm_count(mm) == 1);
+    list_entry_t *list = &(mm->mmap_list), *le;
+    while ((le = list_next(list)) != list) {
         struct vma_struct *vma = le2vma(le, list_link);
-        exit_range(pgdir, vma->vm_start, vma->vm_end);
+        unmap_range(mm->pgdir, vma->vm_start, vma->vm_end);
+        list_del(le);
+        kfree(vma);
     }
+    mm->mmap_cache = NULL;
+    mm->map_count = 0;
+    mm->rss = mm->swap = 0;
+    mm->minflt = mm->majflt = mm->copies = 0;
 }
 
 bool
@@ -229,8 +363,7 @@ copy_from_user(struct mm_struct *mm, void *dst, const void *src, size_t len, boo
     if (!user_mem_check(mm, (uintptr_t)src, len, writable)) {
         return 0;
     }
-    memcpy(dst, src, len);
-    return 1;
+    return __copy_user(dst, src, len);
 }
 
 bool
@@ -238,8 +371,7 @@ copy_to_user(struct mm_struct *mm, void *dst, const void *src, size_t len) {
     if (!user_mem_check(mm, (uintptr_t)dst, len, 1)) {
         return 0;
     }
-    memcpy(dst, src, len);
-    return 1;
+    return __copy_user(dst, src, len);
 }
 
 // vmm_init - initialize virtual memory management
@@ -437,6 +569,13 @@ do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr) {
 
     ret = -E_NO_MEM;
 
+    if (mm->mem_limit != 0) {
+        if (mm->rss >= mm->mem_limit) {
+            cprintf("do_pgfault failed: resident pages reach the limit %d\n", mm->mem_limit);
+            goto failed;
+        }
+    }
+
     pte_t *ptep=NULL;
     /*LAB3 EXERCISE 1: YOUR CODE
     * Maybe you want help comment, BELOW comments can help you finish the code
@@ -505,10 +644,14 @@ do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr) {
     }
     
     if (*ptep == 0) { // if the phy addr isn't exist, then alloc a page & map the phy addr with logical addr
-        if (pgdir_alloc_page(mm->pgdir, addr, perm) == NULL) {
+        struct Page *page = mm->lowmem ? pgdir_alloc_lowpage(mm->pgdir, addr, perm)
+                                       : pgdir_alloc_page(mm->pgdir, addr, perm);
+        if (page == NULL) {
             cprintf("pgdir_alloc_page in do_pgfault failed\n");
             goto failed;
         }
+        swap_map_swappable(mm, addr, page, 0);
+        mm->rss ++, mm->minflt ++;
     }
     else {
         struct Page *page=NULL;
@@ -537,12 +680,25 @@ do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr) {
        page_insert(mm->pgdir, page, addr, perm);
        swap_map_swappable(mm, addr, page, 1);
        page->pra_vaddr = addr;
+       mm->rss ++, mm->swap --, mm->majflt ++;
    }
    ret = 0;
 failed:
     return ret;
 }
 
+// mm_pgtable_pages - count the page tables mapping the user part of mm
+size_t
+mm_pgtable_pages(struct mm_struct *mm) {
+    size_t i, n = 0;
+    for (i = PDX(USERBASE); i < PDX(USERTOP); i ++) {
+        if (mm->pgdir[i] & PTE_P) {
+            n ++;
+        }
+    }
+    return n;
+}
+
 bool
 user_mem_check(struct mm_struct *mm, uintptr_t addr, size_t len, bool write) {
     if (mm != NULL) {
@@ -577,17 +733,16 @@ copy_string(struct mm_struct *mm, char *dst, const char *src, size_t maxn) {
         if (part > maxn) {
             part = maxn;
         }
-        if (!user_mem_check(mm, (uintptr_t)src, part, 0)) {
+        // the part goes into dst first, a fault in src fails like a bad address
+        if (!copy_from_user(mm, dst, src, part, 0)) {
             return 0;
         }
-        if ((alen = strnlen(src, part)) < part) {
-            memcpy(dst, src, alen + 1);
+        if ((alen = strnlen(dst, part)) < part) {
             return 1;
         }
         if (part == maxn) {
             return 0;
         }
-        memcpy(dst, src, part);
         dst += part, src += part, maxn -= part;
         part = PGSIZE;
     }
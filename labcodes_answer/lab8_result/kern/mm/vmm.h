@@ -35,10 +35,17 @@ struct mm_struct {
     pde_t *pgdir;                  // the PDT of these vma
     int map_count;                 // the count of these vma
     void *sm_priv;                 // the private data for swap manager
+    list_entry_t pra_list;         // the swappable pages of this mm, for the fifo swap manager
     int mm_count;                  // the number ofprocess which shared the mm
     semaphore_t mm_sem;            // mutex for using dup_mmap fun to duplicat the mm 
     int locked_by;                 // the lock owner process's pid
-
+    size_t mem_limit;              // max resident pages, 0 means no limit
+    size_t rss;                    // resident pages mapped by this mm
+    size_t swap;                   // pages of this mm swapped out
+    size_t minflt;                 // page faults served without I/O
+    size_t majflt;                 // page faults that swapped a page in
+    size_t copies;                 // pages copied into this mm by fork
+    bool lowmem;                   // fault pages in from low memory only
 };
 
 struct vma_struct *find_vma(struct mm_struct *mm, uintptr_t addr);
@@ -54,15 +61,20 @@ int mm_map(struct mm_struct *mm, uintptr_t addr, size_t len, uint32_t vm_flags,
 int do_pgfault(struct mm_struct *mm, uint32_t error_code, uintptr_t addr);
 
 int mm_unmap(struct mm_struct *mm, uintptr_t addr, size_t len);
+uintptr_t get_unmapped_area(struct mm_struct *mm, size_t len);
+void mm_map_swappable(struct mm_struct *mm);
 int dup_mmap(struct mm_struct *to, struct mm_struct *from);
 void exit_mmap(struct mm_struct *mm);
-uintptr_t get_unmapped_area(struct mm_struct *mm, size_t len);
+void mm_recycle(struct mm_struct *mm);
+size_t mm_pgtable_pages(struct mm_struct *mm);
 int mm_brk(struct mm_struct *mm, uintptr_t addr, size_t len);
 
 extern volatile unsigned int pgfault_num;
 extern struct mm_struct *check_mm_struct;
 
 bool user_mem_check(struct mm_struct *mm, uintptr_t start, size_t len, bool write);
+bool __copy_user(void *dst, const void *src, size_t len);
+extern char __copy_user_fault[], __copy_user_fixup[];
 bool copy_from_user(struct mm_struct *mm, void *dst, const void *src, size_t len, bool writable);
 bool copy_to_user(struct mm_struct *mm, void *dst, const void *src, size_t len);
 bool copy_string(struct mm_struct *mm, char *dst, const char *src, size_t maxn);
@@ -0,0 +1,459 @@
+#include <defs.h>
+#include <list.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <error.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <pmm.h>
+#include <swap.h>
+#include <swapfs.h>
+#include <zram.h>
+
+/* *
+ * The pool is a set of pages carved into 32-byte chunks. Every stored page
+ * becomes one object: a run of chunks inside a single pool page, starting
+ * with a zobj header followed by the compressed data. Free chunks are
+ * tracked by a small bitmap per pool page.
+ *
+ * Objects are found through a hash of the swap offset, and linked on an
+ * lru list in the order they were stored; the head of that list is the
+ * coldest object, and is the first to be written back to the disk.
+ * */
+
+#define ZRAM_CHUNK_SHIFT            5
+#define ZRAM_CHUNK                  (1 << ZRAM_CHUNK_SHIFT)
+#define ZRAM_PAGE_CHUNKS            (PGSIZE / ZRAM_CHUNK)
+// a page is only kept if it compresses to 3/4 of a page or less (header included)
+#define ZRAM_MAX_CHUNKS             (ZRAM_PAGE_CHUNKS * 3 / 4)
+#define ZRAM_MAX_CLEN               (ZRAM_MAX_CHUNKS * ZRAM_CHUNK - ZRAM_CHUNK)
+// give up making room after writing back this many cold objects
+#define ZRAM_MAX_WRITEBACK          8
+
+#define ZRAM_HASH_SHIFT             10
+#define ZRAM_HASH_LIST_SIZE         (1 << ZRAM_HASH_SHIFT)
+#define zram_hashfn(entry)          (hash32(swap_offset(entry), ZRAM_HASH_SHIFT))
+
+struct zobj {
+    list_entry_t hash_link;     // the entry linked in zram hash list
+    list_entry_t lru_link;      // the entry linked in zram lru list
+    swap_entry_t entry;         // the swap entry this page belongs to
+    uint16_t pidx;              // index of the pool page holding this object
+    uint16_t nchunks;           // chunks used by this object, header included
+    uint16_t clen;              // length of the compressed data
+};
+
+#define le2zobj(le, member)                 \
+    to_struct((le), struct zobj, member)
+
+#define zobj_data(obj)              ((uint8_t *)(obj) + ZRAM_CHUNK)
+
+struct zram_page {
+    uintptr_t kva;                              // kernel virtual address of the pool page
+    uint32_t map[ZRAM_PAGE_CHUNKS / 32];        // bitmap of used chunks
+    int nr_free;                                // number of free chunks
+};
+
+static struct zram_page *zram_pool;
+static size_t zram_pool_pages;
+static size_t zram_hint;                        // pool page to start the next search from
+
+static list_entry_t hash_list[ZRAM_HASH_LIST_SIZE];
+static list_entry_t lru_list;
+
+// bounce page used to write cold objects back to the disk
+static struct Page *zram_bounce;
+
+static struct zram_stat zstat;
+
+/* *
+ * LZ compression
+ *
+ * The format is a stream of sequences, each made of a token byte, literal
+ * bytes and a back reference:
+ *   token:   high 4 bits literal length, low 4 bits match length - 4;
+ *            a field of 15 continues in following bytes, each adding up to
+ *            255, until a byte below 255
+ *   offset:  2 bytes, little endian, distance back to the match
+ * The last sequence has literals only, and ends the stream.
+ * */
+
+#define LZ_MIN_MATCH                4
+#define LZ_HASH_SHIFT               12
+#define LZ_HASH_SIZE                (1 << LZ_HASH_SHIFT)
+#define lz_hash(v)                  (((v) * 2654435761U) >> (32 - LZ_HASH_SHIFT))
+
+// position + 1 of the last occurrence of every hashed 4-byte sequence
+static uint16_t lz_htab[LZ_HASH_SIZE];
+// compressed data is built here before it is known to fit in the pool
+static uint8_t lz_buf[ZRAM_MAX_CLEN];
+
+static inline uint32_t
+lz_read32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+}
+
+// lz_put_len - write the continuation bytes of a length field
+static inline uint8_t *
+lz_put_len(uint8_t *op, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *op ++ = 255;
+    }
+    *op ++ = len;
+    return op;
+}
+
+// lz_emit - emit one sequence, return the new output pointer or NULL if it does not fit
+static uint8_t *
+lz_emit(uint8_t *op, uint8_t *oend, const uint8_t *lit, size_t litlen, size_t off, size_t mlen) {
+    // token + length continuations + literals + offset, rounded up generously
+    if (op + 1 + (litlen / 255 + 1) + litlen + 2 + (mlen / 255 + 1) > oend) {
+        return NULL;
+    }
+    uint8_t *token = op ++;
+    size_t ml = (mlen != 0) ? mlen - LZ_MIN_MATCH : 0;
+    *token = ((litlen < 15 ? litlen : 15) << 4) | (ml < 15 ? ml : 15);
+    if (litlen >= 15) {
+        op = lz_put_len(op, litlen - 15);
+    }
+    memcpy(op, lit, litlen);
+    op += litlen;
+    if (mlen != 0) {
+        *op ++ = off & 0xFF;
+        *op ++ = (off >> 8) & 0xFF;
+        if (ml >= 15) {
+            op = lz_put_len(op, ml - 15);
+        }
+    }
+    return op;
+}
+
+// lz_compress - compress len bytes from src into dst, return the compressed length or 0 if it exceeds cap
+static size_t
+lz_compress(const uint8_t *src, size_t len, uint8_t *dst, size_t cap) {
+    uint8_t *op = dst, *oend = dst + cap;
+    size_t ip = 0, anchor = 0;
+    memset(lz_htab, 0, sizeof(lz_htab));
+    while (ip + LZ_MIN_MATCH <= len) {
+        uint32_t seq = lz_read32(src + ip);
+        uint32_t h = lz_hash(seq);
+        size_t ref = lz_htab[h];
+        lz_htab[h] = ip + 1;
+        if (ref == 0 || lz_read32(src + (-- ref)) != seq) {
+            ip ++;
+            continue;
+        }
+        size_t mlen = LZ_MIN_MATCH;
+        while (ip + mlen < len && src[ref + mlen] == src[ip + mlen]) {
+            mlen ++;
+        }
+        if ((op = lz_emit(op, oend, src + anchor, ip - anchor, ip - ref, mlen)) == NULL) {
+            return 0;
+        }
+        ip += mlen, anchor = ip;
+    }
+    if ((op = lz_emit(op, oend, src + anchor, len - anchor, 0, 0)) == NULL) {
+        return 0;
+    }
+    return op - dst;
+}
+
+// lz_get_len - read the continuation bytes of a length field
+static inline const uint8_t *
+lz_get_len(const uint8_t *ip, const uint8_t *iend, size_t *len) {
+    uint8_t b;
+    do {
+        if (ip >= iend) {
+            return NULL;
+        }
+        *len += (b = *ip ++);
+    } while (b == 255);
+    return ip;
+}
+
+// lz_decompress - decompress clen bytes from src into exactly len bytes at dst
+static int
+lz_decompress(const uint8_t *src, size_t clen, uint8_t *dst, size_t len) {
+    const uint8_t *ip = src, *iend = src + clen;
+    uint8_t *op = dst, *oend = dst + len;
+    while (ip < iend) {
+        uint8_t token = *ip ++;
+        size_t litlen = token >> 4, mlen = token & 0xF;
+        if (litlen == 15 && (ip = lz_get_len(ip, iend, &litlen)) == NULL) {
+            return -E_INVAL;
+        }
+        if (ip + litlen > iend || op + litlen > oend) {
+            return -E_INVAL;
+        }
+        memcpy(op, ip, litlen);
+        ip += litlen, op += litlen;
+        if (ip == iend) {
+            break;
+        }
+        if (ip + 2 > iend) {
+            return -E_INVAL;
+        }
+        size_t off = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (mlen == 15 && (ip = lz_get_len(ip, iend, &mlen)) == NULL) {
+            return -E_INVAL;
+        }
+        mlen += LZ_MIN_MATCH;
+        if (off == 0 || off > op - dst || op + mlen > oend) {
+            return -E_INVAL;
+        }
+        // byte by byte: the match may overlap the bytes being written
+        const uint8_t *ref = op - off;
+        while (mlen -- > 0) {
+            *op ++ = *ref ++;
+        }
+    }
+    return (op == oend) ? 0 : -E_INVAL;
+}
+
+/* *
+ * pool management
+ * */
+
+static inline bool
+chunk_used(struct zram_page *zp, int c) {
+    return (zp->map[c >> 5] >> (c & 31)) & 1;
+}
+
+static void
+chunk_set(struct zram_page *zp, int start, int n, bool used) {
+    int c;
+    for (c = start; c < start + n; c ++) {
+        if (used) {
+            zp->map[c >> 5] |= (1 << (c & 31));
+        }
+        else {
+            zp->map[c >> 5] &= ~(1 << (c & 31));
+        }
+    }
+    zp->nr_free += used ? -n : n;
+}
+
+// zram_page_alloc - find a run of n free chunks in a pool page, return the first chunk or -1
+static int
+zram_page_alloc(struct zram_page *zp, int n) {
+    int c, run = 0;
+    for (c = 0; c < ZRAM_PAGE_CHUNKS; c ++) {
+        if (chunk_used(zp, c)) {
+            run = 0;
+        }
+        else if (++ run == n) {
+            chunk_set(zp, c - n + 1, n, 1);
+            return c - n + 1;
+        }
+    }
+    return -1;
+}
+
+// zram_alloc - allocate an object of n chunks, searching the pool pages from zram_hint
+static struct zobj *
+zram_alloc(int n) {
+    size_t i, pidx = zram_hint;
+    for (i = 0; i < zram_pool_pages; i ++, pidx = (pidx + 1) % zram_pool_pages) {
+        struct zram_page *zp = zram_pool + pidx;
+        int c;
+        if (zp->nr_free >= n && (c = zram_page_alloc(zp, n)) >= 0) {
+            zram_hint = pidx;
+            struct zobj *obj = (struct zobj *)(zp->kva + c * ZRAM_CHUNK);
+            obj->pidx = pidx, obj->nchunks = n;
+            zstat.used_chunks += n;
+            return obj;
+        }
+    }
+    return NULL;
+}
+
+// zram_free - unlink an object and release its chunks
+static void
+zram_free(struct zobj *obj) {
+    struct zram_page *zp = zram_pool + obj->pidx;
+    list_del(&(obj->hash_link));
+    list_del(&(obj->lru_link));
+    zstat.stored_pages --;
+    zstat.compr_bytes -= obj->clen;
+    zstat.used_chunks -= obj->nchunks;
+    chunk_set(zp, ((uintptr_t)obj - zp->kva) >> ZRAM_CHUNK_SHIFT, obj->nchunks, 0);
+}
+
+static struct zobj *
+zram_lookup(swap_entry_t entry) {
+    list_entry_t *list = hash_list + zram_hashfn(entry), *le = list;
+    while ((le = list_next(le)) != list) {
+        struct zobj *obj = le2zobj(le, hash_link);
+        if (obj->entry == entry) {
+            return obj;
+        }
+    }
+    return NULL;
+}
+
+// zram_writeback - move the coldest object to the swap disk
+static int
+zram_writeback(void) {
+    if (list_empty(&lru_list)) {
+        return -E_NO_MEM;
+    }
+    struct zobj *obj = le2zobj(list_next(&lru_list), lru_link);
+    int ret;
+    if ((ret = lz_decompress(zobj_data(obj), obj->clen, page2kva(zram_bounce), PGSIZE)) != 0) {
+        panic("zram: corrupted object for swap entry %08x.\n", obj->entry);
+    }
+    if ((ret = swapfs_write(obj->entry, zram_bounce)) != 0) {
+        return ret;
+    }
+    zstat.writebacks ++;
+    zram_free(obj);
+    return 0;
+}
+
+void
+zram_init(void) {
+    int i;
+    for (i = 0; i < ZRAM_HASH_LIST_SIZE; i ++) {
+        list_init(hash_list + i);
+    }
+    list_init(&lru_list);
+
+    static_assert(sizeof(struct zobj) <= ZRAM_CHUNK);
+    size_t n = npage / ZRAM_POOL_RATIO;
+    if (n > ZRAM_POOL_MAX) {
+        n = ZRAM_POOL_MAX;
+    }
+    if ((zram_bounce = alloc_page()) == NULL
+        || (zram_pool = kmalloc(n * sizeof(struct zram_page))) == NULL) {
+        panic("zram: cannot allocate the pool.\n");
+    }
+    for (zram_pool_pages = 0; zram_pool_pages < n; zram_pool_pages ++) {
+        struct Page *page;
+        if ((page = alloc_page()) == NULL) {
+            break;
+        }
+        struct zram_page *zp = zram_pool + zram_pool_pages;
+        zp->kva = (uintptr_t)page2kva(page);
+        memset(zp->map, 0, sizeof(zp->map));
+        zp->nr_free = ZRAM_PAGE_CHUNKS;
+    }
+    zstat.pool_pages = zram_pool_pages;
+    cprintf("zram: %d pages reserved for the compressed swap pool\n", zram_pool_pages);
+}
+
+// zram_store - compress a page into the pool, return 0 on success, or an error if the caller must use the disk
+int
+zram_store(swap_entry_t entry, struct Page *page) {
+    int ret = -E_NO_MEM, n;
+    void *kva = kmap(page);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct zobj *obj;
+        if ((obj = zram_lookup(entry)) != NULL) {
+            zram_free(obj);
+        }
+        size_t clen = lz_compress(kva, PGSIZE, lz_buf, ZRAM_MAX_CLEN);
+        if (clen == 0) {
+            zstat.rejects ++;
+            ret = -E_TOO_BIG;
+            goto out;
+        }
+        n = ROUNDUP(clen, ZRAM_CHUNK) / ZRAM_CHUNK + 1;
+        int i;
+        for (i = 0; (obj = zram_alloc(n)) == NULL; i ++) {
+            if (i == ZRAM_MAX_WRITEBACK || zram_writeback() != 0) {
+                goto out;
+            }
+        }
+        obj->entry = entry, obj->clen = clen;
+        memcpy(zobj_data(obj), lz_buf, clen);
+        list_add(hash_list + zram_hashfn(entry), &(obj->hash_link));
+        list_add_before(&lru_list, &(obj->lru_link));
+        zstat.stores ++, zstat.stored_pages ++;
+        zstat.compr_bytes += clen;
+        ret = 0;
+    }
+out:
+    local_intr_restore(intr_flag);
+    kunmap(kva);
+    return ret;
+}
+
+// zram_fill - fill a page from the pool, or read it from the disk on a miss; a swap-in drops the object
+static int
+zram_fill(swap_entry_t entry, struct Page *page, bool swap_in) {
+    struct zobj *obj;
+    void *kva = kmap(page);
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if ((obj = zram_lookup(entry)) != NULL) {
+            if (lz_decompress(zobj_data(obj), obj->clen, kva, PGSIZE) != 0) {
+                panic("zram: corrupted object for swap entry %08x.\n", entry);
+            }
+            if (swap_in) {
+                zram_free(obj);
+                zstat.hits ++;
+            }
+        }
+        else if (swap_in) {
+            zstat.misses ++;
+        }
+    }
+    local_intr_restore(intr_flag);
+    kunmap(kva);
+    return (obj != NULL) ? 0 : swapfs_read(entry, page);
+}
+
+// zram_load - fill a page from the pool and drop the object, or read it from the disk on a miss
+int
+zram_load(swap_entry_t entry, struct Page *page) {
+    return zram_fill(entry, page, 1);
+}
+
+// zram_copy - fill a page with the content of entry, which stays where it is
+int
+zram_copy(swap_entry_t entry, struct Page *page) {
+    return zram_fill(entry, page, 0);
+}
+
+// zram_invalidate - the swap entry is no longer referenced, drop its object if any
+void
+zram_invalidate(swap_entry_t entry) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        struct zobj *obj;
+        if ((obj = zram_lookup(entry)) != NULL) {
+            zram_free(obj);
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+zram_get_stat(struct zram_stat *stat) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        *stat = zstat;
+    }
+    local_intr_restore(intr_flag);
+}
+
+void
+print_zram_stat(void) {
+    struct zram_stat stat;
+    zram_get_stat(&stat);
+    size_t ratio = (stat.compr_bytes != 0) ? stat.stored_pages * PGSIZE * 100 / stat.compr_bytes : 0;
+    size_t lookups = stat.hits + stat.misses;
+    size_t hitrate = (lookups != 0) ? stat.hits * 100 / lookups : 0;
+    cprintf("zram: %d pages in %d bytes, ratio %d.%02d, hit rate %d%% (%d/%d), %d written back, %d rejected\n",
+            stat.stored_pages, stat.compr_bytes, ratio / 100, ratio % 100, hitrate, stat.hits, lookups,
+            stat.writebacks, stat.rejects);
+}
+
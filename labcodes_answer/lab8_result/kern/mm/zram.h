@@ -0,0 +1,42 @@
+#ifndef __KERN_MM_ZRAM_H__
+#define __KERN_MM_ZRAM_H__
+
+#include <defs.h>
+#include <memlayout.h>
+
+/* *
+ * zram - a compressed in-memory swap tier in front of SWAP_DEV_NO.
+ *
+ * swap_out first tries to LZ-compress the victim page into a pool of pages
+ * reserved at boot (1/ZRAM_POOL_RATIO of the physical memory). Pages that
+ * do not compress well enough go straight to the swap disk, and when the
+ * pool is full the coldest (least recently stored) objects are written back
+ * to the disk to make room. swap_in looks up the pool first and only reads
+ * the disk on a miss.
+ * */
+
+#define ZRAM_POOL_RATIO             16          // the pool uses 1/16 of the physical pages
+#define ZRAM_POOL_MAX               4096        // but never more than 16MB
+
+struct zram_stat {
+    size_t pool_pages;          // pages reserved for the pool
+    size_t used_chunks;         // chunks of the pool in use
+    size_t stored_pages;        // pages currently held in the pool
+    size_t compr_bytes;         // compressed size of those pages
+    size_t stores;              // pages compressed into the pool
+    size_t rejects;             // pages that did not compress, sent to disk
+    size_t writebacks;          // cold pages moved from the pool to disk
+    size_t hits;                // swap_in served by the pool
+    size_t misses;              // swap_in served by the disk
+};
+
+void zram_init(void);
+int zram_store(swap_entry_t entry, struct Page *page);
+int zram_load(swap_entry_t entry, struct Page *page);
+int zram_copy(swap_entry_t entry, struct Page *page);
+void zram_invalidate(swap_entry_t entry);
+void zram_get_stat(struct zram_stat *stat);
+void print_zram_stat(void);
+
+#endif /* !__KERN_MM_ZRAM_H__ */
+
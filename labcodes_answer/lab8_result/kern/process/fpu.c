@@ -0,0 +1,155 @@
+#include <defs.h>
+#include <x86.h>
+#include <mmu.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <error.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <proc.h>
+#include <fpu.h>
+
+#define CPUID_FXSR                  (1 << 24)   // cpuid(1).edx: FXSAVE/FXRSTOR
+#define CPUID_SSE                   (1 << 25)   // cpuid(1).edx: SSE
+
+#ifndef CONFIG_SMP
+struct proc_struct *fpu_owner = NULL;
+#endif
+
+static bool fpu_ok = 0;
+
+// the FXSAVE image of a freshly initialized FPU, the first state of every process
+static uint8_t fpu_init_state[FPU_STATE_SIZE] __attribute__((aligned(FPU_STATE_ALIGN)));
+
+// fpu_state - the 16 bytes aligned FXSAVE area of proc
+static inline void *
+fpu_state(struct proc_struct *proc) {
+    return (void *)ROUNDUP((uintptr_t)proc->fpu, FPU_STATE_ALIGN);
+}
+
+// fpu_alloc - kmalloc only aligns to 8 bytes, leave room to align the area
+static void *
+fpu_alloc(void) {
+    return kmalloc(FPU_STATE_SIZE + FPU_STATE_ALIGN - 8);
+}
+
+void
+fpu_init(void) {
+    uint32_t edx;
+    cpuid(1, NULL, NULL, NULL, &edx);
+    if (!(edx & CPUID_FXSR)) {
+        // no FXSAVE, every FPU instruction traps and kills the process
+        lcr0(rcr0() | CR0_EM);
+        cprintf("fpu: no fxsave, x87/SSE disabled.\n");
+        return ;
+    }
+    uintptr_t cr4 = rcr4() | CR4_OSFXSR;
+    if (edx & CPUID_SSE) {
+        cr4 |= CR4_OSXMMEXCPT;
+    }
+    lcr4(cr4);
+    lcr0((rcr0() & ~CR0_EM) | CR0_MP | CR0_NE);
+    clts();
+    fninit();
+    fxsave(fpu_init_state);
+    stts();
+    fpu_ok = 1;
+    cprintf("fpu: lazy fxsave switching enabled%s.\n", (edx & CPUID_SSE) ? ", sse" : "");
+}
+
+#ifdef CONFIG_SMP
+// fpu_init_ap - set up the FPU of an AP like fpu_init did on the boot cpu
+void
+fpu_init_ap(void) {
+    uint32_t edx;
+    if (!fpu_ok) {
+        lcr0(rcr0() | CR0_EM);
+        return ;
+    }
+    cpuid(1, NULL, NULL, NULL, &edx);
+    lcr4(rcr4() | CR4_OSFXSR | ((edx & CPUID_SSE) ? CR4_OSXMMEXCPT : 0));
+    lcr0((rcr0() & ~CR0_EM) | CR0_MP | CR0_NE);
+    stts();
+}
+
+// fpu_save - proc, the owner, is switched out: save its state and leave the FPU to nobody
+void
+fpu_save(struct proc_struct *proc) {
+    assert(proc == fpu_owner);
+    fxsave(fpu_state(proc));
+    fpu_owner = NULL;
+}
+#endif
+
+// fpu_trap - handle #NM: give the FPU to current
+int
+fpu_trap(void) {
+    if (!fpu_ok) {
+        return -E_INVAL;
+    }
+    assert(current != NULL && current != fpu_owner);
+    if (current->fpu == NULL) {
+        void *area;
+        if ((area = fpu_alloc()) == NULL) {
+            return -E_NO_MEM;
+        }
+        current->fpu = area;
+        memcpy(fpu_state(current), fpu_init_state, FPU_STATE_SIZE);
+    }
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        clts();
+        if (fpu_owner != NULL) {
+            fxsave(fpu_state(fpu_owner));
+        }
+        fxrstor(fpu_state(current));
+        fpu_owner = current;
+    }
+    local_intr_restore(intr_flag);
+    return 0;
+}
+
+// fpu_fork - the child proc starts with a copy of the FPU state of parent
+int
+fpu_fork(struct proc_struct *proc, struct proc_struct *parent) {
+    assert(proc->fpu == NULL);
+    if (parent->fpu == NULL) {
+        return 0;
+    }
+    if ((proc->fpu = fpu_alloc()) == NULL) {
+        return -E_NO_MEM;
+    }
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (parent == fpu_owner) {
+            assert(parent == current);
+            fxsave(fpu_state(parent));
+        }
+        memcpy(fpu_state(proc), fpu_state(parent), FPU_STATE_SIZE);
+    }
+    local_intr_restore(intr_flag);
+    return 0;
+}
+
+// fpu_free - drop the FPU state of proc, on exit and exec
+void
+fpu_free(struct proc_struct *proc) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (proc == fpu_owner) {
+            fpu_owner = NULL;
+            if (proc == current) {
+                stts();
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (proc->fpu != NULL) {
+        kfree(proc->fpu);
+        proc->fpu = NULL;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef __KERN_PROCESS_FPU_H__
+#define __KERN_PROCESS_FPU_H__
+
+#include <defs.h>
+#include <x86.h>
+#include <mmu.h>
+#include <smp.h>
+
+/* *
+ * fpu - lazy x87/SSE context switching.
+ *
+ * The FPU registers hold the state of fpu_owner. CR0.TS is clear only while
+ * fpu_owner runs, so the first FPU instruction of any other process traps
+ * with #NM (T_DEVICE); fpu_trap then saves the owner's state into its
+ * FXSAVE area and loads the state of current, which becomes the owner. A
+ * process gets its FXSAVE area on its first FPU instruction, so processes
+ * that never touch the FPU pay neither the memory nor the save/restore.
+ *
+ * With several cpus each one has an fpu_owner, and the owner's state is
+ * saved when it is switched out: it may go on on another cpu, which can not
+ * reach these registers. Only the restore stays lazy there.
+ * */
+
+#define FPU_STATE_SIZE              512         // size of the FXSAVE area
+#define FPU_STATE_ALIGN             16          // FXSAVE needs a 16 bytes aligned area
+
+struct proc_struct;
+
+#ifdef CONFIG_SMP
+#define fpu_owner                   (mycpu()->fpu_owner)
+void fpu_init_ap(void);
+void fpu_save(struct proc_struct *proc);
+#else
+extern struct proc_struct *fpu_owner;
+#endif
+
+void fpu_init(void);
+int fpu_trap(void);
+int fpu_fork(struct proc_struct *proc, struct proc_struct *parent);
+void fpu_free(struct proc_struct *proc);
+
+static inline void
+stts(void) {
+    lcr0(rcr0() | CR0_TS);
+}
+
+// fpu_switch - called by proc_run before switching from prev to next, CR0 is only
+//            - written when the FPU owner is switched out or in
+static inline void
+fpu_switch(struct proc_struct *prev, struct proc_struct *next) {
+    if (prev == fpu_owner) {
+#ifdef CONFIG_SMP
+        fpu_save(prev);
+#endif
+        stts();
+    }
+    else if (next == fpu_owner) {
+        clts();
+    }
+}
+
+#endif /* !__KERN_PROCESS_FPU_H__ */
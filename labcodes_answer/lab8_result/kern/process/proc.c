@@ -15,6 +15,16 @@
 #include <fs.h>
 #include <vfs.h>
 #include <sysfile.h>
+#include <procinfo.h>
+#include <spawn.h>
+#include <file.h>
+#include <textcache.h>
+#include <fpu.h>
+#include <sysuring.h>
+#include <strace.h>
+#include <sig.h>
+#include <clock.h>
+#include <time.h>
 
 /* ------------- process/thread mechanism design&implementation -------------
 (an simplified Linux process/thread mechanism )
@@ -72,12 +82,16 @@ list_entry_t proc_list;
 // has list for process set based on pid
 static list_entry_t hash_list[HASH_LIST_SIZE];
 
+#ifndef CONFIG_SMP
 // idle proc
 struct proc_struct *idleproc = NULL;
+#endif
 // init proc
 struct proc_struct *initproc = NULL;
+#ifndef CONFIG_SMP
 // current proc
 struct proc_struct *current = NULL;
+#endif
 
 static int nr_process = 0;
 
@@ -85,10 +99,57 @@ void kernel_thread_entry(void);
 void forkrets(struct trapframe *tf);
 void switch_to(struct context *from, struct context *to);
 
+// freed proc structs (linked by list_link) and kernel stacks (linked by the
+// page_link of their first page), kept for the next do_fork
+#define PROC_CACHE_MAX          32
+static list_entry_t proc_cache, kstack_cache;
+static int nr_proc_cache = 0, nr_kstack_cache = 0;
+
+// proc_cache_shrink - free all cached proc structs and kernel stacks
+static size_t
+proc_cache_shrink(void) {
+    size_t freed = 0;
+    list_entry_t *le;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        while ((le = list_next(&proc_cache)) != &proc_cache) {
+            list_del(le);
+            kfree(le2proc(le, list_link));
+        }
+        while ((le = list_next(&kstack_cache)) != &kstack_cache) {
+            list_del(le);
+            free_pages(le2page(le, page_link), KSTACKPAGE);
+            freed += KSTACKPAGE;
+        }
+        nr_proc_cache = nr_kstack_cache = 0;
+    }
+    local_intr_restore(intr_flag);
+    return freed;
+}
+
+static struct shrinker proc_shrinker = {
+    .shrink = proc_cache_shrink,
+};
+
 // alloc_proc - alloc a proc_struct and init all fields of proc_struct
 static struct proc_struct *
 alloc_proc(void) {
-    struct proc_struct *proc = kmalloc(sizeof(struct proc_struct));
+    struct proc_struct *proc = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le;
+        if ((le = list_next(&proc_cache)) != &proc_cache) {
+            list_del(le);
+            nr_proc_cache --;
+            proc = le2proc(le, list_link);
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (proc == NULL) {
+        proc = kmalloc(sizeof(struct proc_struct));
+    }
     if (proc != NULL) {
     //LAB4:EXERCISE1 YOUR CODE
     /*
@@ -127,17 +188,52 @@ alloc_proc(void) {
         memset(proc->name, 0, PROC_NAME_LEN);
         proc->wait_state = 0;
         proc->cptr = proc->optr = proc->yptr = NULL;
+        list_init(&(proc->zombie_list));
+        list_init(&(proc->zombie_link));
+        proc->wait_pid = 0;
+        list_init(&(proc->thread_group));
         proc->rq = NULL;
+        proc->cpu = cpunum();
         list_init(&(proc->run_link));
         proc->time_slice = 0;
         proc->lab6_run_pool.left = proc->lab6_run_pool.right = proc->lab6_run_pool.parent = NULL;
         proc->lab6_stride = 0;
         proc->lab6_priority = 0;
+        proc->vruntime = 0;
+        proc->mlfq_level = 0;
+        proc->mlfq_gen = 0;
+        proc->policy = SCHED_NORMAL;
+        proc->rt_priority = 0;
+        proc->rt_runtime = proc->rt_period = proc->rt_budget = proc->rt_deadline = 0;
         proc->filesp = NULL;
+        proc->fpu = NULL;
+        proc->uring = NULL;
+        proc->syscalls = 0;
+        proc->trace = NULL;
+        proc->sig_pending = proc->sig_blocked = 0;
+        proc->sig_actions = NULL;
     }
     return proc;
 }
 
+// free_proc - put a proc_struct back into the cache, or kfree it when the cache is full
+static void
+free_proc(struct proc_struct *proc) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (nr_proc_cache < PROC_CACHE_MAX) {
+            list_add(&proc_cache, &(proc->list_link));
+            nr_proc_cache ++;
+            proc = NULL;
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (proc != NULL) {
+        kfree(proc);
+    }
+}
+
 // set_proc_name - set the name of proc
 char *
 set_proc_name(struct proc_struct *proc, const char *name) {
@@ -169,6 +265,7 @@ set_links(struct proc_struct *proc) {
 static void
 remove_links(struct proc_struct *proc) {
     list_del(&(proc->list_link));
+    list_del_init(&(proc->zombie_link));
     if (proc->optr != NULL) {
         proc->optr->yptr = proc->yptr;
     }
@@ -181,43 +278,47 @@ remove_links(struct proc_struct *proc) {
     nr_process --;
 }
 
-// get_pid - alloc a unique pid for process
+// pid_map - bit n is set while pid n is in use, pid 0 always belongs to idleproc
+#define PID_MAP_WORDS           (MAX_PID / 32)
+static uint32_t pid_map[PID_MAP_WORDS] = {1};
+
+// get_pid - alloc a unique pid for process, the first free one after the last pid given out
 static int
 get_pid(void) {
     static_assert(MAX_PID > MAX_PROCESS);
-    struct proc_struct *proc;
-    list_entry_t *list = &proc_list, *le;
-    static int next_safe = MAX_PID, last_pid = MAX_PID;
-    if (++ last_pid >= MAX_PID) {
-        last_pid = 1;
-        goto inside;
-    }
-    if (last_pid >= next_safe) {
-    inside:
-        next_safe = MAX_PID;
-    repeat:
-        le = list;
-        while ((le = list_next(le)) != list) {
-            proc = le2proc(le, list_link);
-            if (proc->pid == last_pid) {
-                if (++ last_pid >= next_safe) {
-                    if (last_pid >= MAX_PID) {
-                        last_pid = 1;
-                    }
-                    next_safe = MAX_PID;
-                    goto repeat;
-                }
-            }
-            else if (proc->pid > last_pid && next_safe > proc->pid) {
-                next_safe = proc->pid;
-            }
-        }
-    }
+    static_assert(MAX_PID % 32 == 0);
+    static int last_pid = 0;
+    int start = last_pid + 1, i;
+    if (start >= MAX_PID) {
+        start = 1;
+    }
+    int w = start / 32;
+    uint32_t free = ~pid_map[w] & (~0U << (start % 32));
+    // at most one full turn, back to the low bits of the first word
+    for (i = 0; free == 0 && i < PID_MAP_WORDS; i ++) {
+        w = (w + 1) % PID_MAP_WORDS;
+        free = ~pid_map[w];
+    }
+    assert(free != 0);
+    last_pid = w * 32 + bsf(free);
+    pid_map[w] |= (1U << (last_pid % 32));
     return last_pid;
 }
 
+// put_pid - free a pid given out by get_pid
+static void
+put_pid(int pid) {
+    assert(0 < pid && pid < MAX_PID);
+    pid_map[pid / 32] &= ~(1U << (pid % 32));
+}
+
 // proc_run - make process "proc" running on cpu
 // NOTE: before call switch_to, should load  base addr of "proc"'s new PDT
+//       a kernel thread (mm == NULL) keeps the PDT of the previous process, like the
+//       active_mm of linux, and cr3 is only reloaded (flushing the TLB) for a different mm.
+//       An mm is only freed by its last user after loading boot_cr3, so the PDT a kernel
+//       thread borrows is never freed under it. With several cpus it could be, by a thread
+//       of the process on another cpu, and a kernel thread runs on boot_cr3 instead.
 void
 proc_run(struct proc_struct *proc) {
     if (proc != current) {
@@ -227,7 +328,18 @@ proc_run(struct proc_struct *proc) {
         {
             current = proc;
             load_esp0(next->kstack + KSTACKSIZE);
-            lcr3(next->cr3);
+#ifdef CONFIG_SMP
+            next->cpu = cpunum();
+            uintptr_t cr3 = (next->mm != NULL) ? next->cr3 : boot_cr3;
+            if (cr3 != rcr3()) {
+                lcr3(cr3);
+            }
+#else
+            if (next->mm != NULL && next->cr3 != rcr3()) {
+                lcr3(next->cr3);
+            }
+#endif
+            fpu_switch(prev, next);
             switch_to(&(prev->context), &(next->context));
         }
         local_intr_restore(intr_flag);
@@ -239,6 +351,12 @@ proc_run(struct proc_struct *proc) {
 //       after switch_to, the current proc will execute here.
 static void
 forkret(void) {
+#ifdef CONFIG_SMP
+    // a new process leaves the kernel here, not through trap
+    if (!trap_in_kernel(current->tf)) {
+        kernel_unlock();
+    }
+#endif
     forkrets(current->tf);
 }
 
@@ -269,6 +387,21 @@ find_proc(int pid) {
     return NULL;
 }
 
+// proc_controlled - may current change proc: it is current, a thread of its group, or a descendant
+bool
+proc_controlled(struct proc_struct *proc) {
+    struct proc_struct *p;
+    if (proc == current || (proc->mm != NULL && proc->mm == current->mm)) {
+        return 1;
+    }
+    for (p = proc->parent; p != NULL; p = p->parent) {
+        if (p == current) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // kernel_thread - create a kernel thread using "fn" function
 // NOTE: the contents of temp trapframe tf will be copied to 
 //       proc->tf in do_fork-->copy_thread function
@@ -284,10 +417,37 @@ kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags) {
     return do_fork(clone_flags | CLONE_VM, 0, &tf);
 }
 
+// proc_reparent_init - give proc, a kernel thread current just started, to initproc, which reaps it
+void
+proc_reparent_init(struct proc_struct *proc) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        remove_links(proc);
+        proc->parent = initproc;
+        set_links(proc);
+    }
+    local_intr_restore(intr_flag);
+}
+
 // setup_kstack - alloc pages with size KSTACKPAGE as process kernel stack
 static int
 setup_kstack(struct proc_struct *proc) {
-    struct Page *page = alloc_pages(KSTACKPAGE);
+    struct Page *page = NULL;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *le;
+        if ((le = list_next(&kstack_cache)) != &kstack_cache) {
+            list_del(le);
+            nr_kstack_cache --;
+            page = le2page(le, page_link);
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (page == NULL) {
+        page = alloc_pages(KSTACKPAGE);
+    }
     if (page != NULL) {
         proc->kstack = (uintptr_t)page2kva(page);
         return 0;
@@ -298,7 +458,20 @@ setup_kstack(struct proc_struct *proc) {
 // put_kstack - free the memory space of process kernel stack
 static void
 put_kstack(struct proc_struct *proc) {
-    free_pages(kva2page((void *)(proc->kstack)), KSTACKPAGE);
+    struct Page *page = kva2page((void *)(proc->kstack));
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (nr_kstack_cache < PROC_CACHE_MAX) {
+            list_add(&kstack_cache, &(page->page_link));
+            nr_kstack_cache ++;
+            page = NULL;
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (page != NULL) {
+        free_pages(page, KSTACKPAGE);
+    }
 }
 
 // setup_pgdir - alloc one page as PDT
@@ -423,6 +596,22 @@ put_fs(struct proc_struct *proc) {
     }
 }
 
+// vfork_release - a vfork child execs or exits, let its parent run again
+static void
+vfork_release(struct proc_struct *proc) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        if (proc->flags & PF_VFORK) {
+            proc->flags &= ~PF_VFORK;
+            if (proc->parent->wait_state == WT_VFORK) {
+                wakeup_proc(proc->parent);
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
 /* do_fork -     parent process for a new child process
  * @clone_flags: used to guide how to clone the child process
  * @stack:       the parent's user stack pointer. if stack==0, It means to fork a kernel thread.
@@ -477,12 +666,24 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
     proc->parent = current;
     assert(current->wait_state == 0);
 
+    // a thread or a vfork child shares the address space of its parent
+    if ((clone_flags & (CLONE_THREAD | CLONE_VFORK)) && !(clone_flags & CLONE_VM)) {
+        ret = -E_INVAL;
+        goto bad_fork_cleanup_proc;
+    }
+
     if (setup_kstack(proc) != 0) {
         goto bad_fork_cleanup_proc;
     }
-    if (copy_fs(clone_flags, proc) != 0) { //for LAB8
+    if (fpu_fork(proc, current) != 0) {
         goto bad_fork_cleanup_kstack;
     }
+    if (signal_fork(proc, current) != 0) {
+        goto bad_fork_cleanup_fpu;
+    }
+    if (copy_fs(clone_flags, proc) != 0) { //for LAB8
+        goto bad_fork_cleanup_signal;
+    }
     if (copy_mm(clone_flags, proc) != 0) {
         goto bad_fork_cleanup_fs;
     }
@@ -494,6 +695,12 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
         proc->pid = get_pid();
         hash_proc(proc);
         set_links(proc);
+        if (clone_flags & CLONE_THREAD) {
+            list_add_before(&(current->thread_group), &(proc->thread_group));
+        }
+        if (clone_flags & CLONE_VFORK) {
+            proc->flags |= PF_VFORK;
+        }
 
     }
     local_intr_restore(intr_flag);
@@ -501,15 +708,31 @@ do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf) {
     wakeup_proc(proc);
 
     ret = proc->pid;
+    if (clone_flags & CLONE_VFORK) {
+        // the child runs on our mm and user stack, sleep until it is done with them
+        local_intr_save(intr_flag);
+        while ((proc->flags & PF_VFORK) && !(current->flags & PF_EXITING)) {
+            current->state = PROC_SLEEPING;
+            current->wait_state = WT_VFORK;
+            local_intr_restore(intr_flag);
+            schedule();
+            local_intr_save(intr_flag);
+        }
+        local_intr_restore(intr_flag);
+    }
 fork_out:
     return ret;
 
 bad_fork_cleanup_fs:  //for LAB8
     put_fs(proc);
+bad_fork_cleanup_signal:
+    signal_free(proc);
+bad_fork_cleanup_fpu:
+    fpu_free(proc);
 bad_fork_cleanup_kstack:
     put_kstack(proc);
 bad_fork_cleanup_proc:
-    kfree(proc);
+    free_proc(proc);
     goto fork_out;
 }
 
@@ -536,30 +759,41 @@ do_exit(int error_code) {
         }
         current->mm = NULL;
     }
+    uring_release(current);
     put_fs(current); //for LAB8
+    fpu_free(current);
+    signal_free(current);
+    vfork_release(current);
+    // give back the cpu reservation, if any
+    sched_setscheduler(current, SCHED_NORMAL, NULL);
     current->state = PROC_ZOMBIE;
     current->exit_code = error_code;
     
     bool intr_flag;
-    struct proc_struct *proc;
+    struct proc_struct *proc, *oldest;
     local_intr_save(intr_flag);
     {
+        list_del_init(&(current->thread_group));
         proc = current->parent;
-        if (proc->wait_state == WT_CHILD) {
+        list_add_before(&(proc->zombie_list), &(current->zombie_link));
+        if (proc->wait_state == WT_CHILD && (proc->wait_pid == 0 || proc->wait_pid == current->pid)) {
             wakeup_proc(proc);
         }
-        while (current->cptr != NULL) {
-            proc = current->cptr;
-            current->cptr = proc->optr;
-    
-            proc->yptr = NULL;
-            if ((proc->optr = initproc->cptr) != NULL) {
-                initproc->cptr->yptr = proc;
+        signal_send(proc, SIGCHLD);
+        if ((proc = current->cptr) != NULL) {
+            // give all children to initproc, the sibling chain and the zombie list move as a whole
+            for (; proc != NULL; proc = proc->optr) {
+                proc->parent = initproc;
+                oldest = proc;
             }
-            proc->parent = initproc;
-            initproc->cptr = proc;
-            if (proc->state == PROC_ZOMBIE) {
-                if (initproc->wait_state == WT_CHILD) {
+            if ((oldest->optr = initproc->cptr) != NULL) {
+                initproc->cptr->yptr = oldest;
+            }
+            initproc->cptr = current->cptr;
+            current->cptr = NULL;
+            if (!list_empty(&(current->zombie_list))) {
+                list_splice_before(&(initproc->zombie_list), &(current->zombie_list));
+                if (initproc->wait_state == WT_CHILD && initproc->wait_pid == 0) {
                     wakeup_proc(initproc);
                 }
             }
@@ -585,9 +819,9 @@ load_icode_read(int fd, void *buf, size_t len, off_t offset) {
 }
 
 // load_icode -  called by sys_exec-->do_execve
-  
+//             - mm is the recycled mm of the old program, or NULL to create a new one
 static int
-load_icode(int fd, int argc, char **kargv) {
+load_icode(int fd, int argc, char **kargv, struct mm_struct *mm) {
     /* LAB8:EXERCISE2 YOUR CODE  HINT:how to load the file with handler fd  in to process's memory? how to setup argc/argv?
      * MACROs or Functions:
      *  mm_create        - create a mm
@@ -619,15 +853,17 @@ load_icode(int fd, int argc, char **kargv) {
     }
 
     int ret = -E_NO_MEM;
-    struct mm_struct *mm;
-    if ((mm = mm_create()) == NULL) {
-        goto bad_mm;
-    }
-    if (setup_pgdir(mm) != 0) {
-        goto bad_pgdir_cleanup_mm;
+    if (mm == NULL) {
+        if ((mm = mm_create()) == NULL) {
+            goto bad_mm;
+        }
+        if (setup_pgdir(mm) != 0) {
+            goto bad_pgdir_cleanup_mm;
+        }
     }
 
     struct Page *page;
+    struct inode *node = file_inode(fd);
 
     struct elfhdr __elf, *elf = &__elf;
     if ((ret = load_icode_read(fd, elf, sizeof(struct elfhdr), 0)) != 0) {
@@ -672,18 +908,35 @@ load_icode(int fd, int argc, char **kargv) {
 
         end = ph->p_va + ph->p_filesz;
         while (start < end) {
-            if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
-                ret = -E_NO_MEM;
-                goto bad_cleanup_mmap;
+            off = start - la, size = PGSIZE - off;
+            if (end < la + PGSIZE) {
+                size -= la + PGSIZE - end;
             }
-            off = start - la, size = PGSIZE - off, la += PGSIZE;
-            if (end < la) {
-                size -= la - end;
+            if (!(vm_flags & VM_WRITE) && node != NULL
+                && (page = textcache_get(node, offset, la, off, size)) != NULL) {
+                // read-only, share the page with the other processes running this binary
+                ret = page_insert(mm->pgdir, page, la, perm);
+                if (page_ref_dec(page) == 0) {
+                    free_page(page);
+                }
+                if (ret != 0) {
+                    goto bad_cleanup_mmap;
+                }
             }
-            if ((ret = load_icode_read(fd, page2kva(page) + off, size, offset)) != 0) {
-                goto bad_cleanup_mmap;
+            else {
+                if ((page = pgdir_alloc_page(mm->pgdir, la, perm)) == NULL) {
+                    ret = -E_NO_MEM;
+                    goto bad_cleanup_mmap;
+                }
+                void *kva = kmap(page);
+                ret = load_icode_read(fd, kva + off, size, offset);
+                kunmap(kva);
+                if (ret != 0) {
+                    goto bad_cleanup_mmap;
+                }
             }
-            start += size, offset += size;
+            mm->rss ++;
+            start += size, offset += size, la += PGSIZE;
         }
         end = ph->p_va + ph->p_memsz;
 
@@ -696,7 +949,12 @@ load_icode(int fd, int argc, char **kargv) {
             if (end < la) {
                 size -= la - end;
             }
-            memset(page2kva(page) + off, 0, size);
+            // a page of the text cache is zero past the file data already
+            if (!PageText(page)) {
+                void *kva = kmap(page);
+                memset(kva + off, 0, size);
+                kunmap(kva);
+            }
             start += size;
             assert((end < la && start == end) || (end >= la && start == la));
         }
@@ -705,11 +963,14 @@ load_icode(int fd, int argc, char **kargv) {
                 ret = -E_NO_MEM;
                 goto bad_cleanup_mmap;
             }
+            mm->rss ++;
             off = start - la, size = PGSIZE - off, la += PGSIZE;
             if (end < la) {
                 size -= la - end;
             }
-            memset(page2kva(page) + off, 0, size);
+            void *kva = kmap(page);
+            memset(kva + off, 0, size);
+            kunmap(kva);
             start += size;
         }
     }
@@ -719,10 +980,22 @@ load_icode(int fd, int argc, char **kargv) {
     if ((ret = mm_map(mm, USTACKTOP - USTACKSIZE, USTACKSIZE, vm_flags, NULL)) != 0) {
         goto bad_cleanup_mmap;
     }
-    assert(pgdir_alloc_page(mm->pgdir, USTACKTOP-PGSIZE , PTE_USER) != NULL);
-    assert(pgdir_alloc_page(mm->pgdir, USTACKTOP-2*PGSIZE , PTE_USER) != NULL);
-    assert(pgdir_alloc_page(mm->pgdir, USTACKTOP-3*PGSIZE , PTE_USER) != NULL);
-    assert(pgdir_alloc_page(mm->pgdir, USTACKTOP-4*PGSIZE , PTE_USER) != NULL);
+    uintptr_t va;
+    for (va = USTACKTOP - 4 * PGSIZE; va < USTACKTOP; va += PGSIZE) {
+        if (pgdir_alloc_page(mm->pgdir, va, PTE_USER) == NULL) {
+            ret = -E_NO_MEM;
+            goto bad_cleanup_mmap;
+        }
+        mm->rss ++;
+    }
+
+    // the time page of clock_gettime and of the SYSENTER stub, the same page in every process
+    if ((ret = mm_map(mm, TIMEPAGE_VA, PGSIZE, VM_READ, NULL)) != 0) {
+        goto bad_cleanup_mmap;
+    }
+    if ((ret = page_insert(mm->pgdir, clock_timepage(), TIMEPAGE_VA, PTE_U)) != 0) {
+        goto bad_cleanup_mmap;
+    }
     
     mm_count_inc(mm);
     current->mm = mm;
@@ -746,6 +1019,9 @@ load_icode(int fd, int argc, char **kargv) {
     
     stacktop = (uintptr_t)uargv - sizeof(int);
     *(int *)stacktop = argc;
+
+    // the data, bss and stack pages may be swapped out from now on
+    mm_map_swappable(mm);
     
     struct trapframe *tf = current->tf;
     memset(tf, 0, sizeof(struct trapframe));
@@ -760,6 +1036,8 @@ out:
 bad_cleanup_mmap:
     exit_mmap(mm);
 bad_elf_cleanup_pgdir:
+    // a recycled pgdir may still be loaded
+    lcr3(boot_cr3);
     put_pgdir(mm);
 bad_pgdir_cleanup_mm:
     mm_destroy(mm);
@@ -783,10 +1061,14 @@ copy_kargv(struct mm_struct *mm, int argc, char **kargv, const char **argv) {
     }
     for (i = 0; i < argc; i ++) {
         char *buffer;
+        const char *arg;
+        if (!copy_from_user(mm, &arg, argv + i, sizeof(const char *), 0)) {
+            goto failed_cleanup;
+        }
         if ((buffer = kmalloc(EXEC_MAX_ARG_LEN + 1)) == NULL) {
             goto failed_nomem;
         }
-        if (!copy_string(mm, buffer, argv[i], EXEC_MAX_ARG_LEN + 1)) {
+        if (!copy_string(mm, buffer, arg, EXEC_MAX_ARG_LEN + 1)) {
             kfree(buffer);
             goto failed_cleanup;
         }
@@ -835,6 +1117,8 @@ do_execve(const char *name, int argc, const char **argv) {
     }
     path = argv[0];
     unlock_mm(mm);
+    // the ring is in the memory of the old program
+    uring_release(current);
     files_closeall(current->filesp);
 
     /* sysfile_open will check the first argument path, thus we have to use a user-space pointer, and argv[0] may be incorrect */    
@@ -842,25 +1126,39 @@ do_execve(const char *name, int argc, const char **argv) {
     if ((ret = fd = sysfile_open(path, O_RDONLY)) < 0) {
         goto execve_exit;
     }
+    // the new program starts with a clean FPU, and without the handlers of the old one
+    fpu_free(current);
+    signal_exec(current);
+    // the memory limit survives exec, like the other resource limits
+    size_t mem_limit = (mm != NULL) ? mm->mem_limit : 0;
     if (mm != NULL) {
-        lcr3(boot_cr3);
-        if (mm_count_dec(mm) == 0) {
-            exit_mmap(mm);
-            put_pgdir(mm);
-            mm_destroy(mm);
+        if (mm_count(mm) == 1) {
+            // nobody else uses the mm, keep it and its page tables for the new program
+            mm_recycle(mm);
+            mm_count_dec(mm);
+        }
+        else {
+            lcr3(boot_cr3);
+            mm_count_dec(mm);
+            mm = NULL;
         }
         current->mm = NULL;
     }
     ret= -E_NO_MEM;;
-    if ((ret = load_icode(fd, argc, kargv)) != 0) {
+    if ((ret = load_icode(fd, argc, kargv, mm)) != 0) {
         goto execve_exit;
     }
+    current->mm->mem_limit = mem_limit;
     put_kargv(argc, kargv);
     set_proc_name(current, local_name);
+    vfork_release(current);
     return 0;
 
 execve_exit:
     put_kargv(argc, kargv);
+    // nothing to return to, the vfork parent of a spawn finds the error in exit_code
+    current->flags |= PF_EXEC_FAILED;
+    current->exit_code = ret;
     do_exit(ret);
     panic("already exit: %e.\n", ret);
 }
@@ -897,18 +1195,20 @@ repeat:
             }
         }
     }
+    else if (!list_empty(&(current->zombie_list))) {
+        proc = le2proc(list_next(&(current->zombie_list)), zombie_link);
+        goto found;
+    }
     else {
-        proc = current->cptr;
-        for (; proc != NULL; proc = proc->optr) {
-            haskid = 1;
-            if (proc->state == PROC_ZOMBIE) {
-                goto found;
-            }
-        }
+        haskid = (current->cptr != NULL);
     }
     if (haskid) {
+        if (signal_pending(current)) {
+            return -E_INTR;
+        }
         current->state = PROC_SLEEPING;
         current->wait_state = WT_CHILD;
+        current->wait_pid = pid;
         schedule();
         if (current->flags & PF_EXITING) {
             do_exit(-E_KILLED);
@@ -921,18 +1221,53 @@ found:
     if (proc == idleproc || proc == initproc) {
         panic("wait idleproc or initproc.\n");
     }
-    if (code_store != NULL) {
-        *code_store = proc->exit_code;
-    }
+    int exit_code = proc->exit_code;
     local_intr_save(intr_flag);
     {
         unhash_proc(proc);
+        put_pid(proc->pid);
         remove_links(proc);
     }
     local_intr_restore(intr_flag);
+    strace_release(proc);
     put_kstack(proc);
-    kfree(proc);
-    return 0;
+    free_proc(proc);
+
+    int ret = 0;
+    if (code_store != NULL) {
+        lock_mm(mm);
+        {
+            if (!copy_to_user(mm, code_store, &exit_code, sizeof(int))) {
+                ret = -E_INVAL;
+            }
+        }
+        unlock_mm(mm);
+    }
+    return ret;
+}
+
+// kill_proc - set PF_EXITING on a process, and wake it if it sleeps interruptibly
+static void
+kill_proc(struct proc_struct *proc) {
+    proc->flags |= PF_EXITING;
+    if (proc->wait_state & WT_INTERRUPTED) {
+        wakeup_proc(proc);
+    }
+}
+
+// do_exit_group - called by sys_exit, kill the other threads of current's group, then exit
+int
+do_exit_group(int error_code) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = &(current->thread_group), *le = list;
+        while ((le = list_next(le)) != list) {
+            kill_proc(le2proc(le, thread_group));
+        }
+    }
+    local_intr_restore(intr_flag);
+    return do_exit(error_code);
 }
 
 // do_kill - kill process with pid by set this process's flags with PF_EXITING
@@ -941,10 +1276,12 @@ do_kill(int pid) {
     struct proc_struct *proc;
     if ((proc = find_proc(pid)) != NULL) {
         if (!(proc->flags & PF_EXITING)) {
-            proc->flags |= PF_EXITING;
-            if (proc->wait_state & WT_INTERRUPTED) {
-                wakeup_proc(proc);
+            // the whole thread group goes down with it
+            list_entry_t *list = &(proc->thread_group), *le = list;
+            while ((le = list_next(le)) != list) {
+                kill_proc(le2proc(le, thread_group));
             }
+            kill_proc(proc);
             return 0;
         }
         return -E_KILLED;
@@ -952,6 +1289,117 @@ do_kill(int pid) {
     return -E_INVAL;
 }
 
+// do_procinfo - copy the info of the process with the smallest pid >= pid to user space, return its pid
+int
+do_procinfo(int pid, struct procinfo *info) {
+    struct mm_struct *mm = current->mm;
+    struct proc_struct *proc = NULL;
+    struct procinfo __info, *pi = &__info;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        list_entry_t *list = &proc_list, *le = list;
+        while ((le = list_next(le)) != list) {
+            struct proc_struct *p = le2proc(le, list_link);
+            if (p->pid >= pid && (proc == NULL || p->pid < proc->pid)) {
+                proc = p;
+            }
+        }
+        if (proc != NULL) {
+            memset(pi, 0, sizeof(struct procinfo));
+            pi->pid = proc->pid;
+            pi->ppid = (proc->parent != NULL) ? proc->parent->pid : 0;
+            pi->state = proc->state;
+            pi->wait_state = proc->wait_state;
+            pi->runs = proc->runs;
+            pi->syscalls = proc->syscalls;
+            if (proc->mm != NULL) {
+                pi->rss = proc->mm->rss;
+                pi->swap = proc->mm->swap;
+                pi->minflt = proc->mm->minflt;
+                pi->majflt = proc->mm->majflt;
+                pi->copies = proc->mm->copies;
+                pi->ptpages = mm_pgtable_pages(proc->mm);
+                pi->mem_limit = proc->mm->mem_limit;
+            }
+            strncpy(pi->name, proc->name, PROCINFO_NAME_LEN);
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if (proc == NULL) {
+        return -E_BAD_PROC;
+    }
+    int ret = pi->pid;
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, info, pi, sizeof(struct procinfo))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+// do_mmap - map len bytes of anonymous memory at *addr_store, or anywhere if it is 0,
+//         - and store the address chosen back to *addr_store
+int
+do_mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags) {
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL) {
+        panic("kernel thread call mmap!!.\n");
+    }
+    if (addr_store == NULL || len == 0) {
+        return -E_INVAL;
+    }
+
+    int ret = -E_INVAL;
+    uintptr_t addr;
+
+    lock_mm(mm);
+    if (!copy_from_user(mm, &addr, addr_store, sizeof(uintptr_t), 1)) {
+        goto out_unlock;
+    }
+
+    uintptr_t start = ROUNDDOWN(addr, PGSIZE), end = ROUNDUP(addr + len, PGSIZE);
+    addr = start, len = end - start;
+
+    uint32_t vm_flags = VM_READ;
+    if (mmap_flags & MMAP_WRITE) vm_flags |= VM_WRITE;
+    if (mmap_flags & MMAP_STACK) vm_flags |= VM_STACK;
+
+    ret = -E_NO_MEM;
+    if (addr == 0 && (addr = get_unmapped_area(mm, len)) == 0) {
+        goto out_unlock;
+    }
+    if ((ret = mm_map(mm, addr, len, vm_flags, NULL)) == 0) {
+        copy_to_user(mm, addr_store, &addr, sizeof(uintptr_t));
+    }
+
+out_unlock:
+    unlock_mm(mm);
+    return ret;
+}
+
+// do_munmap - remove the mappings of [addr, addr + len) from current's mm
+int
+do_munmap(uintptr_t addr, size_t len) {
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL) {
+        panic("kernel thread call munmap!!.\n");
+    }
+    if (len == 0) {
+        return -E_INVAL;
+    }
+    int ret;
+    lock_mm(mm);
+    {
+        ret = mm_unmap(mm, addr, len);
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
 // kernel_execve - do SYS_exec syscall to exec a user program called by user_main kernel_thread
 static int
 kernel_execve(const char *name, const char **argv) {
@@ -967,6 +1415,146 @@ kernel_execve(const char *name, const char **argv) {
     return ret;
 }
 
+// the arguments of SYS_spawn, copied into the kernel by the parent
+struct spawn_args {
+    char name[PROC_NAME_LEN + 1];
+    bool has_name;
+    int argc;
+    char *kargv[EXEC_MAX_ARG_NUM + 1];
+    int nactions;
+    struct spawn_action actions[SPAWN_MAX_ACTIONS];
+    int ret;                    // error of the child before it reached exec, or of load_icode
+};
+
+// put_spawn_args - free the copies made by do_spawn
+static void
+put_spawn_args(struct spawn_args *sa) {
+    int i;
+    for (i = 0; i < sa->nactions; i ++) {
+        if (sa->actions[i].path != NULL) {
+            kfree((void *)sa->actions[i].path);
+        }
+    }
+    put_kargv(sa->argc, sa->kargv);
+    kfree(sa);
+}
+
+// spawn_main - the child of do_spawn: drop the mm borrowed from the parent,
+//            - apply the file actions and exec
+static int
+spawn_main(void *arg) {
+    struct spawn_args *sa = (struct spawn_args *)arg;
+    struct mm_struct *mm = current->mm;
+    if (mm != NULL) {
+        lcr3(boot_cr3);
+        mm_count_dec(mm);
+        current->mm = NULL;
+        current->cr3 = boot_cr3;
+    }
+
+    int i, ret = 0;
+    for (i = 0; ret >= 0 && i < sa->nactions; i ++) {
+        struct spawn_action *act = sa->actions + i;
+        switch (act->op) {
+        case SPAWN_OPEN:
+            if ((ret = sysfile_open(act->path, act->open_flags)) >= 0 && ret != act->fd) {
+                int fd = ret;
+                sysfile_close(act->fd);
+                ret = sysfile_dup(fd, act->fd);
+                sysfile_close(fd);
+            }
+            break;
+        case SPAWN_DUP2:
+            sysfile_close(act->newfd);
+            ret = sysfile_dup(act->fd, act->newfd);
+            break;
+        case SPAWN_CLOSE:
+            ret = sysfile_close(act->fd);
+            break;
+        default:
+            ret = -E_INVAL;
+        }
+    }
+    if (ret >= 0 && (ret = sysfile_open(sa->kargv[0], O_RDONLY)) >= 0) {
+        sysfile_close(ret);
+        sa->kargv[sa->argc] = NULL;
+        // does not return unless the exec fails
+        ret = kernel_execve(sa->has_name ? sa->name : NULL, (const char **)sa->kargv);
+    }
+    sa->ret = ret;
+    return ret;
+}
+
+// do_spawn - create a process running a new program directly, without copying current's mm.
+//          - the child borrows the mm until it execs, like a vfork child.
+int
+do_spawn(const char *name, int argc, const char **argv, const struct spawn_action *actions, int nactions) {
+    struct mm_struct *mm = current->mm;
+    if (!(argc >= 1 && argc <= EXEC_MAX_ARG_NUM) || !(nactions >= 0 && nactions <= SPAWN_MAX_ACTIONS)) {
+        return -E_INVAL;
+    }
+
+    struct spawn_args *sa;
+    if ((sa = kmalloc(sizeof(struct spawn_args))) == NULL) {
+        return -E_NO_MEM;
+    }
+    memset(sa, 0, sizeof(struct spawn_args));
+
+    int i, ret = -E_INVAL;
+    lock_mm(mm);
+    if (name != NULL) {
+        if (!copy_string(mm, sa->name, name, sizeof(sa->name))) {
+            goto failed_unlock;
+        }
+        sa->has_name = 1;
+    }
+    if (nactions > 0 && !copy_from_user(mm, sa->actions, actions, sizeof(struct spawn_action) * nactions, 0)) {
+        goto failed_unlock;
+    }
+    for (i = 0; i < nactions; i ++) {
+        const char *path = sa->actions[i].path;
+        sa->actions[i].path = NULL;
+        sa->nactions = i + 1;
+        if (sa->actions[i].op == SPAWN_OPEN) {
+            char *buffer;
+            if ((buffer = kmalloc(FS_MAX_FPATH_LEN + 1)) == NULL) {
+                ret = -E_NO_MEM;
+                goto failed_unlock;
+            }
+            sa->actions[i].path = buffer;
+            if (!copy_string(mm, buffer, path, FS_MAX_FPATH_LEN + 1)) {
+                goto failed_unlock;
+            }
+        }
+    }
+    if ((ret = copy_kargv(mm, argc, sa->kargv, argv)) != 0) {
+        goto failed_unlock;
+    }
+    sa->argc = argc;
+    unlock_mm(mm);
+
+    // returns once the child has exec'ed or exited
+    if ((ret = kernel_thread(spawn_main, sa, CLONE_VFORK)) > 0) {
+        int pid = ret;
+        struct proc_struct *proc = find_proc(pid);
+        // the child is not reaped before do_wait, it is still there
+        if (sa->ret == 0 && (proc->flags & PF_EXEC_FAILED)) {
+            sa->ret = proc->exit_code;
+        }
+        if (sa->ret != 0) {
+            ret = sa->ret;
+            do_wait(pid, NULL);
+        }
+    }
+    put_spawn_args(sa);
+    return ret;
+
+failed_unlock:
+    unlock_mm(mm);
+    put_spawn_args(sa);
+    return ret;
+}
+
 #define __KERNEL_EXECVE(name, path, ...) ({                         \
 const char *argv[] = {path, ##__VA_ARGS__, NULL};       \
                      cprintf("kernel_execve: pid = %d, name = \"%s\".\n",    \
@@ -1020,6 +1608,7 @@ init_main(void *arg) {
     }
 
     fs_cleanup();
+    shrink_caches();
         
     cprintf("all user-mode processes have quit.\n");
     assert(initproc->cptr == NULL && initproc->yptr == NULL && initproc->optr == NULL);
@@ -1042,6 +1631,9 @@ proc_init(void) {
     for (i = 0; i < HASH_LIST_SIZE; i ++) {
         list_init(hash_list + i);
     }
+    list_init(&proc_cache);
+    list_init(&kstack_cache);
+    register_shrinker(&proc_shrinker);
 
     if ((idleproc = alloc_proc()) == NULL) {
         panic("cannot alloc idleproc.\n");
@@ -1074,13 +1666,48 @@ proc_init(void) {
     assert(initproc != NULL && initproc->pid == 1);
 }
 
+#ifdef CONFIG_SMP
+// proc_init_ap - the idle thread of the AP id, it runs on the stack the AP boots with
+struct proc_struct *
+proc_init_ap(int id, uintptr_t kstack) {
+    struct proc_struct *idle;
+    if ((idle = alloc_proc()) == NULL) {
+        panic("cannot alloc idleproc.\n");
+    }
+    idle->pid = 0;
+    idle->state = PROC_RUNNABLE;
+    idle->kstack = kstack;
+    idle->need_resched = 1;
+    idle->cpu = id;
+    set_proc_name(idle, "idle");
+    return idle;
+}
+#endif
+
 // cpu_idle - at the end of kern_init, the first kernel thread idleproc will do below works
 void
 cpu_idle(void) {
+    // an idle cpu halts until an interrupt: a timer, a device, or on SMP an
+    // IPI from smp_resched, makes a process runnable and sets need_resched;
+    // it does not tick meanwhile, see clock_program
     while (1) {
         if (current->need_resched) {
             schedule();
         }
+#ifdef CONFIG_SMP
+        // the big kernel lock is held here only while scheduling, and
+        // schedule then also tries to steal a process
+        kernel_unlock();
+#endif
+        intr_disable();
+        if (!current->need_resched) {
+            // sti takes effect after hlt starts, no interrupt comes in between
+            asm volatile ("sti; hlt" ::: "memory");
+        }
+        intr_disable();
+#ifdef CONFIG_SMP
+        kernel_lock();
+#endif
     }
 }
 
@@ -1093,13 +1720,41 @@ lab6_set_priority(uint32_t priority)
     else current->lab6_priority = priority;
 }
 
-// do_sleep - set current process state to sleep and add timer with "time"
+// do_sched_setscheduler - set the scheduling policy of process pid, 0 for current
+int
+do_sched_setscheduler(int pid, int policy, struct sched_param *param) {
+    struct mm_struct *mm = current->mm;
+    struct sched_param __param, *sp = NULL;
+    struct proc_struct *proc;
+    if (param != NULL) {
+        sp = &__param;
+        lock_mm(mm);
+        if (!copy_from_user(mm, sp, param, sizeof(struct sched_param), 0)) {
+            unlock_mm(mm);
+            return -E_INVAL;
+        }
+        unlock_mm(mm);
+    }
+    if ((proc = (pid == 0) ? current : find_proc(pid)) == NULL || proc == idleproc) {
+        return -E_INVAL;
+    }
+    // do_exit gave back the reservation of an exiting process, it must not take another
+    if (proc->state == PROC_ZOMBIE || (proc->flags & PF_EXITING) || !proc_controlled(proc)) {
+        return -E_INVAL;
+    }
+    return sched_setscheduler(proc, policy, sp);
+}
+
+// do_sleep - set current process state to sleep and add timer with "time", in 1/TIMER_HZ second,
 //          - then call scheduler. if process run again, delete timer first.
 int
 do_sleep(unsigned int time) {
     if (time == 0) {
         return 0;
     }
+    if (signal_pending(current)) {
+        return -E_INTR;
+    }
     bool intr_flag;
     local_intr_save(intr_flag);
     timer_t __timer, *timer = timer_init(&__timer, current, time);
@@ -1111,5 +1766,5 @@ do_sleep(unsigned int time) {
     schedule();
 
     del_timer(timer);
-    return 0;
+    return signal_pending(current) ? -E_INTR : 0;
 }
@@ -6,6 +6,9 @@
 #include <trap.h>
 #include <memlayout.h>
 #include <skew_heap.h>
+#include <rb_tree.h>
+#include <smp.h>
+#include <signal.h>
 
 
 // process's state in his life cycle
@@ -60,45 +63,92 @@ struct proc_struct {
     int exit_code;                              // exit code (be sent to parent proc)
     uint32_t wait_state;                        // waiting state
     struct proc_struct *cptr, *yptr, *optr;     // relations between processes
+    list_entry_t zombie_list;                   // zombie children, not reaped yet
+    list_entry_t zombie_link;                   // entry in the parent's zombie_list
+    int wait_pid;                               // the child waited for in do_wait, 0 for any
+    list_entry_t thread_group;                  // the threads sharing this process's mm
     struct run_queue *rq;                       // running queue contains Process
+    int cpu;                                    // the cpu it runs or last ran on, whose run queues it goes to
     list_entry_t run_link;                      // the entry linked in run queue
     int time_slice;                             // time slice for occupying the CPU
     skew_heap_entry_t lab6_run_pool;            // FOR LAB6 ONLY: the entry in the run pool
     uint32_t lab6_stride;                       // FOR LAB6 ONLY: the current stride of the process
     uint32_t lab6_priority;                     // FOR LAB6 ONLY: the priority of process, set by lab6_set_priority(uint32_t)
+    rb_node cfs_run_node;                       // the entry in the cfs run queue tree
+    uint32_t vruntime;                          // the virtual runtime, for the cfs scheduler
+    int mlfq_level;                             // the run list of the mlfq scheduler
+    uint32_t mlfq_gen;                          // the mlfq boost generation mlfq_level belongs to
+    int policy;                                 // SCHED_NORMAL, or the policy of the rt class
+    int rt_priority;                            // SCHED_FIFO, SCHED_RR: the priority
+    uint32_t rt_runtime;                        // SCHED_DEADLINE: the budget of each period, in ticks
+    uint32_t rt_period;                         // SCHED_DEADLINE: the period, in ticks
+    uint32_t rt_budget;                         // SCHED_DEADLINE: the budget left in this period
+    uint32_t rt_deadline;                       // SCHED_DEADLINE: the tick this period ends at
     struct files_struct *filesp;                // the file related info(pwd, files_count, files_array, fs_semaphore) of process
+    void *fpu;                                  // FXSAVE area, NULL until the process uses the FPU, see fpu.h
+    struct uring_ctx *uring;                    // the submission/completion ring, see sysuring.h
+    uint32_t syscalls;                          // system calls made while strace_on, see strace.h
+    struct strace_ring *trace;                  // the log of SYSTRACE_TRACE, NULL when not traced
+    sigset_t sig_pending;                       // signals sent and not taken yet, see sig.h
+    sigset_t sig_blocked;                       // signals kept pending
+    struct sigaction *sig_actions;              // of the NSIG signals, NULL while they are all SIG_DFL
 };
 
 #define PF_EXITING                  0x00000001      // getting shutdown
+#define PF_VFORK                    0x00000002      // vfork child, its parent waits for the exec or exit
+#define PF_EXEC_FAILED              0x00000004      // exited from a failed exec that had dropped the old mm, exit_code is the error
 
 #define WT_INTERRUPTED               0x80000000                    // the wait state could be interrupted
 #define WT_CHILD                    (0x00000001 | WT_INTERRUPTED)  // wait child process
 #define WT_KSEM                      0x00000100                    // wait kernel semaphore
 #define WT_TIMER                    (0x00000002 | WT_INTERRUPTED)  // wait timer
 #define WT_KBD                      (0x00000004 | WT_INTERRUPTED)  // wait the input of keyboard
+#define WT_FUTEX                    (0x00000008 | WT_INTERRUPTED)  // wait on a user futex word
+#define WT_VFORK                    (0x00000010 | WT_INTERRUPTED)  // wait a vfork child to exec or exit
+#define WT_URING                    (0x00000020 | WT_INTERRUPTED)  // wait the worker or the completions of a ring
 
 #define le2proc(le, member)         \
     to_struct((le), struct proc_struct, member)
 
+#ifdef CONFIG_SMP
+// each cpu runs a process of its own, and has an idle thread of its own
+#define current                     (mycpu()->proc)
+#define idleproc                    (mycpu()->idle)
+extern struct proc_struct *initproc;
+#else
 extern struct proc_struct *idleproc, *initproc, *current;
+#endif
 
 void proc_init(void);
 void proc_run(struct proc_struct *proc);
 int kernel_thread(int (*fn)(void *), void *arg, uint32_t clone_flags);
 
 char *set_proc_name(struct proc_struct *proc, const char *name);
+void proc_reparent_init(struct proc_struct *proc);
 char *get_proc_name(struct proc_struct *proc);
 void cpu_idle(void) __attribute__((noreturn));
+struct proc_struct *proc_init_ap(int id, uintptr_t kstack);
 
 struct proc_struct *find_proc(int pid);
+bool proc_controlled(struct proc_struct *proc);
 int do_fork(uint32_t clone_flags, uintptr_t stack, struct trapframe *tf);
 int do_exit(int error_code);
+int do_exit_group(int error_code);
 int do_yield(void);
 int do_execve(const char *name, int argc, const char **argv);
+struct spawn_action;
+int do_spawn(const char *name, int argc, const char **argv, const struct spawn_action *actions, int nactions);
 int do_wait(int pid, int *code_store);
 int do_kill(int pid);
 //FOR LAB6, set the process's priority (bigger value will get more CPU time)
 void lab6_set_priority(uint32_t priority);
 int do_sleep(unsigned int time);
+struct sched_param;
+int do_sched_setscheduler(int pid, int policy, struct sched_param *param);
+
+struct procinfo;
+int do_procinfo(int pid, struct procinfo *info);
+int do_mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags);
+int do_munmap(uintptr_t addr, size_t len);
 #endif /* !__KERN_PROCESS_PROC_H__ */
 
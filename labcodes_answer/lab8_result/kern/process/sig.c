@@ -0,0 +1,318 @@
+#include <defs.h>
+#include <string.h>
+#include <error.h>
+#include <mmu.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <vmm.h>
+#include <trap.h>
+#include <proc.h>
+#include <sched.h>
+#include <signal.h>
+#include <sig.h>
+
+/* *
+ * The frame a handler finds on the user stack. It returns to the
+ * trampoline, which calls sigreturn with esp just above the return address;
+ * the context under the argument is what sigreturn puts back. The FPU state
+ * is not saved, a handler must leave the FPU alone.
+ * */
+struct sigframe {
+    uintptr_t ret;                      // the trampoline
+    int signum;                         // the argument of the handler
+    struct pushregs regs;               // the interrupted code
+    uintptr_t eip;
+    uint32_t eflags;
+    uintptr_t esp;
+    sigset_t blocked;                   // the mask before the handler
+};
+
+// the flags a handler may change through the frame
+#define FL_USER                     (FL_CF | FL_PF | FL_AF | FL_ZF | FL_SF | FL_TF | FL_DF | FL_OF | FL_AC)
+
+// nothing catches, blocks or ignores these
+#define SIG_UNBLOCKABLE             sigmask(SIGKILL)
+
+extern char __sigreturn_stub[], __sigreturn_stub_end[];
+
+// where the trampoline is in every process
+static uintptr_t sigreturn_tramp;
+
+// signal_install - copy the sigreturn trampoline to kva, which user processes see at va
+void
+signal_install(void *kva, uintptr_t va) {
+    memcpy(kva, __sigreturn_stub, __sigreturn_stub_end - __sigreturn_stub);
+    sigreturn_tramp = va;
+}
+
+static sighandler_t
+signal_handler(struct proc_struct *proc, int signum) {
+    return (proc->sig_actions != NULL) ? proc->sig_actions[signum].sa_handler : SIG_DFL;
+}
+
+static bool
+signal_ignored(struct proc_struct *proc, int signum) {
+    sighandler_t handler = signal_handler(proc, signum);
+    return handler == SIG_IGN || (handler == SIG_DFL && signum == SIGCHLD);
+}
+
+// signal_fork - the child proc gets the actions and the mask of parent, and nothing pending
+int
+signal_fork(struct proc_struct *proc, struct proc_struct *parent) {
+    proc->sig_pending = 0;
+    proc->sig_blocked = parent->sig_blocked;
+    if (parent->sig_actions != NULL) {
+        if ((proc->sig_actions = kmalloc(NSIG * sizeof(struct sigaction))) == NULL) {
+            return -E_NO_MEM;
+        }
+        memcpy(proc->sig_actions, parent->sig_actions, NSIG * sizeof(struct sigaction));
+    }
+    return 0;
+}
+
+// signal_exec - the handlers are gone with the old program, what was ignored stays ignored
+void
+signal_exec(struct proc_struct *proc) {
+    int signum;
+    if (proc->sig_actions != NULL) {
+        for (signum = 1; signum < NSIG; signum ++) {
+            struct sigaction *act = proc->sig_actions + signum;
+            if (act->sa_handler != SIG_IGN) {
+                memset(act, 0, sizeof(struct sigaction));
+            }
+        }
+    }
+}
+
+void
+signal_free(struct proc_struct *proc) {
+    if (proc->sig_actions != NULL) {
+        kfree(proc->sig_actions);
+        proc->sig_actions = NULL;
+    }
+}
+
+// signal_send - make signum pending in proc, and wake it if it can take it now
+void
+signal_send(struct proc_struct *proc, int signum) {
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        // an ignored signal is dropped, unless it is blocked: the action may change before it is unblocked
+        if (proc->state != PROC_ZOMBIE
+            && (!signal_ignored(proc, signum) || (proc->sig_blocked & sigmask(signum)))) {
+            proc->sig_pending |= sigmask(signum);
+            if (!(proc->sig_blocked & sigmask(signum)) && (proc->wait_state & WT_INTERRUPTED)) {
+                wakeup_proc(proc);
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+}
+
+/* *
+ * signal_deliver - called by trap() on the way back to user mode when
+ * signal_pending(current): take the lowest signal, and either end the
+ * process, or make tf return to the handler on a signal frame.
+ * */
+void
+signal_deliver(struct trapframe *tf) {
+    struct proc_struct *proc = current;
+    struct mm_struct *mm = proc->mm;
+    struct sigaction *act;
+    struct sigframe frame;
+    sigset_t pending;
+    uintptr_t sp;
+    int signum;
+    bool ok;
+
+    pending = proc->sig_pending & ~proc->sig_blocked;
+    // the lowest one first
+    signum = 1;
+    while (!(pending & sigmask(signum))) {
+        signum ++;
+    }
+    proc->sig_pending &= ~sigmask(signum);
+
+    if (signal_ignored(proc, signum)) {
+        return ;
+    }
+    if (signal_handler(proc, signum) == SIG_DFL) {
+        do_exit_group(-E_KILLED);
+    }
+    act = proc->sig_actions + signum;
+
+    frame.ret = sigreturn_tramp;
+    frame.signum = signum;
+    frame.regs = tf->tf_regs;
+    frame.eip = tf->tf_eip;
+    frame.eflags = tf->tf_eflags;
+    frame.esp = tf->tf_esp;
+    frame.blocked = proc->sig_blocked;
+
+    // the handler starts as after a call: esp + 4 is 16 bytes aligned
+    sp = ((tf->tf_esp - sizeof(struct sigframe) + sizeof(uintptr_t)) & ~0xF) - sizeof(uintptr_t);
+    lock_mm(mm);
+    {
+        ok = copy_to_user(mm, (void *)sp, &frame, sizeof(struct sigframe));
+    }
+    unlock_mm(mm);
+    if (!ok) {
+        // no room for the frame on the user stack
+        do_exit_group(-E_KILLED);
+    }
+
+    tf->tf_esp = sp;
+    tf->tf_eip = (uintptr_t)(act->sa_handler);
+    tf->tf_eflags &= ~(FL_TF | FL_DF);
+    proc->sig_blocked |= act->sa_mask;
+    if (!(act->sa_flags & SA_NODEFER)) {
+        proc->sig_blocked |= sigmask(signum);
+    }
+    proc->sig_blocked &= ~SIG_UNBLOCKABLE;
+    if (act->sa_flags & SA_RESETHAND) {
+        act->sa_handler = SIG_DFL;
+    }
+}
+
+// do_sigsend - called by sys_kill, send signum to the process pid; 0 only checks that it exists
+int
+do_sigsend(int pid, int signum) {
+    struct proc_struct *proc;
+    if (signum < 0 || signum >= NSIG) {
+        return -E_INVAL;
+    }
+    if (signum == SIGKILL) {
+        return do_kill(pid);
+    }
+    // the kernel threads take no signals
+    if ((proc = find_proc(pid)) == NULL || proc->state == PROC_ZOMBIE || proc->mm == NULL) {
+        return -E_INVAL;
+    }
+    if (signum != 0) {
+        signal_send(proc, signum);
+    }
+    return 0;
+}
+
+// do_sigaction - called by sys_sigaction, set the action of signum to *act, the old one to *oldact
+int
+do_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact) {
+    struct mm_struct *mm = current->mm;
+    struct sigaction new, old;
+    bool ok = 1;
+
+    if (signum <= 0 || signum >= NSIG || (signum == SIGKILL && act != NULL)) {
+        return -E_INVAL;
+    }
+    if (act != NULL) {
+        lock_mm(mm);
+        {
+            ok = copy_from_user(mm, &new, act, sizeof(struct sigaction), 0);
+        }
+        unlock_mm(mm);
+        if (!ok) {
+            return -E_INVAL;
+        }
+        if (current->sig_actions == NULL) {
+            if ((current->sig_actions = kmalloc(NSIG * sizeof(struct sigaction))) == NULL) {
+                return -E_NO_MEM;
+            }
+            memset(current->sig_actions, 0, NSIG * sizeof(struct sigaction));
+        }
+    }
+
+    if (current->sig_actions != NULL) {
+        old = current->sig_actions[signum];
+    }
+    else {
+        memset(&old, 0, sizeof(struct sigaction));
+    }
+    if (act != NULL) {
+        new.sa_mask &= ~SIG_UNBLOCKABLE;
+        current->sig_actions[signum] = new;
+        // what is pending of an ignored signal is dropped
+        if (signal_ignored(current, signum)) {
+            current->sig_pending &= ~sigmask(signum);
+        }
+    }
+    if (oldact != NULL) {
+        lock_mm(mm);
+        {
+            ok = copy_to_user(mm, oldact, &old, sizeof(struct sigaction));
+        }
+        unlock_mm(mm);
+    }
+    return ok ? 0 : -E_INVAL;
+}
+
+// do_sigprocmask - called by sys_sigprocmask, change the blocked signals as how says, the old mask to *oldset
+int
+do_sigprocmask(int how, const sigset_t *set, sigset_t *oldset) {
+    struct mm_struct *mm = current->mm;
+    sigset_t new, old = current->sig_blocked;
+    bool ok = 1;
+
+    if (set != NULL) {
+        lock_mm(mm);
+        {
+            ok = copy_from_user(mm, &new, set, sizeof(sigset_t), 0);
+        }
+        unlock_mm(mm);
+        if (!ok) {
+            return -E_INVAL;
+        }
+        switch (how) {
+        case SIG_BLOCK:
+            current->sig_blocked |= new;
+            break;
+        case SIG_UNBLOCK:
+            current->sig_blocked &= ~new;
+            break;
+        case SIG_SETMASK:
+            current->sig_blocked = new;
+            break;
+        default:
+            return -E_INVAL;
+        }
+        current->sig_blocked &= ~SIG_UNBLOCKABLE;
+    }
+    if (oldset != NULL) {
+        lock_mm(mm);
+        {
+            ok = copy_to_user(mm, oldset, &old, sizeof(sigset_t));
+        }
+        unlock_mm(mm);
+    }
+    return ok ? 0 : -E_INVAL;
+}
+
+// do_sigreturn - called by sys_sigreturn from the trampoline: back to the code the handler interrupted
+int
+do_sigreturn(void) {
+    struct proc_struct *proc = current;
+    struct mm_struct *mm = proc->mm;
+    struct trapframe *tf = proc->tf;
+    struct sigframe frame;
+    bool ok;
+
+    // the return of the handler took the return address off the frame
+    uintptr_t sp = tf->tf_esp - sizeof(uintptr_t);
+    lock_mm(mm);
+    {
+        ok = copy_from_user(mm, &frame, (void *)sp, sizeof(struct sigframe), 0);
+    }
+    unlock_mm(mm);
+    if (!ok) {
+        do_exit_group(-E_KILLED);
+    }
+
+    tf->tf_regs = frame.regs;
+    tf->tf_eip = frame.eip;
+    tf->tf_esp = frame.esp;
+    tf->tf_eflags = (tf->tf_eflags & ~FL_USER) | (frame.eflags & FL_USER);
+    proc->sig_blocked = frame.blocked & ~SIG_UNBLOCKABLE;
+    // syscall() puts the return value in eax
+    return tf->tf_regs.reg_eax;
+}
+
@@ -0,0 +1,38 @@
+#ifndef __KERN_PROCESS_SIG_H__
+#define __KERN_PROCESS_SIG_H__
+
+#include <defs.h>
+#include <signal.h>
+#include <proc.h>
+
+/* *
+ * sig - sending, blocking and taking the signals of libs/signal.h.
+ *
+ * signal_send only marks the signal pending and wakes the process if it
+ * sleeps interruptibly; the sleep returns -E_INTR when signal_pending, and
+ * trap() calls signal_deliver on the way back to user mode. SIGKILL keeps
+ * going through do_kill and PF_EXITING.
+ * */
+
+struct trapframe;
+
+// signal_pending - proc has a signal to take, which ends an interruptible sleep early
+static inline bool
+signal_pending(struct proc_struct *proc) {
+    return (proc->sig_pending & ~proc->sig_blocked) != 0;
+}
+
+void signal_install(void *kva, uintptr_t va);
+int signal_fork(struct proc_struct *proc, struct proc_struct *parent);
+void signal_exec(struct proc_struct *proc);
+void signal_free(struct proc_struct *proc);
+void signal_send(struct proc_struct *proc, int signum);
+void signal_deliver(struct trapframe *tf);
+
+int do_sigsend(int pid, int signum);
+int do_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact);
+int do_sigprocmask(int how, const sigset_t *set, sigset_t *oldset);
+int do_sigreturn(void);
+
+#endif /* !__KERN_PROCESS_SIG_H__ */
+
@@ -0,0 +1,338 @@
+#include <defs.h>
+#include <x86.h>
+#include <mmu.h>
+#include <memlayout.h>
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+#include <pmm.h>
+#include <trap.h>
+#include <lapic.h>
+#include <ioapic.h>
+#include <spinlock.h>
+#include <fpu.h>
+#include <proc.h>
+#include <smp.h>
+
+#ifdef CONFIG_SMP
+
+/* *
+ * The MultiProcessor Specification 1.4: the BIOS leaves a floating pointer
+ * structure in the first KB of the EBDA, the last KB of base memory or the
+ * BIOS ROM, which points to the configuration table listing the processors
+ * and the I/O APICs.
+ * */
+
+struct mp {                         // floating pointer structure
+    uint8_t signature[4];           // "_MP_"
+    uint32_t physaddr;              // physical address of the configuration table
+    uint8_t length;                 // 1, in 16 bytes
+    uint8_t specrev;                // 1 or 4
+    uint8_t checksum;               // all bytes must add up to 0
+    uint8_t type;                   // configuration type, 0 if there is a table
+    uint8_t imcrp;                  // bit 7: IMCR present, PIC mode
+    uint8_t reserved[3];
+};
+
+struct mpconf {                     // configuration table header
+    uint8_t signature[4];           // "PCMP"
+    uint16_t length;                // size of the base table in bytes, with the header
+    uint8_t version;                // 1 or 4
+    uint8_t checksum;               // all bytes must add up to 0
+    uint8_t product[20];            // product id
+    uint32_t oemtable;              // OEM table pointer
+    uint16_t oemlength;             // OEM table length
+    uint16_t entry;                 // number of entries
+    uint32_t lapicaddr;             // address of the local APICs
+    uint16_t xlength;               // extended table length
+    uint8_t xchecksum;              // extended table checksum
+    uint8_t reserved;
+    uint8_t entries[0];             // the table entries
+};
+
+struct mpproc {                     // processor entry
+    uint8_t type;                   // MPPROC
+    uint8_t apicid;                 // local APIC id
+    uint8_t version;                // local APIC version
+    uint8_t flags;                  // bit 0: enabled, bit 1: the boot cpu
+    uint8_t signature[4];           // CPU signature
+    uint32_t feature;               // feature flags from CPUID
+    uint8_t reserved[8];
+};
+
+struct mpioapic {                   // I/O APIC entry
+    uint8_t type;                   // MPIOAPIC
+    uint8_t apicno;                 // I/O APIC id
+    uint8_t version;                // I/O APIC version
+    uint8_t flags;                  // bit 0: usable
+    uint32_t addr;                  // address of the registers
+};
+
+// the types of the table entries
+#define MPPROC                      0x00    // one per processor, 20 bytes
+#define MPBUS                       0x01    // one per bus, 8 bytes
+#define MPIOAPIC                    0x02    // one per I/O APIC, 8 bytes
+#define MPIOINTR                    0x03    // one per bus interrupt source, 8 bytes
+#define MPLINTR                     0x04    // one per system interrupt source, 8 bytes
+
+#define MPPROC_EN                   0x01    // processor enabled
+
+struct cpu cpus[NCPU];
+int ncpu = 1;
+
+// the index in cpus of each local APIC id
+static uint8_t apicid_cpu[256];
+
+static spinlock_t kernel_spinlock;
+
+// the real mode entry of the APs (apentry.S), copied to AP_BOOT_PA
+extern uint8_t ap_boot_start[], ap_boot_end[];
+// and what it loads: cr3, esp and the function to call
+extern uint32_t ap_boot_args[];
+
+static uint8_t
+mp_sum(uint8_t *addr, int len) {
+    int i, sum = 0;
+    for (i = 0; i < len; i ++) {
+        sum += addr[i];
+    }
+    return sum;
+}
+
+// mp_search1 - look for an MP floating pointer structure in the len bytes at physical address pa
+static struct mp *
+mp_search1(uintptr_t pa, int len) {
+    uint8_t *p = KADDR(pa), *end = p + len;
+    for (; p + sizeof(struct mp) <= end; p += sizeof(struct mp)) {
+        if (memcmp(p, "_MP_", 4) == 0 && mp_sum(p, sizeof(struct mp)) == 0) {
+            return (struct mp *)p;
+        }
+    }
+    return NULL;
+}
+
+// mp_search - the three places the specification allows, in order
+static struct mp *
+mp_search(void) {
+    uint8_t *bda = KADDR(0x400);
+    uintptr_t pa;
+    struct mp *mp;
+
+    if ((pa = ((bda[0x0F] << 8) | bda[0x0E]) << 4) != 0) {
+        if ((mp = mp_search1(pa, 1024)) != NULL) {
+            return mp;
+        }
+    }
+    else {
+        pa = ((bda[0x14] << 8) | bda[0x13]) * 1024;
+        if ((mp = mp_search1(pa - 1024, 1024)) != NULL) {
+            return mp;
+        }
+    }
+    return mp_search1(0xF0000, 0x10000);
+}
+
+// mp_config - find and check the configuration table, return NULL if there is none
+static struct mpconf *
+mp_config(struct mp **pmp) {
+    struct mp *mp;
+    struct mpconf *conf;
+
+    if ((mp = mp_search()) == NULL || mp->physaddr == 0 || mp->type != 0) {
+        return NULL;
+    }
+    conf = KADDR(mp->physaddr);
+    if (memcmp(conf, "PCMP", 4) != 0 || (conf->version != 1 && conf->version != 4)) {
+        return NULL;
+    }
+    if (mp_sum((uint8_t *)conf, conf->length) != 0) {
+        return NULL;
+    }
+    *pmp = mp;
+    return conf;
+}
+
+// smp_init - find the CPUs and the I/O APIC, and turn on the local APIC of the boot cpu
+void
+smp_init(void) {
+    struct mp *mp;
+    struct mpconf *conf;
+    struct mpproc *proc;
+    struct mpioapic *mpio;
+    uint8_t *p, *end;
+    int i;
+
+    spinlock_init(&kernel_spinlock);
+    for (i = 0; i < NCPU; i ++) {
+        cpus[i].id = i;
+    }
+
+    if ((conf = mp_config(&mp)) == NULL) {
+        cprintf("smp: no MP configuration table, 1 cpu.\n");
+        return ;
+    }
+
+    lapic = mmio_map(conf->lapicaddr, PGSIZE);
+    cpus[0].apicid = lapic_id();
+    apicid_cpu[cpus[0].apicid] = 0;
+
+    for (p = conf->entries, end = (uint8_t *)conf + conf->length; p < end;) {
+        switch (*p) {
+        case MPPROC:
+            proc = (struct mpproc *)p;
+            if ((proc->flags & MPPROC_EN) && proc->apicid != cpus[0].apicid) {
+                if (ncpu < NCPU) {
+                    cpus[ncpu].apicid = proc->apicid;
+                    apicid_cpu[proc->apicid] = ncpu;
+                    ncpu ++;
+                }
+                else {
+                    cprintf("smp: too many cpus, cpu %d skipped.\n", proc->apicid);
+                }
+            }
+            p += sizeof(struct mpproc);
+            continue;
+        case MPIOAPIC:
+            mpio = (struct mpioapic *)p;
+            if (ioapic == NULL) {
+                ioapic_init(mmio_map(mpio->addr, PGSIZE), mpio->apicno);
+            }
+            p += sizeof(struct mpioapic);
+            continue;
+        case MPBUS:
+        case MPIOINTR:
+        case MPLINTR:
+            p += 8;
+            continue;
+        default:
+            panic("smp: unknown config type %x\n", *p);
+        }
+    }
+
+    if (mp->imcrp) {
+        // the IMCR wires the 8259A to the BSP, switch to symmetric I/O mode
+        outb(0x22, 0x70);
+        outb(0x23, inb(0x23) | 1);
+    }
+
+    lapic_init();
+    cpus[0].started = 1;
+    cprintf("smp: %d cpus, boot cpu apic id %d.\n", ncpu, cpus[0].apicid);
+}
+
+struct cpu *
+mycpu(void) {
+    return (lapic != NULL) ? cpus + apicid_cpu[lapic_id()] : cpus;
+}
+
+// ap_main - an AP continues here from apentry.S, on the kernel stack of its idle thread
+static void __noreturn
+ap_main(void) {
+    struct cpu *cpu = mycpu();
+    gdt_init_ap();
+    idt_load();
+    lapic_init();
+    lapic_timer_init();
+    fpu_init_ap();
+    cpu->started = 1;
+    kernel_lock();
+    cpu_idle();
+}
+
+// smp_boot - start the APs one by one, each one waits in its idle loop for work
+void
+smp_boot(void) {
+    uint32_t *args = (uint32_t *)(KERNBASE + AP_BOOT_PA + (ap_boot_args - (uint32_t *)ap_boot_start));
+    struct Page *page;
+    uintptr_t kstack;
+    int i;
+
+    // from now on the boot cpu runs the kernel under the lock too
+    kernel_lock();
+    if (ncpu == 1) {
+        return ;
+    }
+
+    // the trampoline turns on paging before it jumps to the kernel, at an
+    // address it still runs at: map the low memory at 0 for a while
+    boot_pgdir[0] = boot_pgdir[PDX(KERNBASE)];
+    memcpy((void *)(KERNBASE + AP_BOOT_PA), ap_boot_start, ap_boot_end - ap_boot_start);
+
+    for (i = 1; i < ncpu; i ++) {
+        if ((page = alloc_pages(KSTACKPAGE)) == NULL) {
+            panic("smp: no kernel stack for cpu %d.\n", i);
+        }
+        kstack = (uintptr_t)page2kva(page);
+        cpus[i].idle = cpus[i].proc = proc_init_ap(i, kstack);
+        args[0] = boot_cr3;
+        args[1] = kstack + KSTACKSIZE;
+        args[2] = (uint32_t)ap_main;
+        lapic_startap(cpus[i].apicid, AP_BOOT_PA);
+        while (!cpus[i].started) {
+            /* do nothing */;
+        }
+    }
+
+    boot_pgdir[0] = 0;
+    lcr3(rcr3());
+    cprintf("smp: %d cpus started.\n", ncpu);
+}
+
+// kernel_lock - take the big kernel lock; flush the TLB while waiting when asked to
+void
+kernel_lock(void) {
+    struct cpu *cpu = mycpu();
+    assert(!cpu->kernel_locked);
+    while (!spin_trylock(&kernel_spinlock)) {
+        if (cpu->tlb_flush) {
+            lcr3(rcr3());
+            cpu->tlb_flush = 0;
+        }
+        pause();
+    }
+    cpu->kernel_locked = 1;
+}
+
+void
+kernel_unlock(void) {
+    struct cpu *cpu = mycpu();
+    assert(cpu->kernel_locked);
+    cpu->kernel_locked = 0;
+    spin_unlock(&kernel_spinlock);
+}
+
+/* *
+ * tlb_shootdown - the page table with physical address cr3 changed: flush
+ * the TLB of the other cpus running it, or of all the other busy cpus for
+ * a change to the kernel part (cr3 == 0). The senders hold the big kernel
+ * lock, the targets flush while they wait for it or in the IRQ_IPI_TLB
+ * handler, which waits for it as well.
+ * */
+void
+tlb_shootdown(uintptr_t cr3) {
+    struct proc_struct *proc;
+    int id, me = cpunum();
+    for (id = 0; id < ncpu; id ++) {
+        if (id == me || !cpus[id].started || (proc = cpus[id].proc) == NULL) {
+            continue;
+        }
+        if (cr3 == 0 || (proc->mm != NULL && proc->cr3 == cr3)) {
+            cpus[id].tlb_flush = 1;
+            lapic_ipi(cpus[id].apicid, IRQ_OFFSET + IRQ_IPI_TLB);
+            while (cpus[id].tlb_flush) {
+                pause();
+            }
+        }
+    }
+}
+
+// smp_resched - make cpu id look at need_resched of its current process
+void
+smp_resched(int id) {
+    if (id != cpunum()) {
+        lapic_ipi(cpus[id].apicid, IRQ_OFFSET + IRQ_IPI_RESCHED);
+    }
+}
+
+#endif /* CONFIG_SMP */
+
@@ -0,0 +1,74 @@
+#ifndef __KERN_PROCESS_SMP_H__
+#define __KERN_PROCESS_SMP_H__
+
+#include <defs.h>
+
+/* *
+ * smp - several CPUs, when the kernel is built with make SMP=1 (CONFIG_SMP).
+ *
+ * smp_init finds the CPUs in the MP configuration table of the BIOS, turns
+ * on the local APIC of the boot CPU and the I/O APIC, which then delivers
+ * the device interrupts to the boot CPU in place of the 8259A. smp_boot
+ * wakes the other CPUs (the APs) with INIT-SIPI. Each CPU has a struct cpu
+ * with its current process, an idle thread and run queues of its own (see
+ * sched.c), and a local APIC timer; an idle CPU steals runnable processes
+ * from the run queues of the busy ones.
+ *
+ * The kernel itself still runs on one CPU at a time, under the big kernel
+ * lock: a CPU takes it when it enters the kernel from user mode or from its
+ * idle loop and drops it when it goes back, so the code that relies on
+ * local_intr_save for mutual exclusion keeps working while user processes
+ * run in parallel. The run queues and the timer list have spinlocks of
+ * their own already.
+ *
+ * Without CONFIG_SMP there is one CPU and all of this compiles away.
+ * */
+
+#ifdef CONFIG_SMP
+
+#define NCPU                        8
+
+struct proc_struct;
+
+struct cpu {
+    int id;                                 // index in cpus, 0 is the boot cpu
+    uint8_t apicid;                         // local APIC id
+    volatile bool started;                  // running the kernel
+    struct proc_struct *proc;               // the process running on this cpu (current)
+    struct proc_struct *idle;               // the idle thread of this cpu (idleproc)
+    struct proc_struct *fpu_owner;          // the process the FPU registers belong to
+    bool kernel_locked;                     // holding the big kernel lock
+    volatile bool tlb_flush;                // another cpu changed the page table in use here
+};
+
+extern struct cpu cpus[NCPU];
+extern int ncpu;
+
+struct cpu *mycpu(void);
+
+#define cpunum()                    (mycpu()->id)
+#define cpu_curr(id)                (cpus[id].proc)
+#define cpu_idleproc(id)            (cpus[id].idle)
+
+void smp_init(void);
+void smp_boot(void);
+void kernel_lock(void);
+void kernel_unlock(void);
+void tlb_shootdown(uintptr_t cr3);
+void smp_resched(int id);
+
+#else
+
+#define NCPU                        1
+
+#define cpunum()                    0
+#define cpu_curr(id)                current
+#define cpu_idleproc(id)            idleproc
+
+#define smp_init()                  do { } while (0)
+#define smp_boot()                  do { } while (0)
+
+#endif /* CONFIG_SMP */
+
+#endif /* !__KERN_PROCESS_SMP_H__ */
+
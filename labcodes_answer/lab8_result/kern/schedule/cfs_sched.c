@@ -0,0 +1,117 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <assert.h>
+#include <rb_tree.h>
+#include <cfs_sched.h>
+
+#define le2cfs(node)                    \
+    to_struct((node), struct proc_struct, cfs_run_node)
+
+static inline uint32_t
+cfs_weight(struct proc_struct *proc) {
+    return (proc->lab6_priority != 0) ? proc->lab6_priority : 1;
+}
+
+// vruntime_comp - compare two virtual runtimes, they may wrap around
+static inline int32_t
+vruntime_comp(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b);
+}
+
+static int
+proc_vruntime_comp_f(rb_node *a, rb_node *b) {
+    int32_t c = vruntime_comp(le2cfs(a)->vruntime, le2cfs(b)->vruntime);
+    return (c > 0) ? 1 : ((c == 0) ? 0 : -1);
+}
+
+// cfs_leftmost - the runnable process with the smallest virtual runtime
+static struct proc_struct *
+cfs_leftmost(struct run_queue *rq) {
+    rb_node *node, *left;
+    if ((node = rb_node_root(rq->cfs_tree)) == NULL) {
+        return NULL;
+    }
+    while ((left = rb_node_left(rq->cfs_tree, node)) != NULL) {
+        node = left;
+    }
+    return le2cfs(node);
+}
+
+static void
+cfs_init(struct run_queue *rq) {
+    list_init(&(rq->run_list));
+    rq->proc_num = 0;
+    if ((rq->cfs_tree = rb_tree_create(proc_vruntime_comp_f)) == NULL) {
+        panic("cfs_init: no memory for the run queue.\n");
+    }
+    rq->min_vruntime = 0;
+    rq->total_weight = 0;
+}
+
+/*
+ * cfs_enqueue places a new or waking process no further than
+ * CFS_SLEEPER_CREDIT behind min_vruntime, so a long sleep does not buy
+ * it the CPU for a long time, nor does a process keep a stale vruntime.
+ */
+static void
+cfs_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    uint32_t floor = rq->min_vruntime - CFS_SLEEPER_CREDIT;
+    if (vruntime_comp(proc->vruntime, floor) < 0) {
+        proc->vruntime = floor;
+    }
+    rb_insert(rq->cfs_tree, &(proc->cfs_run_node));
+    proc->rq = rq;
+    rq->proc_num ++;
+    rq->total_weight += cfs_weight(proc);
+}
+
+static void
+cfs_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(proc->rq == rq && rq->proc_num > 0);
+    rb_delete(rq->cfs_tree, &(proc->cfs_run_node));
+    rq->proc_num --;
+    rq->total_weight -= cfs_weight(proc);
+}
+
+/*
+ * cfs_pick_next returns the leftmost process, with a time slice of its
+ * share (by weight) of the scheduling period.
+ */
+static struct proc_struct *
+cfs_pick_next(struct run_queue *rq) {
+    struct proc_struct *p;
+    if ((p = cfs_leftmost(rq)) == NULL) {
+        return NULL;
+    }
+    if (vruntime_comp(p->vruntime, rq->min_vruntime) > 0) {
+        rq->min_vruntime = p->vruntime;
+    }
+    uint32_t period = CFS_TARGET_LATENCY;
+    if (rq->proc_num * CFS_MIN_GRANULARITY > period) {
+        period = rq->proc_num * CFS_MIN_GRANULARITY;
+    }
+    uint32_t slice = period * cfs_weight(p) / rq->total_weight;
+    p->time_slice = (slice > CFS_MIN_GRANULARITY) ? slice : CFS_MIN_GRANULARITY;
+    return p;
+}
+
+static void
+cfs_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    proc->vruntime += CFS_VRUNTIME_TICK / cfs_weight(proc);
+    if (proc->time_slice > 0) {
+        proc->time_slice --;
+    }
+    if (proc->time_slice == 0) {
+        proc->need_resched = 1;
+    }
+}
+
+struct sched_class cfs_sched_class = {
+    .name = "cfs_scheduler",
+    .init = cfs_init,
+    .enqueue = cfs_enqueue,
+    .dequeue = cfs_dequeue,
+    .pick_next = cfs_pick_next,
+    .proc_tick = cfs_proc_tick,
+};
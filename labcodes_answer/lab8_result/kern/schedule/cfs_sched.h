@@ -0,0 +1,26 @@
+#ifndef __KERN_SCHEDULE_CFS_SCHED_H__
+#define __KERN_SCHEDULE_CFS_SCHED_H__
+
+#include <sched.h>
+
+/* *
+ * cfs - a completely fair scheduler in the style of linux.
+ *
+ * Every process accumulates virtual runtime while it runs, at a rate
+ * inversely proportional to its weight (lab6_priority, 0 counts as 1). The
+ * run queue is a red-black tree ordered by virtual runtime, and the
+ * leftmost process runs next. Instead of a fixed max_time_slice, every
+ * process gets its share of a scheduling period: CFS_TARGET_LATENCY ticks,
+ * stretched to CFS_MIN_GRANULARITY ticks per runnable process when many
+ * are runnable.
+ * */
+
+#define CFS_TARGET_LATENCY          8           // ticks in which every runnable process should run once
+#define CFS_MIN_GRANULARITY         1           // the shortest time slice, in ticks
+#define CFS_VRUNTIME_TICK           0x10000     // virtual runtime of one tick with weight 1
+// a waking process is placed at most half a period behind the others
+#define CFS_SLEEPER_CREDIT          (CFS_TARGET_LATENCY * CFS_VRUNTIME_TICK / 2)
+
+extern struct sched_class cfs_sched_class;
+
+#endif /* !__KERN_SCHEDULE_CFS_SCHED_H__ */
@@ -0,0 +1,246 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <x86.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <mlfq_sched.h>
+
+#define mlfq_quantum(rq, level)         ((rq)->max_time_slice << (level))
+
+/*
+ * mlfq_refresh brings a process that missed a boost, because it was asleep
+ * or queued, up to level 0 with a new allotment.
+ */
+static inline void
+mlfq_refresh(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->mlfq_gen != rq->mlfq_gen) {
+        proc->mlfq_gen = rq->mlfq_gen;
+        proc->mlfq_level = 0;
+        proc->time_slice = mlfq_quantum(rq, 0);
+    }
+}
+
+static void
+mlfq_init(struct run_queue *rq) {
+    int i;
+    list_init(&(rq->run_list));
+    for (i = 0; i < MLFQ_LEVELS; i ++) {
+        list_init(rq->mlfq_run_list + i);
+    }
+    rq->proc_num = 0;
+    rq->mlfq_bitmap = 0;
+    rq->mlfq_gen = 1;
+    rq->mlfq_clock = 0;
+    rq->mlfq_curr = NULL;
+    rq->mlfq_slot = NULL;
+}
+
+/*
+ * mlfq_enqueue puts proc at the tail of its level. The running process,
+ * put back because a boost or a wakeup took the CPU from it, goes to the
+ * place rq->mlfq_slot kept for it (rq->mlfq_curr) instead: in the
+ * simulator it never left its queue.
+ */
+static void
+mlfq_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    mlfq_refresh(rq, proc);
+    if (proc->time_slice <= 0 || proc->time_slice > mlfq_quantum(rq, proc->mlfq_level)) {
+        proc->time_slice = mlfq_quantum(rq, proc->mlfq_level);
+    }
+    int level = proc->mlfq_level;
+    if (proc == rq->mlfq_curr && rq->mlfq_slot != NULL) {
+        list_add_after(rq->mlfq_slot, &(proc->run_link));
+        rq->mlfq_slot = NULL;
+    }
+    else {
+        list_add_before(rq->mlfq_run_list + level, &(proc->run_link));
+    }
+    rq->mlfq_bitmap |= (1 << level);
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+mlfq_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    mlfq_refresh(rq, proc);
+    list_del_init(&(proc->run_link));
+    if (list_empty(rq->mlfq_run_list + proc->mlfq_level)) {
+        rq->mlfq_bitmap &= ~(1 << proc->mlfq_level);
+    }
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+mlfq_pick_next(struct run_queue *rq) {
+    struct proc_struct *p = NULL;
+    if (rq->mlfq_bitmap != 0) {
+        list_entry_t *le = list_next(rq->mlfq_run_list + bsf(rq->mlfq_bitmap));
+        p = le2proc(le, run_link);
+    }
+    rq->mlfq_slot = NULL;
+    return p;
+}
+
+// mlfq_check_preempt - a process woken up above the running one takes the CPU at once
+static bool
+mlfq_check_preempt(struct run_queue *rq, struct proc_struct *proc, struct proc_struct *curr) {
+    if (!curr->need_resched && proc->mlfq_level < curr->mlfq_level) {
+        rq->mlfq_curr = curr;
+        rq->mlfq_slot = rq->mlfq_run_list + curr->mlfq_level;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * mlfq_boost moves every queued process to level 0. The lists are joined
+ * from the lowest level up, like the simulator does. The running process
+ * proc keeps its place: at the head of its level, or at the tail of the
+ * level it was just moved down to when it used up its allotment.
+ */
+static void
+mlfq_boost(struct run_queue *rq, struct proc_struct *proc, bool expired) {
+    list_entry_t *list = rq->mlfq_run_list, *slot = NULL;
+    int level;
+    rq->mlfq_gen ++;
+    for (level = MLFQ_LEVELS - 1; level > 0; level --) {
+        if (level == proc->mlfq_level && !expired) {
+            slot = list_prev(list);
+        }
+        list_splice_before(list, rq->mlfq_run_list + level);
+        if (level == proc->mlfq_level && expired) {
+            slot = list_prev(list);
+        }
+    }
+    rq->mlfq_bitmap = list_empty(list) ? 0 : 1;
+    if (proc->mlfq_level != 0) {
+        rq->mlfq_curr = proc;
+        rq->mlfq_slot = slot;
+        proc->need_resched = 1;
+    }
+    mlfq_refresh(rq, proc);
+}
+
+static void
+mlfq_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    bool expired = 0;
+    if (proc->time_slice > 0) {
+        proc->time_slice --;
+    }
+    if (proc->time_slice == 0) {
+        // the allotment at this level is used up, move down one level
+        if (proc->mlfq_level < MLFQ_LEVELS - 1) {
+            proc->mlfq_level ++;
+        }
+        proc->time_slice = mlfq_quantum(rq, proc->mlfq_level);
+        proc->need_resched = 1;
+        rq->mlfq_slot = NULL;
+        expired = 1;
+    }
+    if (++ rq->mlfq_clock % (MLFQ_BOOST_SLICES * rq->max_time_slice) == 0) {
+        mlfq_boost(rq, proc, expired);
+    }
+}
+
+struct sched_class mlfq_sched_class = {
+    .name = "mlfq_scheduler",
+    .init = mlfq_init,
+    .enqueue = mlfq_enqueue,
+    .dequeue = mlfq_dequeue,
+    .pick_next = mlfq_pick_next,
+    .proc_tick = mlfq_proc_tick,
+    .check_preempt = mlfq_check_preempt,
+};
+
+/* *
+ * check_mlfq - run three jobs on a run queue of its own, one tick at a time
+ * in the order of run_timer_list and schedule, and compare the job that
+ * runs in each tick with the trace of
+ *
+ *   ostep9-mlfq.py -n 4 -Q 2,4,8,16 -B 40 -i 3 -l 0,40,0:0,24,0:6,12,3 -c
+ * */
+
+#define CHECK_MLFQ_JOBS             3
+#define CHECK_MLFQ_IO_TIME          3
+
+static const char *check_mlfq_trace =
+    "0011002200111120002220000011111111222000001122000011112000000001111000000000";
+
+static struct {
+    int start, run, io_freq;
+    int left, io_done;
+} check_mlfq_jobs[CHECK_MLFQ_JOBS] = {
+    {0, 40, 0}, {0, 24, 0}, {6, 12, 3},
+};
+
+void
+check_mlfq(void) {
+    static struct run_queue check_rq;
+    static struct proc_struct check_procs[CHECK_MLFQ_JOBS];
+    struct run_queue *rq = &check_rq;
+    struct proc_struct *curr = NULL, *p;
+    int i, t, finished = 0;
+
+    assert(MLFQ_LEVELS == 4 && MLFQ_BOOST_SLICES == 20);
+    rq->max_time_slice = 2;
+    mlfq_sched_class.init(rq);
+    for (i = 0; i < CHECK_MLFQ_JOBS; i ++) {
+        p = check_procs + i;
+        memset(p, 0, sizeof(struct proc_struct));
+        p->state = PROC_UNINIT;
+        p->pid = i;
+        list_init(&(p->run_link));
+        check_mlfq_jobs[i].left = check_mlfq_jobs[i].run;
+    }
+
+    for (t = 0; finished < CHECK_MLFQ_JOBS; t ++) {
+        // the timers: jobs starting and i/o completing now
+        for (i = 0; i < CHECK_MLFQ_JOBS; i ++) {
+            p = check_procs + i;
+            if ((p->state == PROC_UNINIT && check_mlfq_jobs[i].start == t)
+                || (p->state == PROC_SLEEPING && check_mlfq_jobs[i].io_done == t)) {
+                p->state = PROC_RUNNABLE;
+                mlfq_sched_class.enqueue(rq, p);
+                if (curr != NULL && mlfq_sched_class.check_preempt(rq, p, curr)) {
+                    curr->need_resched = 1;
+                }
+            }
+        }
+        // the tick is charged to the job that ran in it, which may then exit or start an i/o
+        if (curr != NULL) {
+            mlfq_sched_class.proc_tick(rq, curr);
+            i = curr->pid;
+            if (-- check_mlfq_jobs[i].left == 0) {
+                curr->state = PROC_ZOMBIE;
+                finished ++;
+            }
+            else if (check_mlfq_jobs[i].io_freq != 0
+                     && (check_mlfq_jobs[i].run - check_mlfq_jobs[i].left) % check_mlfq_jobs[i].io_freq == 0) {
+                curr->state = PROC_SLEEPING;
+                check_mlfq_jobs[i].io_done = t + CHECK_MLFQ_IO_TIME;
+            }
+        }
+        if (curr == NULL || curr->state != PROC_RUNNABLE || curr->need_resched) {
+            if (curr != NULL) {
+                curr->need_resched = 0;
+                if (curr->state == PROC_RUNNABLE) {
+                    mlfq_sched_class.enqueue(rq, curr);
+                }
+            }
+            if ((curr = mlfq_sched_class.pick_next(rq)) != NULL) {
+                mlfq_sched_class.dequeue(rq, curr);
+            }
+        }
+        if (finished < CHECK_MLFQ_JOBS) {
+            assert(curr != NULL && check_mlfq_trace[t] == '0' + curr->pid);
+        }
+    }
+    assert(check_mlfq_trace[t - 1] == '\0' && rq->proc_num == 0 && rq->mlfq_bitmap == 0);
+
+    cprintf("check_mlfq() succeeded!\n");
+}
+
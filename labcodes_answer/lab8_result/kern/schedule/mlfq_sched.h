@@ -0,0 +1,28 @@
+#ifndef __KERN_SCHEDULE_MLFQ_SCHED_H__
+#define __KERN_SCHEDULE_MLFQ_SCHED_H__
+
+#include <sched.h>
+
+/* *
+ * mlfq - a multi-level feedback queue scheduler, as in OSTEP chapter 8.
+ *
+ * There are MLFQ_LEVELS run lists, level 0 runs first; a bitmap of the
+ * non-empty lists finds the next process with one bsf. A new process starts
+ * at level 0. Its allotment at a level is max_time_slice << level ticks and
+ * lasts across sleeps; once it is used up the process moves down one level.
+ * A process woken up at a higher level than the running one preempts it,
+ * and every MLFQ_BOOST_SLICES * max_time_slice ticks of CPU time all the
+ * processes go back to level 0.
+ *
+ * The rules are those of related_info/ostep/ostep9-mlfq.py without -S and
+ * -I; check_mlfq replays one of its traces.
+ * */
+
+#define MLFQ_BOOST_SLICES           20          // boost interval, in max_time_slice
+
+extern struct sched_class mlfq_sched_class;
+
+void check_mlfq(void);
+
+#endif /* !__KERN_SCHEDULE_MLFQ_SCHED_H__ */
+
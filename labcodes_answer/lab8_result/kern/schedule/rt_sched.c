@@ -0,0 +1,236 @@
+#include <defs.h>
+#include <list.h>
+#include <proc.h>
+#include <x86.h>
+#include <error.h>
+#include <clock.h>
+#include <assert.h>
+#include <rt_sched.h>
+
+// the run list of a FIFO or RR process, the highest priority has the lowest index
+#define rt_index(proc)                  (SCHED_PRIO_MAX - 1 - (proc)->rt_priority)
+
+// rt_before - is tick a before tick b? they may wrap around
+#define rt_before(a, b)                 ((int32_t)((a) - (b)) < 0)
+
+#define rt_util(proc)                   (((proc)->rt_runtime << RT_UTIL_SHIFT) / (proc)->rt_period)
+
+// rt_replenish - start a new period of proc, with a full budget
+static inline void
+rt_replenish(struct proc_struct *proc) {
+    proc->rt_deadline = ticks + proc->rt_period;
+    proc->rt_budget = proc->rt_runtime;
+}
+
+// rt_edf_insert - keep rt_edf_list sorted by deadline, FIFO among equal deadlines
+static void
+rt_edf_insert(struct run_queue *rq, struct proc_struct *proc) {
+    list_entry_t *list = &(rq->rt_edf_list), *le = list;
+    while ((le = list_next(le)) != list) {
+        if (rt_before(proc->rt_deadline, le2proc(le, run_link)->rt_deadline)) {
+            break;
+        }
+    }
+    list_add_before(le, &(proc->run_link));
+}
+
+static void
+rt_init(struct run_queue *rq) {
+    int i;
+    list_init(&(rq->run_list));
+    for (i = 0; i < SCHED_PRIO_MAX; i ++) {
+        list_init(rq->rt_run_list + i);
+    }
+    rq->rt_bitmap = 0;
+    list_init(&(rq->rt_edf_list));
+    list_init(&(rq->rt_throttled_list));
+    rq->rt_edf_util = 0;
+    rq->rt_preempted = NULL;
+    rq->proc_num = 0;
+}
+
+/*
+ * rt_enqueue puts a SCHED_DEADLINE process in deadline order, or on the
+ * throttled list while its budget is used up. A process waking up late in
+ * its period starts a new one when what is left of its budget would run
+ * it faster than it reserved. A FIFO or RR process goes to the tail of its
+ * priority, or back to the head when a wakeup took the CPU from it.
+ */
+static void
+rt_enqueue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(list_empty(&(proc->run_link)));
+    if (proc->policy == SCHED_DEADLINE) {
+        uint32_t left = proc->rt_deadline - ticks;
+        if ((int32_t)left <= 0 || (proc != current
+            && (uint64_t)proc->rt_budget * proc->rt_period > (uint64_t)left * proc->rt_runtime)) {
+            rt_replenish(proc);
+        }
+        if (proc->rt_budget == 0) {
+            list_add_before(&(rq->rt_throttled_list), &(proc->run_link));
+        }
+        else {
+            rt_edf_insert(rq, proc);
+        }
+    }
+    else {
+        list_entry_t *list = rq->rt_run_list + rt_index(proc);
+        if (proc->time_slice <= 0 || proc->time_slice > rq->max_time_slice) {
+            proc->time_slice = rq->max_time_slice;
+        }
+        if (proc == rq->rt_preempted) {
+            list_add_after(list, &(proc->run_link));
+            rq->rt_preempted = NULL;
+        }
+        else {
+            list_add_before(list, &(proc->run_link));
+        }
+        rq->rt_bitmap |= (1 << rt_index(proc));
+    }
+    proc->rq = rq;
+    rq->proc_num ++;
+}
+
+static void
+rt_dequeue(struct run_queue *rq, struct proc_struct *proc) {
+    assert(!list_empty(&(proc->run_link)) && proc->rq == rq);
+    list_del_init(&(proc->run_link));
+    if (proc->policy != SCHED_DEADLINE && list_empty(rq->rt_run_list + rt_index(proc))) {
+        rq->rt_bitmap &= ~(1 << rt_index(proc));
+    }
+    rq->proc_num --;
+}
+
+static struct proc_struct *
+rt_pick_next(struct run_queue *rq) {
+    rq->rt_preempted = NULL;
+    if (!list_empty(&(rq->rt_edf_list))) {
+        return le2proc(list_next(&(rq->rt_edf_list)), run_link);
+    }
+    if (rq->rt_bitmap != 0) {
+        return le2proc(list_next(rq->rt_run_list + bsf(rq->rt_bitmap)), run_link);
+    }
+    return NULL;
+}
+
+static void
+rt_proc_tick(struct run_queue *rq, struct proc_struct *proc) {
+    if (proc->policy == SCHED_DEADLINE) {
+        if (proc->rt_budget > 0) {
+            proc->rt_budget --;
+        }
+        if (!rt_before(ticks, proc->rt_deadline)) {
+            // the period is over, what is left of the budget is lost
+            rt_replenish(proc);
+            proc->need_resched = 1;
+        }
+        else if (proc->rt_budget == 0) {
+            proc->need_resched = 1;
+        }
+    }
+    else if (proc->policy == SCHED_RR) {
+        if (proc->time_slice > 0) {
+            proc->time_slice --;
+        }
+        if (proc->time_slice == 0) {
+            proc->need_resched = 1;
+        }
+    }
+}
+
+// rt_check_preempt - an earlier deadline, or any deadline over a fixed priority, or a higher priority
+static bool
+rt_check_preempt(struct run_queue *rq, struct proc_struct *proc, struct proc_struct *curr) {
+    bool preempt;
+    if (curr->need_resched) {
+        return 0;
+    }
+    if (proc->policy == SCHED_DEADLINE) {
+        preempt = (curr->policy != SCHED_DEADLINE || rt_before(proc->rt_deadline, curr->rt_deadline));
+    }
+    else {
+        preempt = (curr->policy != SCHED_DEADLINE && proc->rt_priority > curr->rt_priority);
+    }
+    if (preempt) {
+        rq->rt_preempted = curr;
+    }
+    return preempt;
+}
+
+// rt_clock_tick - release the throttled processes whose next period began
+static void
+rt_clock_tick(struct run_queue *rq) {
+    list_entry_t *list = &(rq->rt_throttled_list), *le = list_next(list);
+    while (le != list) {
+        struct proc_struct *proc = le2proc(le, run_link);
+        le = list_next(le);
+        if (!rt_before(ticks, proc->rt_deadline)) {
+            list_del_init(&(proc->run_link));
+            rt_replenish(proc);
+            rt_edf_insert(rq, proc);
+            // the rt class comes before all the others
+            if (current->policy == SCHED_NORMAL || rt_check_preempt(rq, proc, current)) {
+                current->need_resched = 1;
+            }
+        }
+    }
+}
+
+struct sched_class rt_sched_class = {
+    .name = "rt_scheduler",
+    .init = rt_init,
+    .enqueue = rt_enqueue,
+    .dequeue = rt_dequeue,
+    .pick_next = rt_pick_next,
+    .proc_tick = rt_proc_tick,
+    .check_preempt = rt_check_preempt,
+    .clock_tick = rt_clock_tick,
+};
+
+/* *
+ * rt_setscheduler - change the policy of proc, which is on no run queue.
+ * A SCHED_DEADLINE reservation that does not fit fails with -E_BUSY.
+ * */
+int
+rt_setscheduler(struct run_queue *rq, struct proc_struct *proc, int policy, struct sched_param *param) {
+    uint32_t util = 0;
+    switch (policy) {
+    case SCHED_NORMAL:
+        break;
+    case SCHED_FIFO:
+    case SCHED_RR:
+        if (param == NULL || param->sched_priority <= 0 || param->sched_priority >= SCHED_PRIO_MAX) {
+            return -E_INVAL;
+        }
+        break;
+    case SCHED_DEADLINE:
+        if (param == NULL || param->sched_runtime == 0 || param->sched_runtime > param->sched_period
+            || param->sched_period > RT_UTIL_ONE * RT_UTIL_ONE) {
+            return -E_INVAL;
+        }
+        util = (param->sched_runtime << RT_UTIL_SHIFT) / param->sched_period;
+        if (rq->rt_edf_util - ((proc->policy == SCHED_DEADLINE) ? rt_util(proc) : 0) + util > RT_EDF_UTIL_MAX) {
+            return -E_BUSY;
+        }
+        break;
+    default:
+        return -E_INVAL;
+    }
+
+    if (proc->policy == SCHED_DEADLINE) {
+        rq->rt_edf_util -= rt_util(proc);
+    }
+    proc->policy = policy;
+    proc->rt_priority = 0;
+    proc->time_slice = 0;
+    if (policy == SCHED_FIFO || policy == SCHED_RR) {
+        proc->rt_priority = param->sched_priority;
+    }
+    else if (policy == SCHED_DEADLINE) {
+        proc->rt_runtime = param->sched_runtime;
+        proc->rt_period = param->sched_period;
+        rq->rt_edf_util += util;
+        rt_replenish(proc);
+    }
+    return 0;
+}
+
@@ -0,0 +1,29 @@
+#ifndef __KERN_SCHEDULE_RT_SCHED_H__
+#define __KERN_SCHEDULE_RT_SCHED_H__
+
+#include <sched.h>
+
+/* *
+ * rt - the real-time class, ahead of the fair class in the class stack.
+ *
+ * SCHED_DEADLINE processes run first, earliest absolute deadline first.
+ * Each one reserved sched_runtime ticks in every sched_period ticks; once
+ * the budget of a period is used up it is throttled until the next period
+ * begins, so it can not take more than it reserved. The reservations are
+ * admitted while their total utilization stays under RT_EDF_UTIL_MAX.
+ *
+ * SCHED_FIFO and SCHED_RR processes come next, one run list per priority
+ * and a bitmap of the non-empty ones. A FIFO process runs until it sleeps
+ * or yields, an RR process for max_time_slice ticks at a time.
+ * */
+
+#define RT_UTIL_SHIFT               10
+#define RT_UTIL_ONE                 (1 << RT_UTIL_SHIFT)
+#define RT_EDF_UTIL_MAX             (RT_UTIL_ONE * 95 / 100)    // leave the other classes some time
+
+extern struct sched_class rt_sched_class;
+
+int rt_setscheduler(struct run_queue *rq, struct proc_struct *proc, int policy, struct sched_param *param);
+
+#endif /* !__KERN_SCHEDULE_RT_SCHED_H__ */
+
@@ -1,172 +1,598 @@
 #include <list.h>
 #include <sync.h>
+#include <spinlock.h>
 #include <proc.h>
 #include <sched.h>
 #include <stdio.h>
 #include <assert.h>
+#include <x86.h>
+#include <pmm.h>
+#include <clock.h>
 #include <default_sched.h>
+#include <cfs_sched.h>
+#include <mlfq_sched.h>
+#include <rt_sched.h>
 
-static list_entry_t timer_list;
+// the scheduler class is chosen when the kernel is built, e.g. make SCHED=cfs or SCHED=mlfq
+#ifndef SCHED_CLASS
+#define SCHED_CLASS                 default_sched_class
+#endif
 
-static struct sched_class *sched_class;
+/* *
+ * The timers wait in a hierarchical timing wheel, as in Linux: TVR_SIZE
+ * slots for the next TVR_SIZE ticks, then four levels of TVN_SIZE slots,
+ * each slot of a level as long as the whole level below it. add_timer and
+ * del_timer are O(1); when the slots of a level have all gone by, the next
+ * slot of the level above is cascaded, spread over the slots below.
+ *
+ * A tick of the wheel is a unit of clock_units, 1/TIMER_HZ second, not a
+ * tick of the scheduler. The wheel is not turned at each of them: cpu 0
+ * sleeps until timer_next_event, and run_timer_list then skips the ticks
+ * with nothing to do up to clock_units.
+ * */
+#define TVN_BITS                    6
+#define TVR_BITS                    8
+#define TVN_SIZE                    (1 << TVN_BITS)
+#define TVR_SIZE                    (1 << TVR_BITS)
+#define TVN_MASK                    (TVN_SIZE - 1)
+#define TVR_MASK                    (TVR_SIZE - 1)
+#define TVN_LEVELS                  4
 
-static struct run_queue *rq;
+// the slot of level n (1..TVN_LEVELS) for tick
+#define TVN_INDEX(tick, n)          (((tick) >> (TVR_BITS + ((n) - 1) * TVN_BITS)) & TVN_MASK)
+
+static list_entry_t tv1[TVR_SIZE];
+static list_entry_t tvn[TVN_LEVELS][TVN_SIZE];
+// the next tick the wheel handles
+static unsigned int timer_jiffies;
+// the timers added and not yet expired or deleted
+static int timer_count;
+static spinlock_t timer_lock;
+
+static void timer_wheel_init(unsigned int jiffies);
+static void check_timer(void);
+
+// the classes in the order schedule consults them: a runnable process of
+// a class always runs before those of the classes after it
+#define SCHED_RT                    0
+#define SCHED_FAIR                  1
+#define SCHED_NCLASS                2
+
+static struct sched_class *sched_class[SCHED_NCLASS] = {
+    [SCHED_RT]                      &rt_sched_class,
+    [SCHED_FAIR]                    &SCHED_CLASS,
+};
+
+// every cpu has a run queue of each class, locked by its rq_lock; a process
+// goes to the run queues of the cpu it last ran on
+static struct run_queue __rq[NCPU][SCHED_NCLASS];
+static spinlock_t rq_lock[NCPU];
+
+#define sched_class_of(proc)        (((proc)->policy != SCHED_NORMAL) ? SCHED_RT : SCHED_FAIR)
+#define cpu_rq(id, i)               (__rq[id] + (i))
+
+// proc_running - is proc the current process of its cpu?
+#define proc_running(proc)          (cpu_curr((proc)->cpu) == (proc))
 
 static inline void
 sched_class_enqueue(struct proc_struct *proc) {
     if (proc != idleproc) {
-        sched_class->enqueue(rq, proc);
+        int i = sched_class_of(proc);
+        sched_class[i]->enqueue(cpu_rq(proc->cpu, i), proc);
     }
 }
 
 static inline void
 sched_class_dequeue(struct proc_struct *proc) {
-    sched_class->dequeue(rq, proc);
+    int i = sched_class_of(proc);
+    sched_class[i]->dequeue(cpu_rq(proc->cpu, i), proc);
 }
 
 static inline struct proc_struct *
-sched_class_pick_next(void) {
-    return sched_class->pick_next(rq);
+sched_class_pick_next(int id) {
+    struct proc_struct *next;
+    int i;
+    for (i = 0; i < SCHED_NCLASS; i ++) {
+        if ((next = sched_class[i]->pick_next(cpu_rq(id, i))) != NULL) {
+            return next;
+        }
+    }
+    return NULL;
 }
 
 static void
 sched_class_proc_tick(struct proc_struct *proc) {
+    int i, id = cpunum();
+    for (i = 0; i < SCHED_NCLASS; i ++) {
+        if (sched_class[i]->clock_tick != NULL) {
+            sched_class[i]->clock_tick(cpu_rq(id, i));
+        }
+    }
     if (proc != idleproc) {
-        sched_class->proc_tick(rq, proc);
+        i = sched_class_of(proc);
+        sched_class[i]->proc_tick(cpu_rq(id, i), proc);
     }
     else {
         proc->need_resched = 1;
     }
 }
 
-static struct run_queue __rq;
+// sched_class_check_preempt - let proc, just woken up, take the CPU from the current process of its cpu at once
+static void
+sched_class_check_preempt(struct proc_struct *proc) {
+    struct proc_struct *curr = cpu_curr(proc->cpu);
+    if (curr == NULL) {
+        return ;
+    }
+    if (curr == cpu_idleproc(proc->cpu)) {
+        // an idle cpu halts until an interrupt
+        curr->need_resched = 1;
+#ifdef CONFIG_SMP
+        smp_resched(proc->cpu);
+#endif
+        return ;
+    }
+    int i = sched_class_of(proc), j = sched_class_of(curr);
+    if (i < j || (i == j && sched_class[i]->check_preempt != NULL
+                  && sched_class[i]->check_preempt(cpu_rq(proc->cpu, i), proc, curr))) {
+        curr->need_resched = 1;
+#ifdef CONFIG_SMP
+        smp_resched(proc->cpu);
+#endif
+    }
+}
+
+#ifdef CONFIG_SMP
+// sched_kick_idle - proc waits on a busy cpu, wake up an idle cpu to steal it
+static void
+sched_kick_idle(struct proc_struct *proc) {
+    int id;
+    if (sched_class_of(proc) != SCHED_FAIR || cpu_curr(proc->cpu)->need_resched) {
+        return ;
+    }
+    for (id = 0; id < ncpu; id ++) {
+        if (cpus[id].started && cpu_curr(id) == cpu_idleproc(id)) {
+            cpu_curr(id)->need_resched = 1;
+            smp_resched(id);
+            return ;
+        }
+    }
+}
+
+/* *
+ * sched_steal - the run queues of cpu id are empty: take the next process
+ * of the fair class from the cpu with the most of them queued. The rt class
+ * keeps its processes on their cpu, whose admission control counted them.
+ * */
+static struct proc_struct *
+sched_steal(int id) {
+    struct proc_struct *proc = NULL;
+    struct run_queue *rq;
+    unsigned int most = 0;
+    int i, busiest = -1;
+    for (i = 0; i < ncpu; i ++) {
+        if (i != id && cpu_rq(i, SCHED_FAIR)->proc_num > most) {
+            most = cpu_rq(i, SCHED_FAIR)->proc_num;
+            busiest = i;
+        }
+    }
+    // the busiest cpu may be stealing too, do not wait for its lock
+    if (busiest < 0 || !spin_trylock(rq_lock + busiest)) {
+        return NULL;
+    }
+    rq = cpu_rq(busiest, SCHED_FAIR);
+    if ((proc = sched_class[SCHED_FAIR]->pick_next(rq)) != NULL) {
+        sched_class[SCHED_FAIR]->dequeue(rq, proc);
+        proc->cpu = id;
+    }
+    spin_unlock(rq_lock + busiest);
+    if (proc != NULL) {
+        // it may hold a kmap made on its old cpu, whose slot the TLB here may map to another page
+        lcr3(rcr3());
+    }
+    return proc;
+}
+#endif
 
 void
 sched_init(void) {
-    list_init(&timer_list);
+    int id, i;
+    spinlock_init(&timer_lock);
+    check_timer();
+    timer_wheel_init(0);
 
-    sched_class = &default_sched_class;
+    // check_mlfq uses a run queue of its own, it runs whatever class is chosen
+    check_mlfq();
 
-    rq = &__rq;
-    rq->max_time_slice = 5;
-    sched_class->init(rq);
+    for (id = 0; id < NCPU; id ++) {
+        spinlock_init(rq_lock + id);
+        for (i = 0; i < SCHED_NCLASS; i ++) {
+            cpu_rq(id, i)->max_time_slice = 5;
+            sched_class[i]->init(cpu_rq(id, i));
+        }
+    }
 
-    cprintf("sched class: %s\n", sched_class->name);
+    cprintf("sched class: %s\n", sched_class[SCHED_FAIR]->name);
 }
 
 void
 wakeup_proc(struct proc_struct *proc) {
     assert(proc->state != PROC_ZOMBIE);
     bool intr_flag;
-    local_intr_save(intr_flag);
+    int id = proc->cpu;
+    spin_lock_irqsave(rq_lock + id, intr_flag);
     {
         if (proc->state != PROC_RUNNABLE) {
             proc->state = PROC_RUNNABLE;
             proc->wait_state = 0;
-            if (proc != current) {
+            if (!proc_running(proc)) {
                 sched_class_enqueue(proc);
+                sched_class_check_preempt(proc);
+#ifdef CONFIG_SMP
+                sched_kick_idle(proc);
+#endif
             }
         }
         else {
             warn("wakeup runnable process.\n");
         }
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(rq_lock + id, intr_flag);
 }
 
 void
 schedule(void) {
     bool intr_flag;
     struct proc_struct *next;
-    local_intr_save(intr_flag);
+    int id = cpunum();
+    spin_lock_irqsave(rq_lock + id, intr_flag);
     {
         current->need_resched = 0;
         if (current->state == PROC_RUNNABLE) {
             sched_class_enqueue(current);
         }
-        if ((next = sched_class_pick_next()) != NULL) {
+        if ((next = sched_class_pick_next(id)) != NULL) {
             sched_class_dequeue(next);
         }
-        if (next == NULL) {
-            next = idleproc;
+    }
+    // current is queued before switch_to saved its context; the big kernel
+    // lock keeps the other cpus from stealing it until then
+    spin_unlock(rq_lock + id);
+#ifdef CONFIG_SMP
+    if (next == NULL) {
+        next = sched_steal(id);
+    }
+#endif
+    if (next == NULL) {
+        next = idleproc;
+    }
+    else if (current == idleproc) {
+        // the tick of this cpu was stopped while it was idle
+        clock_resume();
+    }
+    next->runs ++;
+    if (next != current) {
+        proc_run(next);
+    }
+    local_intr_restore(intr_flag);
+}
+
+// timer_wheel_init - empty the timer wheel, its next tick is jiffies
+static void
+timer_wheel_init(unsigned int jiffies) {
+    int i, n;
+    for (i = 0; i < TVR_SIZE; i ++) {
+        list_init(tv1 + i);
+    }
+    for (n = 0; n < TVN_LEVELS; n ++) {
+        for (i = 0; i < TVN_SIZE; i ++) {
+            list_init(tvn[n] + i);
         }
-        next->runs ++;
-        if (next != current) {
-            proc_run(next);
+    }
+    timer_jiffies = jiffies;
+    timer_count = 0;
+}
+
+// __add_timer - put timer in the slot for its expires, with timer_lock held
+static void
+__add_timer(timer_t *timer) {
+    unsigned int expires = timer->expires, idx = expires - timer_jiffies;
+    list_entry_t *vec;
+    if ((int)idx < 0) {
+        // cascaded late, it expires with the next tick
+        vec = tv1 + (timer_jiffies & TVR_MASK);
+    }
+    else if (idx < TVR_SIZE) {
+        vec = tv1 + (expires & TVR_MASK);
+    }
+    else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
+        vec = tvn[0] + TVN_INDEX(expires, 1);
+    }
+    else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
+        vec = tvn[1] + TVN_INDEX(expires, 2);
+    }
+    else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
+        vec = tvn[2] + TVN_INDEX(expires, 3);
+    }
+    else {
+        vec = tvn[3] + TVN_INDEX(expires, 4);
+    }
+    list_add_before(vec, &(timer->timer_link));
+}
+
+// cascade - spread the timers of slot index of level n over the levels below, return index
+static int
+cascade(int n, int index) {
+    list_entry_t *head = tvn[n - 1] + index, *le;
+    while ((le = list_next(head)) != head) {
+        list_del(le);
+        __add_timer(le2timer(le, timer_link));
+    }
+    return index;
+}
+
+// timer_wheel_tick - move the timers expiring at the next tick of the wheel to expired
+static void
+timer_wheel_tick(list_entry_t *expired) {
+    int index = timer_jiffies & TVR_MASK, n;
+    list_entry_t *head = tv1 + index;
+    if (index == 0) {
+        for (n = 1; n <= TVN_LEVELS && cascade(n, TVN_INDEX(timer_jiffies, n)) == 0; n ++) {
+            /* do nothing */;
         }
     }
-    local_intr_restore(intr_flag);
+    timer_jiffies ++;
+    list_splice_before(expired, head);
 }
 
+// timer_wheel_next - the first tick of the wheel with work to do, a slot of timers to expire or to cascade
+static bool
+timer_wheel_next(unsigned int *next) {
+    unsigned int start, dist, best = 0;
+    int index = timer_jiffies & TVR_MASK, i, n, bits;
+    bool found = 0;
+    if (timer_count == 0) {
+        return 0;
+    }
+    for (i = 0; i < TVR_SIZE; i ++) {
+        if (!list_empty(tv1 + ((index + i) & TVR_MASK))) {
+            best = i, found = 1;
+            break;
+        }
+    }
+    // a cascade may come before that
+    for (n = 1; n <= TVN_LEVELS; n ++) {
+        // level n cascades at the ticks with the bits of the levels below all 0
+        bits = TVR_BITS + (n - 1) * TVN_BITS;
+        start = ((timer_jiffies - 1) | ((1 << bits) - 1)) + 1;
+        index = TVN_INDEX(start, n);
+        for (i = 0; i < TVN_SIZE; i ++) {
+            if (!list_empty(tvn[n - 1] + ((index + i) & TVN_MASK))) {
+                dist = start + ((unsigned int)i << bits) - timer_jiffies;
+                if (!found || dist < best) {
+                    best = dist, found = 1;
+                }
+                break;
+            }
+        }
+    }
+    *next = timer_jiffies + best;
+    return found;
+}
+
+// timer_wheel_advance - handle the ticks of the wheel up to now, move the expired timers to expired
+static void
+timer_wheel_advance(unsigned int now, list_entry_t *expired) {
+    unsigned int next;
+    while ((int)(now - timer_jiffies) >= 0) {
+        // a few ticks are quicker to turn one by one than to look for the next event
+        if (now - timer_jiffies >= TVR_SIZE) {
+            if (!timer_wheel_next(&next) || next - timer_jiffies > now - timer_jiffies) {
+                // nothing to do up to now
+                timer_jiffies = now + 1;
+                break;
+            }
+            timer_jiffies = next;
+        }
+        timer_wheel_tick(expired);
+    }
+}
+
+// timer_next_event - the tick of the wheel (of clock_units) cpu 0 has to wake up at, if any
+bool
+timer_next_event(unsigned int *next) {
+    bool intr_flag, ret;
+    spin_lock_irqsave(&timer_lock, intr_flag);
+    {
+        ret = timer_wheel_next(next);
+    }
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
+    return ret;
+}
+
+// add_timer - timer->expires is in units of 1/TIMER_HZ second from now
 void
 add_timer(timer_t *timer) {
     bool intr_flag;
-    local_intr_save(intr_flag);
+    unsigned int now = clock_units(), expires;
+    spin_lock_irqsave(&timer_lock, intr_flag);
     {
         assert(timer->expires > 0 && timer->proc != NULL);
         assert(list_empty(&(timer->timer_link)));
-        list_entry_t *le = list_next(&timer_list);
-        while (le != &timer_list) {
-            timer_t *next = le2timer(le, timer_link);
-            if (timer->expires < next->expires) {
-                next->expires -= timer->expires;
-                break;
-            }
-            timer->expires -= next->expires;
-            le = list_next(le);
+        if (timer_count ++ == 0) {
+            // an empty wheel has not turned while cpu 0 slept
+            timer_jiffies = now;
         }
-        list_add_before(le, &(timer->timer_link));
+        if (timer->expires > MAX_TIMER_OFFSET) {
+            timer->expires = MAX_TIMER_OFFSET;
+        }
+        expires = timer->expires += now;
+        __add_timer(timer);
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
+    clock_timer_added(expires);
 }
 
 void
 del_timer(timer_t *timer) {
     bool intr_flag;
-    local_intr_save(intr_flag);
+    spin_lock_irqsave(&timer_lock, intr_flag);
     {
         if (!list_empty(&(timer->timer_link))) {
-            if (timer->expires != 0) {
-                list_entry_t *le = list_next(&(timer->timer_link));
-                if (le != &timer_list) {
-                    timer_t *next = le2timer(le, timer_link);
-                    next->expires += timer->expires;
-                }
-            }
             list_del_init(&(timer->timer_link));
+            timer_count --;
         }
     }
-    local_intr_restore(intr_flag);
+    spin_unlock_irqrestore(&timer_lock, intr_flag);
 }
 
+/* *
+ * run_timer_list - called at each timer interrupt of each cpu: cpu 0 expires
+ * the timers, a cpu with a tick due charges it to its process, and each one
+ * arms its timer for its next event. The tick is accounted first, so that
+ * the wheel turns up to the time of this interrupt, not of the last one.
+ * */
 void
 run_timer_list(void) {
-    bool intr_flag;
+    bool intr_flag, tick;
     local_intr_save(intr_flag);
     {
-        list_entry_t *le = list_next(&timer_list);
-        if (le != &timer_list) {
+        tick = clock_tick();
+    }
+    local_intr_restore(intr_flag);
+    if (cpunum() == 0) {
+        list_entry_t expired, *le;
+        list_init(&expired);
+        spin_lock_irqsave(&timer_lock, intr_flag);
+        timer_wheel_advance(clock_units(), &expired);
+        while ((le = list_next(&expired)) != &expired) {
             timer_t *timer = le2timer(le, timer_link);
-            assert(timer->expires != 0);
-            timer->expires --;
-            while (timer->expires == 0) {
-                le = list_next(le);
-                struct proc_struct *proc = timer->proc;
-                if (proc->wait_state != 0) {
-                    assert(proc->wait_state & WT_INTERRUPTED);
-                }
-                else {
-                    warn("process %d's wait_state == 0.\n", proc->pid);
-                }
-                wakeup_proc(proc);
-                del_timer(timer);
-                if (le == &timer_list) {
-                    break;
-                }
-                timer = le2timer(le, timer_link);
+            struct proc_struct *proc = timer->proc;
+            list_del_init(le);
+            timer_count --;
+            if (proc->wait_state != 0) {
+                assert(proc->wait_state & WT_INTERRUPTED);
             }
+            else {
+                warn("process %d's wait_state == 0.\n", proc->pid);
+            }
+            wakeup_proc(proc);
+        }
+        spin_unlock_irqrestore(&timer_lock, intr_flag);
+    }
+    local_intr_save(intr_flag);
+    {
+        if (tick) {
+            sched_class_proc_tick(current);
         }
-        sched_class_proc_tick(current);
+        clock_program(current != idleproc);
     }
     local_intr_restore(intr_flag);
 }
+
+#define CHECK_TIMERS                100000
+
+/* *
+ * check_timer - fire timers on every level of the wheel, across the wrap of
+ * the tick count, turning the wheel a tick at a time and then in leaps as
+ * run_timer_list does; then time arming and cancelling CHECK_TIMERS timers.
+ * */
+static void
+check_timer(void) {
+    static const unsigned int check_expires[] = {
+        1, 2, 255, 256, 257, 300, 16383, 16384, 16385, 70000, 1048575, 1048576, 1100000,
+    };
+    const int nr_check = sizeof(check_expires) / sizeof(check_expires[0]);
+    const unsigned int base = -1000, steps[] = {1, 7777};
+    timer_t check[sizeof(check_expires) / sizeof(check_expires[0])], cancelled, *timers;
+    // the timers are taken off the wheel here, their process is never woken up
+    struct proc_struct *dummy = (struct proc_struct *)1;
+    list_entry_t expired, *le;
+    unsigned int t, last, fired, seed = 1;
+    struct Page *page;
+    size_t npages;
+    uint32_t start, armed;
+    int i, k;
+
+    for (k = 0; k < sizeof(steps) / sizeof(steps[0]); k ++) {
+        timer_wheel_init(base);
+        for (i = 0; i <= nr_check; i ++) {
+            timer_t *timer = (i < nr_check) ? check + i : &cancelled;
+            timer_init(timer, dummy, base + ((i < nr_check) ? check_expires[i] : 500));
+            __add_timer(timer);
+            timer_count ++;
+        }
+        list_init(&expired);
+        fired = 0;
+        for (last = 0, t = steps[k]; last < check_expires[nr_check - 1]; last = t, t += steps[k]) {
+            if (last < 400 && t >= 400) {
+                list_del_init(&(cancelled.timer_link));
+                timer_count --;
+            }
+            timer_wheel_advance(base + t, &expired);
+            while ((le = list_next(&expired)) != &expired) {
+                list_del_init(le);
+                timer_count --;
+                i = le2timer(le, timer_link) - check;
+                assert(i >= 0 && i < nr_check && check_expires[i] > last && check_expires[i] <= t);
+                fired ++;
+            }
+        }
+        assert(fired == nr_check && timer_count == 0);
+    }
+
+    npages = ROUNDUP(CHECK_TIMERS * sizeof(timer_t), PGSIZE) / PGSIZE;
+    assert((page = alloc_pages(npages)) != NULL);
+    timers = page2kva(page);
+    start = (uint32_t)rdtsc();
+    for (i = 0; i < CHECK_TIMERS; i ++) {
+        seed = seed * 1103515245 + 12345;
+        add_timer(timer_init(timers + i, dummy, (seed >> 8) % 1000000 + 1));
+    }
+    armed = (uint32_t)rdtsc();
+    for (i = 0; i < CHECK_TIMERS; i ++) {
+        del_timer(timers + i);
+    }
+    cprintf("check_timer: %d timers, %d cycles to arm and %d to cancel each.\n", CHECK_TIMERS,
+            (armed - start) / CHECK_TIMERS, ((uint32_t)rdtsc() - armed) / CHECK_TIMERS);
+    free_pages(page, npages);
+    assert(timer_count == 0);
+
+    // a timeout too long for the wheel is cut, it does not fire with the next tick
+    add_timer(timer_init(&cancelled, dummy, -1));
+    list_init(&expired);
+    timer_wheel_advance(clock_units() + TVR_SIZE, &expired);
+    assert(list_empty(&expired) && cancelled.expires - clock_units() > MAX_TIMER_OFFSET - TVR_SIZE);
+    del_timer(&cancelled);
+    assert(timer_count == 0);
+    cprintf("check_timer() succeeded!\n");
+}
+
+// sched_setscheduler - move proc to the class and the parameters of policy
+int
+sched_setscheduler(struct proc_struct *proc, int policy, struct sched_param *param) {
+    int ret;
+    bool intr_flag;
+    int id = proc->cpu;
+    spin_lock_irqsave(rq_lock + id, intr_flag);
+    {
+        // a runnable process that is not running is on the run queue of its class
+        bool queued = (proc->state == PROC_RUNNABLE && !proc_running(proc));
+        if (queued) {
+            sched_class_dequeue(proc);
+        }
+        ret = rt_setscheduler(cpu_rq(id, SCHED_RT), proc, policy, param);
+        if (queued) {
+            sched_class_enqueue(proc);
+            sched_class_check_preempt(proc);
+        }
+        else if (proc_running(proc)) {
+            proc->need_resched = 1;
+#ifdef CONFIG_SMP
+            smp_resched(id);
+#endif
+        }
+    }
+    spin_unlock_irqrestore(rq_lock + id, intr_flag);
+    return ret;
+}
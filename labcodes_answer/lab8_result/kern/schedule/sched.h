@@ -4,15 +4,21 @@
 #include <defs.h>
 #include <list.h>
 #include <skew_heap.h>
+#include <rb_tree.h>
+#include <sched_param.h>
 
 struct proc_struct;
 
 typedef struct {
-    unsigned int expires;
+    unsigned int expires;               // 1/TIMER_HZ seconds from now; once added, the tick of the wheel it expires at
     struct proc_struct *proc;
-    list_entry_t timer_link;
+    list_entry_t timer_link;            // in a slot of the timer wheel
 } timer_t;
 
+// the longest timeout the wheel takes, a longer one is cut to it: __add_timer
+// sees a timer more than INT_MAX ticks ahead as one cascaded late
+#define MAX_TIMER_OFFSET                0x3FFFFFFF
+
 #define le2timer(le, member)            \
 to_struct((le), timer_t, member)
 
@@ -26,6 +32,8 @@ timer_init(timer_t *timer, struct proc_struct *proc, int expires) {
 
 struct run_queue;
 
+#define MLFQ_LEVELS                 4           // run lists of the mlfq scheduler
+
 // The introduction of scheduling classes is borrrowed from Linux, and makes the 
 // core scheduler quite extensible. These classes (the scheduler modules) encapsulate 
 // the scheduling policies. 
@@ -42,6 +50,10 @@ struct sched_class {
     struct proc_struct *(*pick_next)(struct run_queue *rq);
     // dealer of the time-tick
     void (*proc_tick)(struct run_queue *rq, struct proc_struct *proc);
+    // should proc, just woken up, take the CPU from curr of the same class? may be NULL
+    bool (*check_preempt)(struct run_queue *rq, struct proc_struct *proc, struct proc_struct *curr);
+    // called on every tick, whatever runs, may be NULL
+    void (*clock_tick)(struct run_queue *rq);
     /* for SMP support in the future
      *  load_balance
      *     void (*load_balance)(struct rq* rq);
@@ -57,6 +69,24 @@ struct run_queue {
     int max_time_slice;
     // For LAB6 ONLY
     skew_heap_entry_t *lab6_run_pool;
+    // for the cfs scheduler
+    rb_tree *cfs_tree;
+    uint32_t min_vruntime;
+    uint32_t total_weight;
+    // for the mlfq scheduler
+    list_entry_t mlfq_run_list[MLFQ_LEVELS];
+    uint32_t mlfq_bitmap;
+    uint32_t mlfq_gen;
+    uint32_t mlfq_clock;
+    struct proc_struct *mlfq_curr;
+    list_entry_t *mlfq_slot;
+    // for the rt scheduler
+    list_entry_t rt_run_list[SCHED_PRIO_MAX];
+    uint32_t rt_bitmap;
+    list_entry_t rt_edf_list;
+    list_entry_t rt_throttled_list;
+    uint32_t rt_edf_util;
+    struct proc_struct *rt_preempted;
 };
 
 void sched_init(void);
@@ -64,7 +94,9 @@ void wakeup_proc(struct proc_struct *proc);
 void schedule(void);
 void add_timer(timer_t *timer);
 void del_timer(timer_t *timer);
+bool timer_next_event(unsigned int *next);
 void run_timer_list(void);
+int sched_setscheduler(struct proc_struct *proc, int policy, struct sched_param *param);
 
 #endif /* !__KERN_SCHEDULE_SCHED_H__ */
 
@@ -0,0 +1,114 @@
+#include <defs.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <error.h>
+#include <wait.h>
+#include <proc.h>
+#include <sched.h>
+#include <sync.h>
+#include <pmm.h>
+#include <vmm.h>
+#include <sig.h>
+#include <futex.h>
+
+static wait_queue_t futex_queues[FUTEX_HASH_SIZE];
+
+// a waiter on a futex, the wait_t is queued on the bucket of key
+struct futex_wait {
+    wait_t wait;
+    struct mm_struct *mm;       // the mm of the word
+    uintptr_t key;              // user address of the word
+};
+
+#define wait2futex(wait)            \
+    to_struct((wait), struct futex_wait, wait)
+
+#define futex_queue(key)            \
+    (futex_queues + hash32((key) >> 2, FUTEX_HASH_SHIFT))
+
+void
+futex_init(void) {
+    int i;
+    for (i = 0; i < FUTEX_HASH_SIZE; i ++) {
+        wait_queue_init(futex_queues + i);
+    }
+}
+
+// futex_wait - sleep on the word at uaddr if it still holds val
+static int
+futex_wait(struct mm_struct *mm, uintptr_t uaddr, int val) {
+    struct futex_wait __fw, *fw = &__fw;
+    wait_queue_t *queue;
+    int ret, cur;
+
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    if (!copy_from_user(mm, &cur, (void *)uaddr, sizeof(int), 1)) {
+        ret = -E_INVAL;
+        goto out;
+    }
+    if (cur != val) {
+        ret = -E_AGAIN;
+        goto out;
+    }
+    fw->mm = mm, fw->key = uaddr;
+    queue = futex_queue(fw->key);
+    wait_current_set(queue, &(fw->wait), WT_FUTEX);
+    local_intr_restore(intr_flag);
+
+    schedule();
+
+    local_intr_save(intr_flag);
+    wait_current_del(queue, &(fw->wait));
+    if (fw->wait.wakeup_flags == WT_FUTEX) {
+        ret = 0;
+    }
+    else {
+        ret = (current->flags & PF_EXITING) ? -E_KILLED : -E_INTR;
+    }
+out:
+    local_intr_restore(intr_flag);
+    return ret;
+}
+
+// futex_wake - wake up to n waiters of the word at uaddr, return how many were woken
+static int
+futex_wake(struct mm_struct *mm, uintptr_t uaddr, int n) {
+    int ret = 0;
+    bool intr_flag;
+    local_intr_save(intr_flag);
+    {
+        wait_queue_t *queue = futex_queue(uaddr);
+        wait_t *wait = wait_queue_first(queue), *next;
+        for (; wait != NULL && ret < n; wait = next) {
+            next = wait_queue_next(queue, wait);
+            struct futex_wait *fw = wait2futex(wait);
+            if (fw->mm == mm && fw->key == uaddr) {
+                wakeup_wait(queue, wait, WT_FUTEX, 1);
+                ret ++;
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+    return ret;
+}
+
+// do_futex - called by sys_futex
+int
+do_futex(uintptr_t uaddr, int op, int val) {
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL) {
+        panic("kernel thread call futex!!.\n");
+    }
+    if (uaddr % sizeof(int) != 0) {
+        return -E_INVAL;
+    }
+    switch (op) {
+    case FUTEX_WAIT:
+        return futex_wait(mm, uaddr, val);
+    case FUTEX_WAKE:
+        return futex_wake(mm, uaddr, val);
+    }
+    return -E_INVAL;
+}
+
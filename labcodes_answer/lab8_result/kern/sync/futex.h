@@ -0,0 +1,22 @@
+#ifndef __KERN_SYNC_FUTEX_H__
+#define __KERN_SYNC_FUTEX_H__
+
+#include <defs.h>
+
+/* *
+ * futex - sleep/wakeup on a user word, the slow path of user/libs/lock.h.
+ *
+ * A futex is identified by the mm and the user address of the word: only
+ * threads share memory, and a page swapped out and back in moves to
+ * another physical address. The waiters are hashed into FUTEX_HASH_SIZE
+ * wait queues.
+ * */
+
+#define FUTEX_HASH_SHIFT            6
+#define FUTEX_HASH_SIZE             (1 << FUTEX_HASH_SHIFT)
+
+void futex_init(void);
+int do_futex(uintptr_t uaddr, int op, int val);
+
+#endif /* !__KERN_SYNC_FUTEX_H__ */
+
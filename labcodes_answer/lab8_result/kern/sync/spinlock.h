@@ -0,0 +1,61 @@
+#ifndef __KERN_SYNC_SPINLOCK_H__
+#define __KERN_SYNC_SPINLOCK_H__
+
+#include <defs.h>
+#include <x86.h>
+#include <atomic.h>
+#include <sync.h>
+
+/* *
+ * spinlock - mutual exclusion between CPUs, for the kernel built with
+ * make SMP=1 (CONFIG_SMP). Interrupts stay disabled on the CPU holding a
+ * lock taken with spin_lock_irqsave, so an interrupt handler taking the same
+ * lock can not spin on it forever. On one CPU that is all there is to it:
+ * spin_lock and spin_unlock do nothing and spin_lock_irqsave is just
+ * local_intr_save.
+ * */
+
+typedef struct {
+    volatile int locked;
+} spinlock_t;
+
+static inline void
+spinlock_init(spinlock_t *lock) {
+    lock->locked = 0;
+}
+
+// spin_trylock - take lock if it is free, return true on success
+static inline bool
+spin_trylock(spinlock_t *lock) {
+#ifdef CONFIG_SMP
+    return xchg(&(lock->locked), 1) == 0;
+#else
+    return 1;
+#endif
+}
+
+static inline void
+spin_lock(spinlock_t *lock) {
+#ifdef CONFIG_SMP
+    while (xchg(&(lock->locked), 1) != 0) {
+        // wait with plain reads, the xchg takes the cache line away from the holder
+        while (lock->locked) {
+            pause();
+        }
+    }
+#endif
+}
+
+static inline void
+spin_unlock(spinlock_t *lock) {
+#ifdef CONFIG_SMP
+    // xchg is a barrier: the stores of the critical section are seen before the lock is free
+    xchg(&(lock->locked), 0);
+#endif
+}
+
+#define spin_lock_irqsave(lock, x)          do { local_intr_save(x); spin_lock(lock); } while (0)
+#define spin_unlock_irqrestore(lock, x)     do { spin_unlock(lock); local_intr_restore(x); } while (0)
+
+#endif /* !__KERN_SYNC_SPINLOCK_H__ */
+
@@ -0,0 +1,250 @@
+#include <defs.h>
+#include <string.h>
+#include <error.h>
+#include <sync.h>
+#include <kmalloc.h>
+#include <vmm.h>
+#include <proc.h>
+#include <systrace.h>
+#include <strace.h>
+
+/* *
+ * The system calls run under the big kernel lock with SMP, and the kernel
+ * is not preempted, so nothing else touches the counters or a ring while
+ * strace_record updates them. The readers copy what they need out with
+ * interrupts disabled before they go to user memory, which may sleep.
+ * */
+
+struct strace_count {
+    uint32_t calls;
+    uint64_t cycles;
+    uint32_t hist[SYSTRACE_BUCKETS];
+};
+
+struct strace_ring {
+    uint32_t head;                      // entries logged
+    uint32_t tail;                      // entries read, head - tail <= SYSTRACE_RING
+    struct systrace_entry entries[SYSTRACE_RING];
+};
+
+bool strace_on = 0;
+
+static struct strace_count counts[SYSTRACE_NSYSCALLS];
+
+// strace_bucket - the histogram bucket of a latency of cycles
+static int
+strace_bucket(uint64_t cycles) {
+    uint32_t c;
+    int i = 0;
+    if ((cycles >> 32) != 0) {
+        return SYSTRACE_BUCKETS - 1;
+    }
+    for (c = (uint32_t)cycles >> SYSTRACE_SHIFT; c != 0 && i < SYSTRACE_BUCKETS - 1; c >>= 1) {
+        i ++;
+    }
+    return i;
+}
+
+// strace_record - called by syscall() when the system call num of current returned ret after cycles
+void
+strace_record(int num, uint32_t arg[], int ret, uint64_t cycles) {
+    struct strace_ring *ring;
+    // the call slept and woke up on a cpu whose TSC is behind
+    if ((int64_t)cycles < 0) {
+        cycles = 0;
+    }
+    if (strace_on) {
+        struct strace_count *count = counts + num;
+        count->calls ++;
+        count->cycles += cycles;
+        count->hist[strace_bucket(cycles)] ++;
+        current->syscalls ++;
+    }
+    if ((ring = current->trace) != NULL) {
+        struct systrace_entry *entry = ring->entries + (ring->head % SYSTRACE_RING);
+        entry->seq = ring->head;
+        entry->num = num;
+        memcpy(entry->arg, arg, sizeof(entry->arg));
+        entry->ret = ret;
+        entry->cycles = ((cycles >> 32) != 0) ? 0xFFFFFFFF : (uint32_t)cycles;
+        // a full ring drops the oldest entry
+        if (++ ring->head - ring->tail > SYSTRACE_RING) {
+            ring->tail ++;
+        }
+    }
+}
+
+// strace_release - free the trace ring of proc, when it is reaped or stops being traced
+void
+strace_release(struct proc_struct *proc) {
+    if (proc->trace != NULL) {
+        kfree(proc->trace);
+        proc->trace = NULL;
+    }
+}
+
+// strace_proc - the process pid, current for 0; NULL if there is none, it is a zombie,
+//             - or current may not trace it: only itself, its threads and its descendants
+static struct proc_struct *
+strace_proc(int pid) {
+    struct proc_struct *proc = (pid == 0) ? current : find_proc(pid);
+    if (proc == NULL || proc->state == PROC_ZOMBIE || !proc_controlled(proc)) {
+        return NULL;
+    }
+    return proc;
+}
+
+// strace_stat - copy the counters of the smallest system call number >= num with calls, return the number
+static int
+strace_stat(int num, struct systrace_stat *stat) {
+    struct mm_struct *mm = current->mm;
+    struct systrace_stat __stat, *st = &__stat;
+    bool intr_flag;
+    int ret;
+
+    if (num < 0) {
+        num = 0;
+    }
+    local_intr_save(intr_flag);
+    {
+        while (num < SYSTRACE_NSYSCALLS && counts[num].calls == 0) {
+            num ++;
+        }
+        if (num < SYSTRACE_NSYSCALLS) {
+            st->num = num;
+            st->calls = counts[num].calls;
+            st->cycles = counts[num].cycles;
+            memcpy(st->hist, counts[num].hist, sizeof(st->hist));
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if (num == SYSTRACE_NSYSCALLS) {
+        return -E_NOENT;
+    }
+    ret = num;
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, stat, st, sizeof(struct systrace_stat))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+// strace_trace - start logging the calls of process pid
+static int
+strace_trace(int pid) {
+    struct strace_ring *ring;
+    struct proc_struct *proc;
+    bool intr_flag;
+    int ret = 0;
+
+    // kmalloc may sleep, look the process up after it
+    if ((ring = kmalloc(sizeof(struct strace_ring))) == NULL) {
+        return -E_NO_MEM;
+    }
+    ring->head = ring->tail = 0;
+    local_intr_save(intr_flag);
+    {
+        if ((proc = strace_proc(pid)) == NULL) {
+            ret = -E_BAD_PROC;
+        }
+        else if (proc->trace == NULL) {
+            proc->trace = ring;
+            ring = NULL;
+        }
+    }
+    local_intr_restore(intr_flag);
+    if (ring != NULL) {
+        kfree(ring);
+    }
+    return ret;
+}
+
+static int
+strace_untrace(int pid) {
+    struct proc_struct *proc;
+    if ((proc = strace_proc(pid)) == NULL) {
+        return -E_BAD_PROC;
+    }
+    strace_release(proc);
+    return 0;
+}
+
+// strace_read - take up to n entries from the ring of process pid, return how many
+static int
+strace_read(int pid, struct systrace_entry *entries, size_t n) {
+    struct mm_struct *mm = current->mm;
+    struct systrace_entry *buf;
+    struct strace_ring *ring;
+    struct proc_struct *proc;
+    bool intr_flag;
+    int ret = 0;
+
+    if (n == 0) {
+        return 0;
+    }
+    if (n > SYSTRACE_RING) {
+        n = SYSTRACE_RING;
+    }
+    if ((buf = kmalloc(n * sizeof(struct systrace_entry))) == NULL) {
+        return -E_NO_MEM;
+    }
+    local_intr_save(intr_flag);
+    {
+        // a zombie can still be read, its ring goes with it when it is reaped
+        proc = (pid == 0) ? current : find_proc(pid);
+        if (proc == NULL || !proc_controlled(proc) || (ring = proc->trace) == NULL) {
+            ret = -E_BAD_PROC;
+        }
+        else {
+            for (; ret < n && ring->tail != ring->head; ret ++, ring->tail ++) {
+                buf[ret] = ring->entries[ring->tail % SYSTRACE_RING];
+            }
+        }
+    }
+    local_intr_restore(intr_flag);
+
+    if (ret > 0) {
+        lock_mm(mm);
+        {
+            if (!copy_to_user(mm, entries, buf, ret * sizeof(struct systrace_entry))) {
+                ret = -E_INVAL;
+            }
+        }
+        unlock_mm(mm);
+    }
+    kfree(buf);
+    return ret;
+}
+
+// do_systrace - called by sys_systrace, op: SYSTRACE_*
+int
+do_systrace(int op, int arg, uintptr_t buf, size_t len) {
+    bool intr_flag;
+    switch (op) {
+    case SYSTRACE_OFF:
+        strace_on = 0;
+        return 0;
+    case SYSTRACE_ON:
+        local_intr_save(intr_flag);
+        {
+            memset(counts, 0, sizeof(counts));
+            strace_on = 1;
+        }
+        local_intr_restore(intr_flag);
+        return 0;
+    case SYSTRACE_STAT:
+        return strace_stat(arg, (struct systrace_stat *)buf);
+    case SYSTRACE_TRACE:
+        return strace_trace(arg);
+    case SYSTRACE_UNTRACE:
+        return strace_untrace(arg);
+    case SYSTRACE_READ:
+        return strace_read(arg, (struct systrace_entry *)buf, len);
+    }
+    return -E_INVAL;
+}
+
@@ -0,0 +1,21 @@
+#ifndef __KERN_SYSCALL_STRACE_H__
+#define __KERN_SYSCALL_STRACE_H__
+
+#include <defs.h>
+
+/* *
+ * strace - the counters, latency histograms and per-process trace rings of
+ * SYS_systrace (libs/systrace.h). syscall() only pays for a rdtsc pair and
+ * strace_record when counting is on or the process is traced.
+ * */
+
+struct proc_struct;
+
+extern bool strace_on;
+
+void strace_record(int num, uint32_t arg[], int ret, uint64_t cycles);
+void strace_release(struct proc_struct *proc);
+int do_systrace(int op, int arg, uintptr_t buf, size_t len);
+
+#endif /* !__KERN_SYSCALL_STRACE_H__ */
+
@@ -10,9 +10,26 @@
 #include <stat.h>
 #include <dirent.h>
 #include <sysfile.h>
+#include <vmm.h>
+#include <error.h>
+#include <zram.h>
+#include <textcache.h>
+#include <procinfo.h>
+#include <futex.h>
+#include <time.h>
+#include <sysuring.h>
+#include <systrace.h>
+#include <strace.h>
+#include <sig.h>
 
 static int
 sys_exit(uint32_t arg[]) {
+    int error_code = (int)arg[0];
+    return do_exit_group(error_code);
+}
+
+static int
+sys_exit_thread(uint32_t arg[]) {
     int error_code = (int)arg[0];
     return do_exit(error_code);
 }
@@ -24,6 +41,24 @@ sys_fork(uint32_t arg[]) {
     return do_fork(0, stack, tf);
 }
 
+static int
+sys_clone(uint32_t arg[]) {
+    struct trapframe *tf = current->tf;
+    uint32_t clone_flags = (uint32_t)arg[0];
+    uintptr_t stack = (uintptr_t)arg[1];
+    if (stack == 0) {
+        stack = tf->tf_esp;
+    }
+    return do_fork(clone_flags, stack, tf);
+}
+
+static int
+sys_vfork(uint32_t arg[]) {
+    struct trapframe *tf = current->tf;
+    uintptr_t stack = tf->tf_esp;
+    return do_fork(CLONE_VM | CLONE_VFORK, stack, tf);
+}
+
 static int
 sys_wait(uint32_t arg[]) {
     int pid = (int)arg[0];
@@ -39,6 +74,16 @@ sys_exec(uint32_t arg[]) {
     return do_execve(name, argc, argv);
 }
 
+static int
+sys_spawn(uint32_t arg[]) {
+    const char *name = (const char *)arg[0];
+    int argc = (int)arg[1];
+    const char **argv = (const char **)arg[2];
+    const struct spawn_action *actions = (const struct spawn_action *)arg[3];
+    int nactions = (int)arg[4];
+    return do_spawn(name, argc, argv, actions, nactions);
+}
+
 static int
 sys_yield(uint32_t arg[]) {
     return do_yield();
@@ -47,7 +92,29 @@ sys_yield(uint32_t arg[]) {
 static int
 sys_kill(uint32_t arg[]) {
     int pid = (int)arg[0];
-    return do_kill(pid);
+    int signum = (int)arg[1];
+    return do_sigsend(pid, signum);
+}
+
+static int
+sys_sigaction(uint32_t arg[]) {
+    int signum = (int)arg[0];
+    const struct sigaction *act = (const struct sigaction *)arg[1];
+    struct sigaction *oldact = (struct sigaction *)arg[2];
+    return do_sigaction(signum, act, oldact);
+}
+
+static int
+sys_sigprocmask(uint32_t arg[]) {
+    int how = (int)arg[0];
+    const sigset_t *set = (const sigset_t *)arg[1];
+    sigset_t *oldset = (sigset_t *)arg[2];
+    return do_sigprocmask(how, set, oldset);
+}
+
+static int
+sys_sigreturn(uint32_t arg[]) {
+    return do_sigreturn();
 }
 
 static int
@@ -55,6 +122,37 @@ sys_getpid(uint32_t arg[]) {
     return current->pid;
 }
 
+static int
+sys_mmap(uint32_t arg[]) {
+    uintptr_t *addr_store = (uintptr_t *)arg[0];
+    size_t len = (size_t)arg[1];
+    uint32_t mmap_flags = (uint32_t)arg[2];
+    return do_mmap(addr_store, len, mmap_flags);
+}
+
+static int
+sys_munmap(uint32_t arg[]) {
+    uintptr_t addr = (uintptr_t)arg[0];
+    size_t len = (size_t)arg[1];
+    return do_munmap(addr, len);
+}
+
+static int
+sys_futex(uint32_t arg[]) {
+    uintptr_t uaddr = (uintptr_t)arg[0];
+    int op = (int)arg[1];
+    int val = (int)arg[2];
+    return do_futex(uaddr, op, val);
+}
+
+static int
+sys_sched_setscheduler(uint32_t arg[]) {
+    int pid = (int)arg[0];
+    int policy = (int)arg[1];
+    struct sched_param *param = (struct sched_param *)arg[2];
+    return do_sched_setscheduler(pid, policy, param);
+}
+
 static int
 sys_putc(uint32_t arg[]) {
     int c = (int)arg[0];
@@ -68,10 +166,80 @@ sys_pgdir(uint32_t arg[]) {
     return 0;
 }
 
+static int
+sys_procinfo(uint32_t arg[]) {
+    int pid = (int)arg[0];
+    struct procinfo *info = (struct procinfo *)arg[1];
+    return do_procinfo(pid, info);
+}
+
+static int
+sys_meminfo(uint32_t arg[]) {
+    struct meminfo *info = (struct meminfo *)arg[0];
+    struct meminfo mi;
+    struct zram_stat zstat;
+    zram_get_stat(&zstat);
+    mi.total_pages = npage;
+    mi.free_pages = nr_free_pages();
+    mi.zram_pool_pages = zstat.pool_pages;
+    mi.zram_stored_pages = zstat.stored_pages;
+    mi.zram_compr_bytes = zstat.compr_bytes;
+    mi.zram_hits = zstat.hits;
+    mi.zram_misses = zstat.misses;
+    mi.zram_writebacks = zstat.writebacks;
+    mi.zram_rejects = zstat.rejects;
+    struct textcache_stat tstat;
+    textcache_get_stat(&tstat);
+    mi.text_cached_pages = tstat.cached_pages;
+    mi.text_hits = tstat.hits;
+    mi.text_misses = tstat.misses;
+
+    struct mm_struct *mm = current->mm;
+    int ret = 0;
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, info, &mi, sizeof(struct meminfo))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
+static int
+sys_systrace(uint32_t arg[]) {
+    int op = (int)arg[0];
+    int pid_or_num = (int)arg[1];
+    uintptr_t buf = (uintptr_t)arg[2];
+    size_t len = (size_t)arg[3];
+    return do_systrace(op, pid_or_num, buf, len);
+}
+
 static uint32_t
 sys_gettime(uint32_t arg[]) {
     return (int)ticks;
 }
+static int
+sys_clock_gettime(uint32_t arg[]) {
+    int clockid = (int)arg[0];
+    struct timespec *tp = (struct timespec *)arg[1];
+    struct timespec ts;
+    int ret;
+    if ((ret = do_clock_gettime(clockid, &ts)) != 0) {
+        return ret;
+    }
+
+    struct mm_struct *mm = current->mm;
+    lock_mm(mm);
+    {
+        if (!copy_to_user(mm, tp, &ts, sizeof(struct timespec))) {
+            ret = -E_INVAL;
+        }
+    }
+    unlock_mm(mm);
+    return ret;
+}
+
 static uint32_t
 sys_lab6_set_priority(uint32_t arg[])
 {
@@ -83,7 +251,31 @@ sys_lab6_set_priority(uint32_t arg[])
 static int
 sys_sleep(uint32_t arg[]) {
     unsigned int time = (unsigned int)arg[0];
-    return do_sleep(time);
+    // the timer wheel takes no more than MAX_TIMER_OFFSET units
+    if (time > MAX_TIMER_OFFSET / TICK_UNITS) {
+        time = MAX_TIMER_OFFSET / TICK_UNITS;
+    }
+    return do_sleep(time * TICK_UNITS);
+}
+
+static int
+sys_usleep(uint32_t arg[]) {
+    unsigned int usec = (unsigned int)arg[0], unit = 1000000 / TIMER_HZ;
+    // at most 2^32 / unit units, below MAX_TIMER_OFFSET
+    static_assert((unsigned int)-1 / (1000000 / TIMER_HZ) + 1 <= MAX_TIMER_OFFSET);
+    return do_sleep(usec / unit + (usec % unit != 0));
+}
+
+static int
+sys_memlimit(uint32_t arg[]) {
+    size_t limit = (size_t)arg[0];
+    struct mm_struct *mm = current->mm;
+    if (mm == NULL) {
+        return -E_INVAL;
+    }
+    size_t old_limit = mm->mem_limit;
+    mm->mem_limit = limit;
+    return old_limit;
 }
 
 static int
@@ -150,6 +342,20 @@ sys_getdirentry(uint32_t arg[]) {
     return sysfile_getdirentry(fd, direntp);
 }
 
+static int
+sys_uring_setup(uint32_t arg[]) {
+    uintptr_t ring = (uintptr_t)arg[0];
+    uint32_t flags = (uint32_t)arg[1];
+    return do_uring_setup(ring, flags);
+}
+
+static int
+sys_uring_enter(uint32_t arg[]) {
+    uint32_t to_submit = (uint32_t)arg[0];
+    uint32_t min_complete = (uint32_t)arg[1];
+    return do_uring_enter(to_submit, min_complete);
+}
+
 static int
 sys_dup(uint32_t arg[]) {
     int fd1 = (int)arg[0];
@@ -162,14 +368,31 @@ static int (*syscalls[])(uint32_t arg[]) = {
     [SYS_fork]              sys_fork,
     [SYS_wait]              sys_wait,
     [SYS_exec]              sys_exec,
+    [SYS_clone]             sys_clone,
+    [SYS_vfork]             sys_vfork,
+    [SYS_spawn]             sys_spawn,
+    [SYS_exit_thread]       sys_exit_thread,
     [SYS_yield]             sys_yield,
     [SYS_kill]              sys_kill,
+    [SYS_sigaction]         sys_sigaction,
+    [SYS_sigprocmask]       sys_sigprocmask,
+    [SYS_sigreturn]         sys_sigreturn,
     [SYS_getpid]            sys_getpid,
+    [SYS_mmap]              sys_mmap,
+    [SYS_munmap]            sys_munmap,
+    [SYS_futex]             sys_futex,
+    [SYS_sched_setscheduler] sys_sched_setscheduler,
     [SYS_putc]              sys_putc,
     [SYS_pgdir]             sys_pgdir,
+    [SYS_procinfo]          sys_procinfo,
+    [SYS_meminfo]           sys_meminfo,
+    [SYS_systrace]          sys_systrace,
     [SYS_gettime]           sys_gettime,
     [SYS_lab6_set_priority] sys_lab6_set_priority,
     [SYS_sleep]             sys_sleep,
+    [SYS_usleep]            sys_usleep,
+    [SYS_clock_gettime]     sys_clock_gettime,
+    [SYS_memlimit]          sys_memlimit,
     [SYS_open]              sys_open,
     [SYS_close]             sys_close,
     [SYS_read]              sys_read,
@@ -180,6 +403,8 @@ static int (*syscalls[])(uint32_t arg[]) = {
     [SYS_getcwd]            sys_getcwd,
     [SYS_getdirentry]       sys_getdirentry,
     [SYS_dup]               sys_dup,
+    [SYS_uring_setup]       sys_uring_setup,
+    [SYS_uring_enter]       sys_uring_enter,
 };
 
 #define NUM_SYSCALLS        ((sizeof(syscalls)) / (sizeof(syscalls[0])))
@@ -189,6 +414,7 @@ syscall(void) {
     struct trapframe *tf = current->tf;
     uint32_t arg[5];
     int num = tf->tf_regs.reg_eax;
+    static_assert(NUM_SYSCALLS <= SYSTRACE_NSYSCALLS);
     if (num >= 0 && num < NUM_SYSCALLS) {
         if (syscalls[num] != NULL) {
             arg[0] = tf->tf_regs.reg_edx;
@@ -196,6 +422,13 @@ syscall(void) {
             arg[2] = tf->tf_regs.reg_ebx;
             arg[3] = tf->tf_regs.reg_edi;
             arg[4] = tf->tf_regs.reg_esi;
+            if (strace_on || current->trace != NULL) {
+                uint64_t start = rdtsc();
+                int ret = syscalls[num](arg);
+                strace_record(num, arg, ret, rdtsc() - start);
+                tf->tf_regs.reg_eax = ret;
+                return ;
+            }
             tf->tf_regs.reg_eax = syscalls[num](arg);
             return ;
         }
@@ -5,6 +5,7 @@
 #include <trap.h>
 #include <x86.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <console.h>
 #include <vmm.h>
@@ -16,9 +17,18 @@
 #include <sched.h>
 #include <sync.h>
 #include <proc.h>
+#include <fpu.h>
+#include <lapic.h>
+#include <smp.h>
+#include <sig.h>
 
 #define TICK_NUM 100
 
+#define MSR_SYSENTER_CS     0x174               // the kernel code segment, its stack segment follows
+#define MSR_SYSENTER_ESP    0x175
+#define MSR_SYSENTER_EIP    0x176
+#define CPUID_SEP           (1 << 11)           // cpuid(1).edx: SYSENTER/SYSEXIT
+
 static void print_ticks() {
     cprintf("%d ticks\n",TICK_NUM);
 #ifdef DEBUG_GRADE
@@ -66,6 +76,57 @@ idt_init(void) {
     lidt(&idt_pd);
 }
 
+/* idt_load - an AP uses the IDT built by the boot cpu */
+void
+idt_load(void) {
+    lidt(&idt_pd);
+}
+
+static bool sysenter_ok = 0;
+
+// where SYSEXIT returns to, in the stub in the time page; 0 until it is installed
+uintptr_t sysenter_return = 0;
+
+extern uint8_t __sysenter_entry[];
+extern uint8_t __sysenter_stub[], __sysenter_stub_return[], __sysenter_stub_end[];
+
+/* *
+ * sysenter_init - set up the SYSENTER entry of the system calls on this cpu.
+ * The stack msr points at the ts_esp0 of tss, the TSS of the cpu, and the
+ * entry loads the kernel stack from there: a context switch need not write
+ * the msr. SYSEXIT takes the user segments from the GDT entries after the
+ * kernel ones, which is where they are.
+ * */
+void
+sysenter_init(struct taskstate *tss) {
+    uint32_t eax, edx;
+    cpuid(1, &eax, NULL, NULL, &edx);
+    // the Pentium Pro reports SEP, but has no SYSENTER
+    if (!(edx & CPUID_SEP) || (((eax >> 8) & 0xF) == 6 && ((eax >> 4) & 0xF) < 3 && (eax & 0xF) < 3)) {
+        return ;
+    }
+    static_assert(GD_KDATA == GD_KTEXT + 8 && GD_UTEXT == GD_KTEXT + 16 && GD_UDATA == GD_KTEXT + 24);
+    wrmsr(MSR_SYSENTER_CS, GD_KTEXT);
+    // the TSS is packed, take the address of ts_esp0 by its offset
+    wrmsr(MSR_SYSENTER_ESP, (uintptr_t)tss + offsetof(struct taskstate, ts_esp0));
+    wrmsr(MSR_SYSENTER_EIP, (uintptr_t)__sysenter_entry);
+    sysenter_ok = 1;
+}
+
+/* *
+ * sysenter_install - copy the user stub of SYSENTER to kva, which user
+ * processes see at va; return the address they call, or 0 without SYSENTER.
+ * */
+uintptr_t
+sysenter_install(void *kva, uintptr_t va) {
+    if (!sysenter_ok) {
+        return 0;
+    }
+    memcpy(kva, __sysenter_stub, __sysenter_stub_end - __sysenter_stub);
+    sysenter_return = va + (__sysenter_stub_return - __sysenter_stub);
+    return va;
+}
+
 static const char *
 trapname(int trapno) {
     static const char * const excnames[] = {
@@ -199,6 +260,17 @@ trap_dispatch(struct trapframe *tf) {
     switch (tf->tf_trapno) {
     case T_PGFLT:  //page fault
         if ((ret = pgfault_handler(tf)) != 0) {
+            if (current != NULL && current->mm != NULL && trap_in_kernel(tf) && rcr2() < USERTOP) {
+                // a system call touched user memory the process may not have more of:
+                // copy_from_user and copy_to_user fail, anything else kills the process
+                if (tf->tf_eip == (uintptr_t)__copy_user_fault) {
+                    tf->tf_eip = (uintptr_t)__copy_user_fixup;
+                    break;
+                }
+                print_trapframe(tf);
+                cprintf("killed by kernel.\n");
+                do_exit(-E_KILLED);
+            }
             print_trapframe(tf);
             if (current == NULL) {
                 panic("handle pgfault failed. ret=%d\n", ret);
@@ -208,7 +280,6 @@ trap_dispatch(struct trapframe *tf) {
                     panic("handle pgfault failed in kernel mode. ret=%d\n", ret);
                 }
                 cprintf("killed by kernel.\n");
-                panic("handle user mode pgfault failed. ret=%d\n", ret); 
                 do_exit(-E_KILLED);
             }
         }
@@ -216,6 +287,16 @@ trap_dispatch(struct trapframe *tf) {
     case T_SYSCALL:
         syscall();
         break;
+    case T_DEVICE:  //the first FPU instruction since the process was switched in
+        if (trap_in_kernel(tf)) {
+            print_trapframe(tf);
+            panic("fpu used in kernel mode.\n");
+        }
+        if ((ret = fpu_trap()) != 0) {
+            cprintf("fpu not available, killed by kernel.\n");
+            do_exit(-E_KILLED);
+        }
+        break;
     case IRQ_OFFSET + IRQ_TIMER:
 #if 0
     LAB3 : If some page replacement algorithm(such as CLOCK PRA) need tick to change the priority of pages, 
@@ -239,7 +320,7 @@ trap_dispatch(struct trapframe *tf) {
          *    Every tick, you should update the system time, iterate the timers, and trigger the timers which are end to call scheduler.
          *    You can use one funcitons to finish all these things.
          */
-        ticks ++;
+        // the timers expire on the boot cpu, every cpu charges its ticks to its current process
         assert(current != NULL);
         run_timer_list();
         break;
@@ -264,6 +345,19 @@ trap_dispatch(struct trapframe *tf) {
     case IRQ_OFFSET + IRQ_IDE2:
         /* do nothing */
         break;
+#ifdef CONFIG_SMP
+    case IRQ_OFFSET + IRQ_IPI_TIMER:
+        // another cpu added a timer before the event the timer of this cpu is armed for
+        clock_program(current != idleproc);
+        break;
+    case IRQ_OFFSET + IRQ_IPI_RESCHED:
+        // the sender set need_resched, the interrupt only brings this cpu into the kernel
+    case IRQ_OFFSET + IRQ_IPI_TLB:
+        // the TLB was flushed while waiting for the big kernel lock
+#endif
+    case IRQ_OFFSET + IRQ_ERROR:
+    case IRQ_OFFSET + IRQ_SPURIOUS:
+        break;
     default:
         print_trapframe(tf);
         if (current != NULL) {
@@ -283,6 +377,19 @@ trap_dispatch(struct trapframe *tf) {
  * */
 void
 trap(struct trapframe *tf) {
+#ifdef CONFIG_SMP
+    // from user mode or the idle loop this cpu does not hold the big kernel lock yet
+    bool locked = 0;
+    if (!mycpu()->kernel_locked) {
+        kernel_lock();
+        locked = 1;
+    }
+#endif
+    // the local APIC takes no other interrupt of this priority before the EOI,
+    // and the handler may switch to another process
+    if (lapic != NULL && tf->tf_trapno >= IRQ_OFFSET && tf->tf_trapno < IRQ_OFFSET + IRQ_SPURIOUS) {
+        lapic_eoi();
+    }
     // dispatch based on what type of trap occurred
     // used for previous projects
     if (current == NULL) {
@@ -305,7 +412,17 @@ trap(struct trapframe *tf) {
             if (current->need_resched) {
                 schedule();
             }
+            if (signal_pending(current)) {
+                signal_deliver(tf);
+            }
         }
     }
+#ifdef CONFIG_SMP
+    // and back to user mode or to the idle loop, which may be on another cpu by now;
+    // kernel_execve goes back to user mode from a trap taken in kernel mode
+    if (locked || !trap_in_kernel(tf)) {
+        kernel_unlock();
+    }
+#endif
 }
 
@@ -36,6 +36,9 @@
 #define IRQ_IDE1                14
 #define IRQ_IDE2                15
 #define IRQ_ERROR               19
+#define IRQ_IPI_RESCHED         20  // from another cpu: something to run here, see smp_resched
+#define IRQ_IPI_TLB             21  // from another cpu: flush the TLB, see tlb_shootdown
+#define IRQ_IPI_TIMER           22  // from another cpu: a timer was added, see clock_timer_added
 #define IRQ_SPURIOUS            31
 
 /* *
@@ -80,7 +83,12 @@ struct trapframe {
     uint16_t tf_padding5;
 } __attribute__((packed));
 
+struct taskstate;
+
 void idt_init(void);
+void idt_load(void);
+void sysenter_init(struct taskstate *tss);
+uintptr_t sysenter_install(void *kva, uintptr_t va);
 void print_trapframe(struct trapframe *tf);
 void print_regs(struct pushregs *regs);
 bool trap_in_kernel(struct trapframe *tf);
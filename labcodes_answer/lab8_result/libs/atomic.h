@@ -9,6 +9,8 @@ static inline void change_bit(int nr, volatile void *addr) __attribute__((always
 static inline bool test_and_set_bit(int nr, volatile void *addr) __attribute__((always_inline));
 static inline bool test_and_clear_bit(int nr, volatile void *addr) __attribute__((always_inline));
 static inline bool test_bit(int nr, volatile void *addr) __attribute__((always_inline));
+static inline int xchg(volatile int *ptr, int val) __attribute__((always_inline));
+static inline int cmpxchg(volatile int *ptr, int old, int new) __attribute__((always_inline));
 
 /* *
  * set_bit - Atomically set a bit in memory
@@ -78,5 +80,30 @@ test_and_clear_bit(int nr, volatile void *addr) {
     asm volatile ("btrl %2, %1; sbbl %0, %0" : "=r" (oldbit), "=m" (*(volatile long *)addr) : "Ir" (nr) : "memory");
     return oldbit != 0;
 }
+
+/* *
+ * xchg - Atomically store a value and return the old one
+ * @ptr:    the word to update
+ * @val:    the new value
+ * */
+static inline int
+xchg(volatile int *ptr, int val) {
+    asm volatile ("xchgl %0, %1" : "+r" (val), "+m" (*ptr) :: "memory");
+    return val;
+}
+
+/* *
+ * cmpxchg - Atomically store @new if the word holds @old, return the value found
+ * @ptr:    the word to update
+ * @old:    the value expected
+ * @new:    the value to store
+ * */
+static inline int
+cmpxchg(volatile int *ptr, int old, int new) {
+    int prev;
+    asm volatile ("lock; cmpxchgl %2, %1" : "=a" (prev), "+m" (*ptr) : "r" (new), "0" (old) : "memory");
+    return prev;
+}
+
 #endif /* !__LIBS_ATOMIC_H__ */
 
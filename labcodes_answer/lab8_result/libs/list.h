@@ -26,6 +26,7 @@ static inline void list_add_before(list_entry_t *listelm, list_entry_t *elm) __a
 static inline void list_add_after(list_entry_t *listelm, list_entry_t *elm) __attribute__((always_inline));
 static inline void list_del(list_entry_t *listelm) __attribute__((always_inline));
 static inline void list_del_init(list_entry_t *listelm) __attribute__((always_inline));
+static inline void list_splice_before(list_entry_t *listelm, list_entry_t *list) __attribute__((always_inline));
 static inline bool list_empty(list_entry_t *list) __attribute__((always_inline));
 static inline list_entry_t *list_next(list_entry_t *listelm) __attribute__((always_inline));
 static inline list_entry_t *list_prev(list_entry_t *listelm) __attribute__((always_inline));
@@ -105,6 +106,26 @@ list_del_init(list_entry_t *listelm) {
     list_init(listelm);
 }
 
+/* *
+ * list_splice_before - move all entries of a list before a given entry
+ * @listelm:    list head of the list that receives the entries
+ * @list:       list head of the entries to move, left empty
+ *
+ * The entries keep their order and end up just before @listelm,
+ * i.e. at the tail when @listelm is a list head.
+ * */
+static inline void
+list_splice_before(list_entry_t *listelm, list_entry_t *list) {
+    if (!list_empty(list)) {
+        list_entry_t *first = list->next, *last = list->prev;
+        first->prev = listelm->prev;
+        listelm->prev->next = first;
+        last->next = listelm;
+        listelm->prev = last;
+        list_init(list);
+    }
+}
+
 /* *
  * list_empty - tests whether a list is empty
  * @list:       the list to test.
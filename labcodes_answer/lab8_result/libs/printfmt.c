@@ -38,6 +38,8 @@ static const char * const error_string[MAXERROR + 1] = {
     [E_MAX_OPEN]            "too many files are open",
     [E_EXISTS]              "file or directory already exists",
     [E_NOTEMPTY]            "directory is not empty",
+    [E_AGAIN]               "try again",
+    [E_INTR]                "interrupted by a signal",
 };
 
 /* *
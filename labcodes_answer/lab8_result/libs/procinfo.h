@@ -0,0 +1,47 @@
+#ifndef __LIBS_PROCINFO_H__
+#define __LIBS_PROCINFO_H__
+
+#include <defs.h>
+
+#define PROCINFO_NAME_LEN       31
+
+// values of procinfo.state, same as enum proc_state in the kernel
+#define PROC_STATE_UNINIT       0
+#define PROC_STATE_SLEEPING     1
+#define PROC_STATE_RUNNABLE     2
+#define PROC_STATE_ZOMBIE       3
+
+struct procinfo {
+    int pid;                            // process id
+    int ppid;                           // parent process id
+    int state;                          // one of PROC_STATE_*
+    uint32_t wait_state;                // why the process is sleeping
+    int runs;                           // times the process was scheduled
+    size_t syscalls;                    // system calls made while SYSTRACE_ON counts them
+    size_t rss;                         // resident pages
+    size_t swap;                        // swapped out pages
+    size_t minflt;                      // page faults served without I/O
+    size_t majflt;                      // page faults that swapped a page in
+    size_t copies;                      // pages copied in by fork
+    size_t ptpages;                     // page tables of the user address space
+    size_t mem_limit;                   // max resident pages, 0 means no limit
+    char name[PROCINFO_NAME_LEN + 1];   // process name
+};
+
+struct meminfo {
+    size_t total_pages;                 // pages managed by the page allocator
+    size_t free_pages;                  // free pages
+    size_t zram_pool_pages;             // pages reserved for the compressed swap pool
+    size_t zram_stored_pages;           // pages held compressed in the pool
+    size_t zram_compr_bytes;            // compressed size of those pages
+    size_t zram_hits;                   // swap-ins served by the pool
+    size_t zram_misses;                 // swap-ins served by the swap disk
+    size_t zram_writebacks;             // cold pages moved from the pool to disk
+    size_t zram_rejects;                // pages that did not compress
+    size_t text_cached_pages;           // read-only text pages held by the text cache
+    size_t text_hits;                   // text pages exec mapped from the cache
+    size_t text_misses;                 // text pages exec read into the cache
+};
+
+#endif /* !__LIBS_PROCINFO_H__ */
+
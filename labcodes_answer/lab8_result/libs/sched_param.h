@@ -0,0 +1,21 @@
+#ifndef __LIBS_SCHED_PARAM_H__
+#define __LIBS_SCHED_PARAM_H__
+
+#include <defs.h>
+
+/* scheduling policies, for sched_setscheduler */
+#define SCHED_NORMAL            0       // the fair class, chosen when the kernel is built
+#define SCHED_FIFO              1       // fixed priority, runs until it sleeps or yields
+#define SCHED_RR                2       // fixed priority, round robin among equal priorities
+#define SCHED_DEADLINE          6       // earliest deadline first, with a cpu reservation
+
+#define SCHED_PRIO_MAX          32      // FIFO and RR priorities are 1 .. SCHED_PRIO_MAX - 1, higher runs first
+
+struct sched_param {
+    int sched_priority;                 // SCHED_FIFO, SCHED_RR: the priority
+    uint32_t sched_runtime;             // SCHED_DEADLINE: ticks of cpu time in each period
+    uint32_t sched_period;              // SCHED_DEADLINE: ticks of the period, also the relative deadline
+};
+
+#endif /* !__LIBS_SCHED_PARAM_H__ */
+
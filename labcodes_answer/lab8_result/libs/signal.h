@@ -0,0 +1,97 @@
+#ifndef __LIBS_SIGNAL_H__
+#define __LIBS_SIGNAL_H__
+
+#include <defs.h>
+
+/* *
+ * Signals, for SYS_kill, SYS_sigaction, SYS_sigprocmask and SYS_sigreturn.
+ * A signal sent to a process stays pending while it is blocked, and is
+ * taken when the process goes back to user mode: the default action ends
+ * the process (SIGCHLD is ignored), a handler is called on the user stack
+ * and returns through a trampoline in the time page, which calls sigreturn.
+ * A system call sleeping in a WT_INTERRUPTED state returns -E_INTR for a
+ * signal that is not blocked, before the handler runs. SIGKILL can not be
+ * caught or blocked. There is no job control, so no SIGSTOP or SIGCONT.
+ * */
+
+#define SIGHUP                  1
+#define SIGINT                  2
+#define SIGQUIT                 3
+#define SIGILL                  4
+#define SIGTRAP                 5
+#define SIGABRT                 6
+#define SIGBUS                  7
+#define SIGFPE                  8
+#define SIGKILL                 9
+#define SIGUSR1                 10
+#define SIGSEGV                 11
+#define SIGUSR2                 12
+#define SIGPIPE                 13
+#define SIGALRM                 14
+#define SIGTERM                 15
+#define SIGCHLD                 17      // a child exited, ignored by default
+#define NSIG                    32      // the signals are 1 .. NSIG - 1
+
+typedef uint32_t sigset_t;
+
+#define sigmask(sig)            (1U << ((sig) - 1))
+
+typedef void (*sighandler_t)(int);
+
+#define SIG_DFL                 ((sighandler_t)0)
+#define SIG_IGN                 ((sighandler_t)1)
+#define SIG_ERR                 ((sighandler_t)-1)
+
+/* sigaction flags */
+#define SA_NODEFER              0x40000000      // the signal is not blocked while its handler runs
+#define SA_RESETHAND            0x80000000      // the action goes back to SIG_DFL when the handler is called
+
+struct sigaction {
+    sighandler_t sa_handler;            // SIG_DFL, SIG_IGN or the handler
+    sigset_t sa_mask;                   // blocked while the handler runs, with the signal itself
+    uint32_t sa_flags;                  // SA_*
+};
+
+/* sigprocmask how */
+#define SIG_BLOCK               0
+#define SIG_UNBLOCK             1
+#define SIG_SETMASK             2
+
+/* user/libs/signal.c */
+sighandler_t signal(int signum, sighandler_t handler);
+int sigaction(int signum, const struct sigaction *act, struct sigaction *oldact);
+int sigprocmask(int how, const sigset_t *set, sigset_t *oldset);
+int sigsend(int pid, int signum);
+int raise(int signum);
+
+static inline int
+sigemptyset(sigset_t *set) {
+    *set = 0;
+    return 0;
+}
+
+static inline int
+sigfillset(sigset_t *set) {
+    *set = ~(sigset_t)0;
+    return 0;
+}
+
+static inline int
+sigaddset(sigset_t *set, int signum) {
+    *set |= sigmask(signum);
+    return 0;
+}
+
+static inline int
+sigdelset(sigset_t *set, int signum) {
+    *set &= ~sigmask(signum);
+    return 0;
+}
+
+static inline int
+sigismember(const sigset_t *set, int signum) {
+    return (*set & sigmask(signum)) != 0;
+}
+
+#endif /* !__LIBS_SIGNAL_H__ */
+
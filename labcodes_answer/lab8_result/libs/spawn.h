@@ -0,0 +1,23 @@
+#ifndef __LIBS_SPAWN_H__
+#define __LIBS_SPAWN_H__
+
+#include <defs.h>
+
+/* file actions applied by SYS_spawn in the child, in order, before the exec */
+
+#define SPAWN_MAX_ACTIONS           8
+
+#define SPAWN_OPEN                  1           // open path with open_flags as fd
+#define SPAWN_DUP2                  2           // duplicate fd as newfd
+#define SPAWN_CLOSE                 3           // close fd
+
+struct spawn_action {
+    int op;
+    int fd;
+    int newfd;
+    uint32_t open_flags;
+    const char *path;
+};
+
+#endif /* !__LIBS_SPAWN_H__ */
+
@@ -0,0 +1,50 @@
+#ifndef __LIBS_SYSTRACE_H__
+#define __LIBS_SYSTRACE_H__
+
+#include <defs.h>
+
+/* *
+ * System call tracing, for SYS_systrace. Nothing is counted until
+ * SYSTRACE_ON: then every system call bumps the calls and the latency
+ * histogram of its number, and the syscalls count of the process. A process
+ * traced with SYSTRACE_TRACE also logs each call, with its arguments, result
+ * and latency, to a ring of its own that SYSTRACE_READ drains. The latencies
+ * are in TSC cycles, from the dispatch to the return of the handler.
+ * */
+
+#define SYSTRACE_NSYSCALLS      256     // the system call numbers are below this
+#define SYSTRACE_RING           64      // entries in the trace ring of a process
+
+/* *
+ * The histogram buckets are powers of two: bucket 0 holds the calls under
+ * 2^SYSTRACE_SHIFT cycles, bucket i the calls in [2^(SYSTRACE_SHIFT+i-1),
+ * 2^(SYSTRACE_SHIFT+i)), and the last bucket everything above.
+ * */
+#define SYSTRACE_BUCKETS        16
+#define SYSTRACE_SHIFT          7
+
+/* SYS_systrace operations */
+#define SYSTRACE_OFF            0       // stop counting
+#define SYSTRACE_ON             1       // clear the counters and start counting
+#define SYSTRACE_STAT           2       // the struct systrace_stat of the smallest number >= arg with calls
+#define SYSTRACE_TRACE          3       // log the calls of process arg (0: current), the log survives exec
+#define SYSTRACE_UNTRACE        4       // stop logging, the entries not read yet are lost
+#define SYSTRACE_READ           5       // take up to len struct systrace_entry from the ring of process arg
+
+struct systrace_stat {
+    int num;                            // the system call number
+    uint32_t calls;
+    uint64_t cycles;                    // the sum of the latencies
+    uint32_t hist[SYSTRACE_BUCKETS];    // calls per latency bucket
+};
+
+struct systrace_entry {
+    uint32_t seq;                       // calls logged before this one, a gap means the ring overflowed
+    int num;
+    uint32_t arg[5];
+    int ret;
+    uint32_t cycles;                    // the latency, saturated at 0xFFFFFFFF
+};
+
+#endif /* !__LIBS_SYSTRACE_H__ */
+
@@ -0,0 +1,61 @@
+#ifndef __LIBS_TIME_H__
+#define __LIBS_TIME_H__
+
+#include <defs.h>
+#include <x86.h>
+#include <error.h>
+
+/* clocks, for clock_gettime */
+#define CLOCK_REALTIME          0       // the time since the epoch, from the RTC at boot
+#define CLOCK_MONOTONIC         1       // the time since boot, it never goes back
+
+#define NSEC_PER_SEC            1000000000
+
+struct timespec {
+    uint32_t tv_sec;                    // seconds
+    uint32_t tv_nsec;                   // and nanoseconds, below NSEC_PER_SEC
+};
+
+/* *
+ * The time page: the kernel maps this page read-only at TIMEPAGE_VA in every
+ * process, so clock_gettime reads the TSC and scales it in user mode, without
+ * a system call. The kernel fills it in once at boot; mult is 0 when there is
+ * no calibrated TSC, and clock_gettime has to ask the kernel then. The page
+ * also holds the stub the user library calls for a SYSENTER system call.
+ * */
+#define TIMEPAGE_VA             0x007FF000      // below UTEXT, see memlayout.h
+
+struct timepage {
+    uint64_t tsc_base;                  // the TSC at boot, CLOCK_MONOTONIC 0
+    uint32_t mult;                      // nanoseconds = (tsc - tsc_base) * mult >> shift
+    uint32_t shift;                     // at most 32
+    uint32_t realtime_sec;              // CLOCK_REALTIME at tsc_base, seconds since the epoch
+    uintptr_t sysenter;                 // the SYSENTER stub, 0 when the cpu has no SYSENTER
+};
+
+// timepage_nsec - the nanoseconds from tsc_base to tsc, a 96 bit product done in two halves
+static inline uint64_t
+timepage_nsec(const struct timepage *tp, uint64_t tsc) {
+    uint64_t delta = tsc - tp->tsc_base;
+    uint64_t lo = (uint64_t)(uint32_t)delta * tp->mult;
+    uint64_t hi = (uint64_t)(uint32_t)(delta >> 32) * tp->mult;
+    return (hi << (32 - tp->shift)) + (lo >> tp->shift);
+}
+
+// timepage_gettime - clock_gettime from the time page, at TSC value tsc
+static inline int
+timepage_gettime(const struct timepage *tp, uint64_t tsc, int clockid, struct timespec *ts) {
+    if (clockid != CLOCK_REALTIME && clockid != CLOCK_MONOTONIC) {
+        return -E_INVAL;
+    }
+    uint64_t nsec = timepage_nsec(tp, tsc);
+    ts->tv_nsec = do_div(nsec, NSEC_PER_SEC);
+    ts->tv_sec = (uint32_t)nsec;
+    if (clockid == CLOCK_REALTIME) {
+        ts->tv_sec += tp->realtime_sec;
+    }
+    return 0;
+}
+
+#endif /* !__LIBS_TIME_H__ */
+
@@ -9,6 +9,9 @@
 #define SYS_wait            3
 #define SYS_exec            4
 #define SYS_clone           5
+#define SYS_vfork           6
+#define SYS_spawn           7
+#define SYS_exit_thread     9
 #define SYS_yield           10
 #define SYS_sleep           11
 #define SYS_kill            12
@@ -17,8 +20,21 @@
 #define SYS_mmap            20
 #define SYS_munmap          21
 #define SYS_shmem           22
+#define SYS_memlimit        23
+#define SYS_futex           24
+#define SYS_sched_setscheduler 25
+#define SYS_usleep          26
+#define SYS_clock_gettime   27
+#define SYS_uring_setup     28
+#define SYS_uring_enter     29
 #define SYS_putc            30
 #define SYS_pgdir           31
+#define SYS_procinfo        32
+#define SYS_meminfo         33
+#define SYS_systrace        34
+#define SYS_sigaction       35
+#define SYS_sigprocmask     36
+#define SYS_sigreturn       37
 #define SYS_open            100
 #define SYS_close           101
 #define SYS_read            102
@@ -36,6 +52,15 @@
 #define CLONE_VM            0x00000100  // set if VM shared between processes
 #define CLONE_THREAD        0x00000200  // thread group
 #define CLONE_FS            0x00000800  // set if shared between processes
+#define CLONE_VFORK         0x00004000  // the parent sleeps until the child execs or exits
+
+/* SYS_futex operations */
+#define FUTEX_WAIT          0           // sleep if the word still holds the value
+#define FUTEX_WAKE          1           // wake up to val waiters of the word
+
+/* SYS_mmap flags */
+#define MMAP_WRITE          0x00000100  // the mapping is writable
+#define MMAP_STACK          0x00000200  // the mapping is used as a stack
 
 /* VFS flags */
 // flags for open: choose one of these
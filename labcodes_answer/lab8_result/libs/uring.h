@@ -0,0 +1,50 @@
+#ifndef __LIBS_URING_H__
+#define __LIBS_URING_H__
+
+#include <defs.h>
+
+/* *
+ * A submission and a completion queue in the memory of a process, for
+ * uring_setup and uring_enter. The process fills entries at sq_tail and
+ * takes completions at cq_head; the kernel takes entries at sq_head and
+ * posts completions at cq_tail. The indices only grow, the slot of index i
+ * is i % URING_ENTRIES.
+ * */
+
+#define URING_ENTRIES           32      // a power of 2
+
+/* operations of a submission queue entry, they do what the system call does */
+#define URING_OP_NOP            0
+#define URING_OP_READ           1       // read(fd, addr, len)
+#define URING_OP_WRITE          2       // write(fd, addr, len)
+#define URING_OP_OPEN           3       // open(addr, len), len holds the open flags
+#define URING_OP_CLOSE          4       // close(fd)
+#define URING_OP_GETDIRENTRY    5       // getdirentry(fd, addr)
+
+/* uring_setup flags */
+#define URING_SETUP_WORKER      0x1     // a kernel thread runs the entries, uring_enter only hands them over
+
+struct uring_sqe {
+    uint32_t opcode;                    // URING_OP_*
+    int fd;
+    uintptr_t addr;                     // the buffer, the path or the dirent
+    uint32_t len;
+    uint32_t user_data;                 // given back in the completion
+};
+
+struct uring_cqe {
+    uint32_t user_data;                 // of the entry
+    int res;                            // what the system call would return
+};
+
+struct uring {
+    volatile uint32_t sq_head;          // the next entry the kernel takes
+    volatile uint32_t sq_tail;          // the next free entry, moved by the process
+    volatile uint32_t cq_head;          // the next completion the process takes
+    volatile uint32_t cq_tail;          // the next free completion, moved by the kernel
+    struct uring_sqe sq[URING_ENTRIES];
+    struct uring_cqe cq[URING_ENTRIES];
+};
+
+#endif /* !__LIBS_URING_H__ */
+
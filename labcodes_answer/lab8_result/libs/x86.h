@@ -50,6 +50,18 @@ static inline uintptr_t rcr1(void) __attribute__((always_inline));
 static inline uintptr_t rcr2(void) __attribute__((always_inline));
 static inline uintptr_t rcr3(void) __attribute__((always_inline));
 static inline void invlpg(void *addr) __attribute__((always_inline));
+static inline uint32_t bsf(uint32_t x) __attribute__((always_inline));
+static inline void lcr4(uintptr_t cr4) __attribute__((always_inline));
+static inline uintptr_t rcr4(void) __attribute__((always_inline));
+static inline void cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp) __attribute__((always_inline));
+static inline void clts(void) __attribute__((always_inline));
+static inline void fninit(void) __attribute__((always_inline));
+static inline void fxsave(void *area) __attribute__((always_inline));
+static inline void fxrstor(void *area) __attribute__((always_inline));
+static inline void pause(void) __attribute__((always_inline));
+static inline uint64_t rdtsc(void) __attribute__((always_inline));
+static inline uint64_t rdmsr(uint32_t msr) __attribute__((always_inline));
+static inline void wrmsr(uint32_t msr, uint64_t value) __attribute__((always_inline));
 
 static inline uint8_t
 inb(uint16_t port) {
@@ -208,6 +220,85 @@ invlpg(void *addr) {
     asm volatile ("invlpg (%0)" :: "r" (addr) : "memory");
 }
 
+/* bsf - the index of the lowest set bit, x must not be 0 */
+static inline uint32_t
+bsf(uint32_t x) {
+    uint32_t index;
+    asm volatile ("bsfl %1, %0" : "=r" (index) : "rm" (x) : "cc");
+    return index;
+}
+
+static inline void
+lcr4(uintptr_t cr4) {
+    asm volatile ("mov %0, %%cr4" :: "r" (cr4) : "memory");
+}
+
+static inline uintptr_t
+rcr4(void) {
+    uintptr_t cr4;
+    asm volatile ("mov %%cr4, %0" : "=r" (cr4) :: "memory");
+    return cr4;
+}
+
+static inline void
+cpuid(uint32_t info, uint32_t *eaxp, uint32_t *ebxp, uint32_t *ecxp, uint32_t *edxp) {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (info));
+    if (eaxp) *eaxp = eax;
+    if (ebxp) *ebxp = ebx;
+    if (ecxp) *ecxp = ecx;
+    if (edxp) *edxp = edx;
+}
+
+/* clts - clear CR0.TS, the next FPU instruction does not trap */
+static inline void
+clts(void) {
+    asm volatile ("clts" ::: "memory");
+}
+
+static inline void
+fninit(void) {
+    asm volatile ("fninit" ::: "memory");
+}
+
+/* fxsave/fxrstor - save/restore the x87 and SSE state, area must be 16 bytes aligned */
+static inline void
+fxsave(void *area) {
+    asm volatile ("fxsave (%0)" :: "r" (area) : "memory");
+}
+
+static inline void
+fxrstor(void *area) {
+    asm volatile ("fxrstor (%0)" :: "r" (area) : "memory");
+}
+
+/* pause - a hint in spin-wait loops */
+static inline void
+pause(void) {
+    asm volatile ("pause" ::: "memory");
+}
+
+/* rdtsc - read the time-stamp counter, the cycles since reset */
+static inline uint64_t
+rdtsc(void) {
+    uint64_t tsc;
+    asm volatile ("rdtsc" : "=A" (tsc));
+    return tsc;
+}
+
+/* rdmsr/wrmsr - read/write a model specific register */
+static inline uint64_t
+rdmsr(uint32_t msr) {
+    uint64_t value;
+    asm volatile ("rdmsr" : "=A" (value) : "c" (msr));
+    return value;
+}
+
+static inline void
+wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile ("wrmsr" :: "c" (msr), "A" (value));
+}
+
 static inline int __strcmp(const char *s1, const char *s2) __attribute__((always_inline));
 static inline char *__strcpy(char *dst, const char *src) __attribute__((always_inline));
 static inline void *__memset(void *s, char c, size_t n) __attribute__((always_inline));
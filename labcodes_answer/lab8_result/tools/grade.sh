@@ -343,6 +343,8 @@ default_check() {
     'page fault at 0x00000100: K/W [no page found].'            \
     'check_pgfault() succeeded!'                                \
     'check_vmm() succeeded.'					\
+    'check_mlfq() succeeded!'                                   \
+    'check_timer() succeeded!'                                  \
     'page fault at 0x00001000: K/W [no page found].'            \
     'page fault at 0x00002000: K/W [no page found].'            \
     'page fault at 0x00003000: K/W [no page found].'            \
@@ -391,6 +393,18 @@ run_test -prog 'softint' -check default_check                   \
         '  ss   0x----0023'                                     \
     ! - 'user panic at .*'
 
+timeout=150
+run_test -prog 'forkstorm' -check default_check                 \
+      - 'kernel_execve: pid = ., name = "forkstorm".*'           \
+        'forkstorm: 8 rounds of 128 forks.'                     \
+      - 'round 7: 1024 live children, [0-9]+ msecs for 128 forks\.' \
+      - 'pids wrapped [1-9][0-9]* times, [1-9][0-9]* reused\.'    \
+        'forkstorm pass.'                                       \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+timeout=
+
 pts=10
 
 run_test -prog 'faultread'  -check default_check                                     \
@@ -459,6 +473,159 @@ run_test -prog 'badarg' -check default_check                    \
         'init check memory pass.'                               \
     ! - 'user panic at .*'
 
+run_test -prog 'memlimit' -check default_check                  \
+      - 'kernel_execve: pid = ., name = "memlimit".*'            \
+        'touch 4 pages under the limit ok.'                     \
+        'killed by kernel.'                                     \
+        'touch 64 pages over the limit killed.'                 \
+        'system calls over the limit fail.'                     \
+        'memlimit pass.'                                        \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'swaptest' -check default_check                  \
+      - 'kernel_execve: pid = ., name = "swaptest".*'            \
+        'wrote and read back .* pages over .* free.'            \
+        'overcommitted pages swapped in ok.'                    \
+        'swap .* pages, .* major faults.'                       \
+        'swaptest pass.'                                        \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'threadtest' -check default_check                \
+      - 'kernel_execve: pid = ., name = "threadtest".*'          \
+        'all 4 threads started.'                                \
+        'counter = 4000.'                                       \
+        'threadtest pass.'                                      \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'spawntest' -check default_check                 \
+      - 'kernel_execve: pid = ., name = "spawntest".*'           \
+        'Hello world!!.'                                        \
+        'vfork ok.'                                             \
+        'spawn ok.'                                             \
+        'spawntest pass.'                                       \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'texttest' -check default_check                  \
+      - 'kernel_execve: pid = ., name = "texttest".*'            \
+        'Hello world!!.'                                        \
+        'exec shares text ok.'                                  \
+        'fork shares text ok.'                                  \
+        'texttest pass.'                                        \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'switchbench' -check default_check               \
+      - 'kernel_execve: pid = ., name = "switchbench".*'         \
+        'switchbench: 20000 yields each side.'                  \
+        'switchbench pass.'                                     \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'fputest' -check default_check                   \
+      - 'kernel_execve: pid = ., name = "fputest".*'             \
+        'x87 and sse state kept across switches.'               \
+        'fputest pass.'                                         \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'schedbench' -check default_check                \
+      - 'kernel_execve: pid = ., name = "schedbench".*'          \
+      - 'interactive: wakeup latency avg [0-9]+ msecs, max [0-9]+ msecs.' \
+      - 'fairness .*'                                            \
+        'schedbench pass.'                                      \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'rttest' -check default_check                    \
+      - 'kernel_execve: pid = ., name = "rttest".*'              \
+        'rttest: fifo ok.'                                      \
+        'rttest: wakeup preemption ok.'                         \
+        'rttest: rr ok.'                                        \
+      - 'rttest: edf thread ran in [0-9]+ of 30 ticks.'          \
+        'rttest: edf ok.'                                       \
+        'rttest pass.'                                          \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'pmatrix' -check default_check                   \
+      - 'kernel_execve: pid = ., name = "pmatrix".*'             \
+      - 'pmatrix: threads 1, [0-9]+ msecs, speedup 1.00.'        \
+      - 'pmatrix: threads 2, [0-9]+ msecs, speedup [0-9]+.[0-9]+.' \
+      - 'pmatrix: threads 4, [0-9]+ msecs, speedup [0-9]+.[0-9]+.' \
+        'pmatrix pass.'                                         \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'usleep' -check default_check                    \
+      - 'kernel_execve: pid = ., name = "usleep".*'              \
+      - 'usleep: 100 x 500 usecs in [0-9]+ ticks.'               \
+        'usleep pass.'                                          \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'clocktest' -check default_check                 \
+      - 'kernel_execve: pid = ., name = "clocktest".*'           \
+      - 'clocktest: usleep of 20000 usecs took [0-9]+ usecs.'    \
+      - 'clocktest: [0-9]+ cycles per clock_gettime, [0-9]+ per system call.' \
+        'clocktest pass.'                                       \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'nullsys' -check default_check                   \
+      - 'kernel_execve: pid = ., name = "nullsys".*'             \
+      - 'nullsys: int 0x80 [0-9]+ cycles, sysenter [0-9]+ cycles.' \
+        'nullsys pass.'                                         \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'uringtest' -check default_check                 \
+      - 'kernel_execve: pid = ., name = "uringtest".*'           \
+      - 'uringtest: read, [0-9]+ cycles a read.'                 \
+      - 'uringtest: ring, [0-9]+ cycles a read.'                 \
+      - 'uringtest: ring with a worker, [0-9]+ cycles a read.'   \
+        'uringtest pass.'                                       \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'strace' -check default_check                    \
+      - 'kernel_execve: pid = ., name = "strace".*'              \
+      - 'syscall               calls  cycles/call  latency histogram.*' \
+      - 'getpid +[0-9]+ +[0-9]+ .*'                              \
+        'strace pass.'                                          \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
+run_test -prog 'sigtest' -check default_check                   \
+      - 'kernel_execve: pid = ., name = "sigtest".*'             \
+      - 'sigtest: handlers and masks ok.'                        \
+      - 'sigtest: sleep interrupted ok.'                         \
+      - 'sigtest: asynchronous handler ok.'                      \
+      - 'Caught signal 2'                                        \
+      - 'sigtest: children ok.'                                  \
+        'sigtest pass.'                                         \
+        'all user-mode processes have quit.'                    \
+        'init check memory pass.'                               \
+    ! - 'user panic at .*'
+
 pts=10
 
 run_test -prog 'exit'  -check default_check                                          \
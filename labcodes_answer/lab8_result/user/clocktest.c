@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <x86.h>
+#include <time.h>
+#include <syscall.h>
+
+#define ROUNDS          1000
+#define SLEEP_USECS     20000
+
+/* *
+ * clocktest - clock_gettime reads the time page, without a system call:
+ * it never goes back, it agrees with the kernel, a sleep of SLEEP_USECS
+ * takes at least that long on it, and it costs less than the trap.
+ * */
+
+static uint64_t
+nsec(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+int
+main(void) {
+    struct timespec ts, kts;
+    uint64_t last, now, start, cycles_page, cycles_trap;
+    int i;
+
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    last = nsec(&ts);
+    for (i = 0; i < ROUNDS; i ++) {
+        assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+        assert(ts.tv_nsec < NSEC_PER_SEC);
+        now = nsec(&ts);
+        assert(now >= last);
+        last = now;
+    }
+
+    // the kernel reads the clock after us, but not much later
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    assert(sys_clock_gettime(CLOCK_MONOTONIC, &kts) == 0);
+    assert(nsec(&kts) >= nsec(&ts) && nsec(&kts) - nsec(&ts) < NSEC_PER_SEC / 100);
+
+    // the RTC is past 2020
+    assert(clock_gettime(CLOCK_REALTIME, &ts) == 0);
+    assert(ts.tv_sec > 1577836800);
+    assert(clock_gettime(42, &ts) != 0);
+
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    start = nsec(&ts);
+    assert(usleep(SLEEP_USECS) == 0);
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    now = nsec(&ts) - start;
+    do_div(now, 1000);
+    cprintf("clocktest: usleep of %d usecs took %d usecs.\n", SLEEP_USECS, (uint32_t)now);
+    // the timers count from the start of the current 100 usecs
+    assert(now + 100 >= SLEEP_USECS);
+
+    start = rdtsc();
+    for (i = 0; i < ROUNDS; i ++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    cycles_page = rdtsc() - start;
+    start = rdtsc();
+    for (i = 0; i < ROUNDS; i ++) {
+        sys_clock_gettime(CLOCK_MONOTONIC, &kts);
+    }
+    cycles_trap = rdtsc() - start;
+    do_div(cycles_page, ROUNDS);
+    do_div(cycles_trap, ROUNDS);
+    cprintf("clocktest: %d cycles per clock_gettime, %d per system call.\n",
+            (uint32_t)cycles_page, (uint32_t)cycles_trap);
+    assert(cycles_page < cycles_trap);
+
+    cprintf("clocktest pass.\n");
+    return 0;
+}
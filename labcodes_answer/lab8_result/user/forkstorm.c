@@ -0,0 +1,68 @@
+#include <ulib.h>
+#include <stdio.h>
+
+#define ROUNDS      8
+#define BATCH       128
+#define MAX_PID     8192        // as in kern/process/proc.h
+#define WRAP_FORKS  (MAX_PID + MAX_PID / 4)
+
+static int pids[ROUNDS * BATCH];
+static bool live[MAX_PID], seen[MAX_PID];
+
+// wrap - fork and reap enough short lived children for the pids to wrap around,
+//      - while the sleeping ones hold theirs
+static void
+wrap(void) {
+    int i, pid, last = 0, wraps = 0, reused = 0;
+    for (i = 0; i < WRAP_FORKS; i ++) {
+        if ((pid = fork()) == 0) {
+            exit(0);
+        }
+        assert(0 < pid && pid < MAX_PID && !live[pid]);
+        if (pid < last) {
+            wraps ++;
+        }
+        if (seen[pid]) {
+            reused ++;
+        }
+        seen[pid] = 1, last = pid;
+        assert(waitpid(pid, NULL) == 0);
+    }
+    assert(wraps > 0 && reused > 0);
+    cprintf("pids wrapped %d times, %d reused.\n", wraps, reused);
+}
+
+int
+main(void) {
+    int i, j, n = 0;
+    unsigned int begin, elapsed;
+
+    cprintf("forkstorm: %d rounds of %d forks.\n", ROUNDS, BATCH);
+    for (i = 0; i < ROUNDS; i ++) {
+        begin = gettime_msec();
+        for (j = 0; j < BATCH; j ++) {
+            int pid;
+            if ((pid = fork()) == 0) {
+                sleep(~0);
+                exit(0xdead);
+            }
+            assert(0 < pid && pid < MAX_PID && !live[pid]);
+            live[pid] = 1, pids[n ++] = pid;
+        }
+        elapsed = gettime_msec() - begin;
+        cprintf("round %d: %4d live children, %d msecs for %d forks.\n", i, n, elapsed, BATCH);
+    }
+
+    wrap();
+
+    for (i = 0; i < n; i ++) {
+        assert(kill(pids[i]) == 0);
+    }
+    for (i = 0; i < n; i ++) {
+        assert(waitpid(pids[i], NULL) == 0);
+    }
+    assert(wait() != 0);
+    cprintf("forkstorm pass.\n");
+    return 0;
+}
+
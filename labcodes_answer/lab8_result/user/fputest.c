@@ -0,0 +1,63 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ROUNDS          2000
+
+// harmonic - sum of x / i, yielding to the other process every few steps if yielding
+static double
+harmonic(double x, bool yielding) {
+    volatile double sum = 0;        // rounded to double every step, whether it yields or not
+    int i;
+    for (i = 1; i <= ROUNDS; i ++) {
+        sum += x / i;
+        if (yielding && i % 50 == 0) {
+            yield();
+        }
+    }
+    return sum;
+}
+
+static bool
+has_sse(void) {
+    uint32_t edx;
+    asm volatile ("cpuid" : "=d" (edx) : "a" (1) : "ebx", "ecx");
+    return (edx >> 25) & 1;
+}
+
+// xmm_check - park a pattern in xmm0 across many context switches
+static bool
+xmm_check(uint32_t seed) {
+    uint32_t in[4] = {seed, ~seed, seed * 3, 0x5a5a5a5a}, out[4];
+    int i;
+    asm volatile ("movups %0, %%xmm0" :: "m" (in));
+    for (i = 0; i < 100; i ++) {
+        yield();
+    }
+    asm volatile ("movups %%xmm0, %0" : "=m" (out));
+    return memcmp(in, out, sizeof(in)) == 0;
+}
+
+static bool
+fpu_check(int seed) {
+    // the first sum runs alone, the second one interleaved with the other process
+    double expect = harmonic(seed, 0);
+    if (harmonic(seed, 1) != expect) {
+        return 0;
+    }
+    return !has_sse() || xmm_check(seed);
+}
+
+int
+main(void) {
+    int pid, code;
+    if ((pid = fork()) == 0) {
+        exit(fpu_check(7) ? 0 : -1);
+    }
+    assert(pid > 0);
+    assert(fpu_check(3));
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    cprintf("x87 and sse state kept across switches.\n");
+    cprintf("fputest pass.\n");
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef __USER_INCLUDE_STDIO_H__
+#define __USER_INCLUDE_STDIO_H__
+
+/* *
+ * The headers of user/include come before libs/ for the user programs, and
+ * add the declarations of the user library to the libs/ header of the same
+ * name, which the kernel shares.
+ * */
+#include_next <stdio.h>
+
+/* user/libs/stdio.c */
+int printf(const char *fmt, ...);
+
+#endif /* !__USER_INCLUDE_STDIO_H__ */
+
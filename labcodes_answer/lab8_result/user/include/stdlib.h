@@ -0,0 +1,12 @@
+#ifndef __USER_INCLUDE_STDLIB_H__
+#define __USER_INCLUDE_STDLIB_H__
+
+#include_next <stdlib.h>
+#include <ulib.h>
+
+/* exit codes */
+#define EXIT_SUCCESS    0
+#define EXIT_FAILURE    1
+
+#endif /* !__USER_INCLUDE_STDLIB_H__ */
+
@@ -0,0 +1,12 @@
+#ifndef __USER_INCLUDE_UNISTD_H__
+#define __USER_INCLUDE_UNISTD_H__
+
+#include_next <unistd.h>
+
+/* sleep and the other calls of the user library */
+#ifndef __ASSEMBLER__
+#include <ulib.h>
+#endif
+
+#endif /* !__USER_INCLUDE_UNISTD_H__ */
+
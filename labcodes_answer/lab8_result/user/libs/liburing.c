@@ -0,0 +1,74 @@
+#include <defs.h>
+#include <string.h>
+#include <error.h>
+#include <syscall.h>
+#include <liburing.h>
+
+// the kernel sees the indices, not what the compiler keeps in registers
+#define barrier()               asm volatile ("" ::: "memory")
+
+// uring_queue_init - set up the ring of this process in q, flags: URING_SETUP_*
+int
+uring_queue_init(struct uring_queue *q, uint32_t flags) {
+    memset(q, 0, sizeof(struct uring_queue));
+    return sys_uring_setup(&(q->ring), flags);
+}
+
+// uring_get_sqe - the next free submission entry, NULL when the queue is full
+struct uring_sqe *
+uring_get_sqe(struct uring_queue *q) {
+    struct uring *ring = &(q->ring);
+    if (q->sqe_tail - ring->sq_head >= URING_ENTRIES) {
+        return NULL;
+    }
+    return ring->sq + (q->sqe_tail ++ % URING_ENTRIES);
+}
+
+// uring_submit_and_wait - hand the new entries to the kernel, and wait for wait_nr completions
+int
+uring_submit_and_wait(struct uring_queue *q, uint32_t wait_nr) {
+    struct uring *ring = &(q->ring);
+    barrier();
+    ring->sq_tail = q->sqe_tail;
+    return sys_uring_enter(q->sqe_tail - ring->sq_head, wait_nr);
+}
+
+int
+uring_submit(struct uring_queue *q) {
+    return uring_submit_and_wait(q, 0);
+}
+
+// uring_peek_cqe - the next completion, NULL if there is none yet
+struct uring_cqe *
+uring_peek_cqe(struct uring_queue *q) {
+    struct uring *ring = &(q->ring);
+    if (ring->cq_head == ring->cq_tail) {
+        return NULL;
+    }
+    barrier();
+    return ring->cq + (ring->cq_head % URING_ENTRIES);
+}
+
+// uring_wait_cqe - the next completion, submit the entries left and wait for it if there is none yet
+int
+uring_wait_cqe(struct uring_queue *q, struct uring_cqe **cqe_store) {
+    int ret;
+    if ((*cqe_store = uring_peek_cqe(q)) == NULL) {
+        if ((ret = uring_submit_and_wait(q, 1)) < 0) {
+            return ret;
+        }
+        // without a worker nothing more completes than what was submitted
+        if ((*cqe_store = uring_peek_cqe(q)) == NULL) {
+            return -E_AGAIN;
+        }
+    }
+    return 0;
+}
+
+// uring_cqe_seen - the completion from uring_peek_cqe is consumed, its slot is free again
+void
+uring_cqe_seen(struct uring_queue *q) {
+    barrier();
+    q->ring.cq_head ++;
+}
+
@@ -0,0 +1,70 @@
+#ifndef __USER_LIBS_LIBURING_H__
+#define __USER_LIBS_LIBURING_H__
+
+#include <defs.h>
+#include <uring.h>
+
+/* *
+ * A small liburing on top of SYS_uring_setup and SYS_uring_enter. Take an
+ * entry with uring_get_sqe, fill it with one of the uring_prep_* functions,
+ * and submit all the entries taken so far with uring_submit or
+ * uring_submit_and_wait. Completions come back in any order with a worker,
+ * user_data tells them apart; uring_cqe_seen gives the slot back.
+ * */
+
+struct uring_queue {
+    struct uring ring;                  // shared with the kernel
+    uint32_t sqe_tail;                  // entries taken, sq_tail catches up in uring_submit
+};
+
+int uring_queue_init(struct uring_queue *q, uint32_t flags);
+struct uring_sqe *uring_get_sqe(struct uring_queue *q);
+int uring_submit(struct uring_queue *q);
+int uring_submit_and_wait(struct uring_queue *q, uint32_t wait_nr);
+struct uring_cqe *uring_peek_cqe(struct uring_queue *q);
+int uring_wait_cqe(struct uring_queue *q, struct uring_cqe **cqe_store);
+void uring_cqe_seen(struct uring_queue *q);
+
+static inline void
+uring_prep(struct uring_sqe *sqe, uint32_t opcode, int fd, const void *addr, uint32_t len, uint32_t user_data) {
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)addr;
+    sqe->len = len;
+    sqe->user_data = user_data;
+}
+
+static inline void
+uring_prep_nop(struct uring_sqe *sqe, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_NOP, -1, NULL, 0, user_data);
+}
+
+static inline void
+uring_prep_read(struct uring_sqe *sqe, int fd, void *buf, size_t len, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_READ, fd, buf, len, user_data);
+}
+
+static inline void
+uring_prep_write(struct uring_sqe *sqe, int fd, const void *buf, size_t len, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_WRITE, fd, buf, len, user_data);
+}
+
+static inline void
+uring_prep_open(struct uring_sqe *sqe, const char *path, uint32_t open_flags, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_OPEN, -1, path, open_flags, user_data);
+}
+
+static inline void
+uring_prep_close(struct uring_sqe *sqe, int fd, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_CLOSE, fd, NULL, 0, user_data);
+}
+
+struct dirent;
+
+static inline void
+uring_prep_getdirentry(struct uring_sqe *sqe, int fd, struct dirent *dirent, uint32_t user_data) {
+    uring_prep(sqe, URING_OP_GETDIRENTRY, fd, dirent, 0, user_data);
+}
+
+#endif /* !__USER_LIBS_LIBURING_H__ */
+
@@ -3,39 +3,50 @@
 
 #include <defs.h>
 #include <atomic.h>
+#include <unistd.h>
 #include <ulib.h>
 
-#define INIT_LOCK           {0}
+/* *
+ * A futex based mutex: the word is 0 when unlocked, 1 when locked, and 2
+ * when locked with (possibly) sleeping waiters. Taking a free lock and
+ * releasing a lock nobody waits for never enter the kernel.
+ * */
 
-typedef volatile bool lock_t;
+#define INIT_LOCK           0
+
+typedef volatile int lock_t;
 
 static inline void
 lock_init(lock_t *l) {
     *l = 0;
 }
 
+// try_lock - take the lock if it is free, return true if it was already held
 static inline bool
 try_lock(lock_t *l) {
-    return test_and_set_bit(0, l);
+    return cmpxchg(l, 0, 1) != 0;
 }
 
 static inline void
 lock(lock_t *l) {
-    if (try_lock(l)) {
-        int step = 0;
-        do {
-            yield();
-            if (++ step == 100) {
-                step = 0;
-                sleep(10);
-            }
-        } while (try_lock(l));
+    int c;
+    if ((c = cmpxchg(l, 0, 1)) != 0) {
+        // contended: mark the lock as having waiters and sleep until it is free
+        if (c != 2) {
+            c = xchg(l, 2);
+        }
+        while (c != 0) {
+            futex(l, FUTEX_WAIT, 2);
+            c = xchg(l, 2);
+        }
     }
 }
 
 static inline void
 unlock(lock_t *l) {
-    test_and_clear_bit(0, l);
+    if (xchg(l, 0) == 2) {
+        futex(l, FUTEX_WAKE, 1);
+    }
 }
 
 #endif /* !__USER_LIBS_LOCK_H__ */
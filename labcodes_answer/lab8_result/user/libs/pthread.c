@@ -0,0 +1,166 @@
+#include <defs.h>
+#include <unistd.h>
+#include <error.h>
+#include <ulib.h>
+#include <lock.h>
+#include <pthread.h>
+
+// the start block sits at the top of the stack of a new thread
+struct pthread_start {
+    void *(*start_routine)(void *);
+    void *arg;
+};
+
+// the stacks of the threads created and not joined yet
+static struct {
+    pthread_t tid;          // 0 for a free slot
+    uintptr_t stack;
+    size_t stack_size;
+} threads[PTHREAD_MAX];
+
+static lock_t threads_lock = INIT_LOCK;
+
+// pthread_start - the first function of a new thread, on its own stack
+static int
+pthread_start(void *arg) {
+    struct pthread_start *start = (struct pthread_start *)arg;
+    return (int)start->start_routine(start->arg);
+}
+
+int
+pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg) {
+    size_t stack_size = (attr != NULL && attr->stack_size != 0) ? attr->stack_size : PTHREAD_STACK_SIZE;
+    int i, ret;
+
+    lock(&threads_lock);
+    for (i = 0; i < PTHREAD_MAX; i ++) {
+        if (threads[i].tid == 0) {
+            threads[i].tid = -1;
+            break;
+        }
+    }
+    unlock(&threads_lock);
+    if (i == PTHREAD_MAX) {
+        return -E_NO_FREE_PROC;
+    }
+
+    uintptr_t stack = 0;
+    if ((ret = mmap(&stack, stack_size, MMAP_WRITE | MMAP_STACK)) != 0) {
+        goto failed;
+    }
+    threads[i].stack = stack;
+    threads[i].stack_size = stack_size;
+
+    struct pthread_start *start = (struct pthread_start *)(stack + stack_size) - 1;
+    start->start_routine = start_routine;
+    start->arg = arg;
+
+    if ((ret = clone(CLONE_VM | CLONE_THREAD | CLONE_FS, (uintptr_t)start, pthread_start, start)) <= 0) {
+        munmap(stack, stack_size);
+        goto failed;
+    }
+    threads[i].tid = ret;
+    if (thread != NULL) {
+        *thread = ret;
+    }
+    return 0;
+
+failed:
+    threads[i].tid = 0;
+    return (ret != 0) ? ret : -E_UNSPECIFIED;
+}
+
+int
+pthread_join(pthread_t thread, void **retval) {
+    int i, ret, code;
+    if ((ret = waitpid(thread, &code)) != 0) {
+        return ret;
+    }
+    if (retval != NULL) {
+        *retval = (void *)code;
+    }
+    lock(&threads_lock);
+    for (i = 0; i < PTHREAD_MAX; i ++) {
+        if (threads[i].tid == thread) {
+            munmap(threads[i].stack, threads[i].stack_size);
+            threads[i].tid = 0;
+            break;
+        }
+    }
+    unlock(&threads_lock);
+    return 0;
+}
+
+void
+pthread_exit(void *retval) {
+    exit_thread((int)retval);
+}
+
+pthread_t
+pthread_self(void) {
+    return getpid();
+}
+
+int
+pthread_mutex_init(pthread_mutex_t *mutex, const void *attr) {
+    lock_init(&(mutex->lock));
+    return 0;
+}
+
+int
+pthread_mutex_lock(pthread_mutex_t *mutex) {
+    lock(&(mutex->lock));
+    return 0;
+}
+
+int
+pthread_mutex_trylock(pthread_mutex_t *mutex) {
+    return try_lock(&(mutex->lock)) ? -E_BUSY : 0;
+}
+
+int
+pthread_mutex_unlock(pthread_mutex_t *mutex) {
+    unlock(&(mutex->lock));
+    return 0;
+}
+
+int
+pthread_mutex_destroy(pthread_mutex_t *mutex) {
+    return 0;
+}
+
+int
+pthread_cond_init(pthread_cond_t *cond, const void *attr) {
+    cond->seq = 0;
+    return 0;
+}
+
+// pthread_cond_wait - sleep until the sequence number of cond moves on
+int
+pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    int seq = cond->seq;
+    pthread_mutex_unlock(mutex);
+    futex(&(cond->seq), FUTEX_WAIT, seq);
+    pthread_mutex_lock(mutex);
+    return 0;
+}
+
+int
+pthread_cond_signal(pthread_cond_t *cond) {
+    cond->seq ++;
+    futex(&(cond->seq), FUTEX_WAKE, 1);
+    return 0;
+}
+
+int
+pthread_cond_broadcast(pthread_cond_t *cond) {
+    cond->seq ++;
+    futex(&(cond->seq), FUTEX_WAKE, PTHREAD_MAX);
+    return 0;
+}
+
+int
+pthread_cond_destroy(pthread_cond_t *cond) {
+    return 0;
+}
+
@@ -0,0 +1,53 @@
+#ifndef __USER_LIBS_PTHREAD_H__
+#define __USER_LIBS_PTHREAD_H__
+
+#include <defs.h>
+#include <lock.h>
+
+/* *
+ * A small pthread subset on top of SYS_clone. Threads share the mm and the
+ * files of the process, each one runs on its own stack mmap'ed by
+ * pthread_create and unmapped by pthread_join. A thread can only be joined
+ * by the thread that created it, and exit() ends the whole thread group.
+ * Mutexes and condition variables sleep in the kernel through SYS_futex.
+ * */
+
+#define PTHREAD_STACK_SIZE          (16 * 4096)     // default stack size of a thread
+#define PTHREAD_MAX                 64              // threads created and not joined yet
+
+typedef int pthread_t;
+
+typedef struct {
+    size_t stack_size;
+} pthread_attr_t;
+
+typedef struct {
+    lock_t lock;
+} pthread_mutex_t;
+
+typedef struct {
+    volatile int seq;
+} pthread_cond_t;
+
+#define PTHREAD_MUTEX_INITIALIZER   {0}
+#define PTHREAD_COND_INITIALIZER    {0}
+
+int pthread_create(pthread_t *thread, const pthread_attr_t *attr, void *(*start_routine)(void *), void *arg);
+int pthread_join(pthread_t thread, void **retval);
+void __noreturn pthread_exit(void *retval);
+pthread_t pthread_self(void);
+
+int pthread_mutex_init(pthread_mutex_t *mutex, const void *attr);
+int pthread_mutex_lock(pthread_mutex_t *mutex);
+int pthread_mutex_trylock(pthread_mutex_t *mutex);
+int pthread_mutex_unlock(pthread_mutex_t *mutex);
+int pthread_mutex_destroy(pthread_mutex_t *mutex);
+
+int pthread_cond_init(pthread_cond_t *cond, const void *attr);
+int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int pthread_cond_signal(pthread_cond_t *cond);
+int pthread_cond_broadcast(pthread_cond_t *cond);
+int pthread_cond_destroy(pthread_cond_t *cond);
+
+#endif /* !__USER_LIBS_PTHREAD_H__ */
+
@@ -0,0 +1,38 @@
+#include <defs.h>
+#include <syscall.h>
+#include <signal.h>
+
+// signal - set the handler of signum, return the old one or SIG_ERR
+sighandler_t
+signal(int signum, sighandler_t handler) {
+    struct sigaction act, oldact;
+    act.sa_handler = handler;
+    act.sa_mask = 0;
+    act.sa_flags = 0;
+    if (sys_sigaction(signum, &act, &oldact) != 0) {
+        return SIG_ERR;
+    }
+    return oldact.sa_handler;
+}
+
+int
+sigaction(int signum, const struct sigaction *act, struct sigaction *oldact) {
+    return sys_sigaction(signum, act, oldact);
+}
+
+int
+sigprocmask(int how, const sigset_t *set, sigset_t *oldset) {
+    return sys_sigprocmask(how, set, oldset);
+}
+
+// sigsend - send signum to the process pid, the kill of POSIX
+int
+sigsend(int pid, int signum) {
+    return sys_kill(pid, signum);
+}
+
+// raise - send signum to the current process, its handler runs before raise returns
+int
+raise(int signum) {
+    return sys_kill(sys_getpid(), signum);
+}
@@ -87,3 +87,15 @@ fprintf(int fd, const char *fmt, ...) {
 
     return cnt;
 }
+
+// printf - fprintf to stdout
+int
+printf(const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    int cnt = vfprintf(1, fmt, ap);
+    va_end(ap);
+
+    return cnt;
+}
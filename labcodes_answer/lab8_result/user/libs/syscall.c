@@ -4,10 +4,15 @@
 #include <syscall.h>
 #include <stat.h>
 #include <dirent.h>
+#include <time.h>
+#include <signal.h>
 
 
 #define MAX_ARGS            5
 
+// the system calls go through SYSENTER where the kernel offers it, clear to use int $T_SYSCALL
+bool syscall_sysenter = 1;
+
 static inline int
 syscall(int num, ...) {
     va_list ap;
@@ -19,6 +24,23 @@ syscall(int num, ...) {
     }
     va_end(ap);
 
+    const struct timepage *page = (const struct timepage *)TIMEPAGE_VA;
+    if (syscall_sysenter && page->sysenter != 0) {
+        // the stub in the time page, it returns with all the registers but eax
+        asm volatile (
+            "call *%c1;"
+            : "=a" (ret)
+            : "i" (TIMEPAGE_VA + offsetof(struct timepage, sysenter)),
+              "a" (num),
+              "d" (a[0]),
+              "c" (a[1]),
+              "b" (a[2]),
+              "D" (a[3]),
+              "S" (a[4])
+            : "cc", "memory");
+        return ret;
+    }
+
     asm volatile (
         "int %1;"
         : "=a" (ret)
@@ -38,6 +60,11 @@ sys_exit(int error_code) {
     return syscall(SYS_exit, error_code);
 }
 
+int
+sys_exit_thread(int error_code) {
+    return syscall(SYS_exit_thread, error_code);
+}
+
 int
 sys_fork(void) {
     return syscall(SYS_fork);
@@ -54,8 +81,18 @@ sys_yield(void) {
 }
 
 int
-sys_kill(int pid) {
-    return syscall(SYS_kill, pid);
+sys_kill(int pid, int signum) {
+    return syscall(SYS_kill, pid, signum);
+}
+
+int
+sys_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact) {
+    return syscall(SYS_sigaction, signum, act, oldact);
+}
+
+int
+sys_sigprocmask(int how, const sigset_t *set, sigset_t *oldset) {
+    return syscall(SYS_sigprocmask, how, set, oldset);
 }
 
 int
@@ -63,6 +100,26 @@ sys_getpid(void) {
     return syscall(SYS_getpid);
 }
 
+int
+sys_mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags) {
+    return syscall(SYS_mmap, addr_store, len, mmap_flags);
+}
+
+int
+sys_munmap(uintptr_t addr, size_t len) {
+    return syscall(SYS_munmap, addr, len);
+}
+
+int
+sys_futex(volatile int *uaddr, int op, int val) {
+    return syscall(SYS_futex, uaddr, op, val);
+}
+
+int
+sys_sched_setscheduler(int pid, int policy, const struct sched_param *param) {
+    return syscall(SYS_sched_setscheduler, pid, policy, param);
+}
+
 int
 sys_putc(int c) {
     return syscall(SYS_putc, c);
@@ -84,16 +141,61 @@ sys_sleep(unsigned int time) {
     return syscall(SYS_sleep, time);
 }
 
+int
+sys_usleep(unsigned int usec) {
+    return syscall(SYS_usleep, usec);
+}
+
 size_t
 sys_gettime(void) {
     return syscall(SYS_gettime);
 }
 
+int
+sys_clock_gettime(int clockid, struct timespec *tp) {
+    return syscall(SYS_clock_gettime, clockid, tp);
+}
+
+int
+sys_uring_setup(struct uring *ring, uint32_t flags) {
+    return syscall(SYS_uring_setup, ring, flags);
+}
+
+int
+sys_uring_enter(uint32_t to_submit, uint32_t min_complete) {
+    return syscall(SYS_uring_enter, to_submit, min_complete);
+}
+
+int
+sys_memlimit(size_t limit) {
+    return syscall(SYS_memlimit, limit);
+}
+
+int
+sys_procinfo(int pid, struct procinfo *info) {
+    return syscall(SYS_procinfo, pid, info);
+}
+
+int
+sys_meminfo(struct meminfo *info) {
+    return syscall(SYS_meminfo, info);
+}
+
+int
+sys_systrace(int op, int arg, void *buf, size_t len) {
+    return syscall(SYS_systrace, op, arg, buf, len);
+}
+
 int
 sys_exec(const char *name, int argc, const char **argv) {
     return syscall(SYS_exec, name, argc, argv);
 }
 
+int
+sys_spawn(const char *name, int argc, const char **argv, const struct spawn_action *actions, int nactions) {
+    return syscall(SYS_spawn, name, argc, argv, actions, nactions);
+}
+
 int
 sys_open(const char *path, uint32_t open_flags) {
     return syscall(SYS_open, path, open_flags);
@@ -1,17 +1,55 @@
 #ifndef __USER_LIBS_SYSCALL_H__
 #define __USER_LIBS_SYSCALL_H__
 
+extern bool syscall_sysenter;
+
 int sys_exit(int error_code);
+int sys_exit_thread(int error_code);
 int sys_fork(void);
+int sys_clone(uint32_t clone_flags, uintptr_t stack, int (*fn)(void *), void *arg);
 int sys_wait(int pid, int *store);
 int sys_exec(const char *name, int argc, const char **argv);
+
+struct spawn_action;
+
+int sys_spawn(const char *name, int argc, const char **argv, const struct spawn_action *actions, int nactions);
 int sys_yield(void);
-int sys_kill(int pid);
+int sys_kill(int pid, int signum);
+
+struct sigaction;
+
+int sys_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact);
+int sys_sigprocmask(int how, const uint32_t *set, uint32_t *oldset);
 int sys_getpid(void);
+int sys_mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags);
+int sys_munmap(uintptr_t addr, size_t len);
+int sys_futex(volatile int *uaddr, int op, int val);
+
+struct sched_param;
+
+int sys_sched_setscheduler(int pid, int policy, const struct sched_param *param);
 int sys_putc(int c);
 int sys_pgdir(void);
 int sys_sleep(unsigned int time);
+int sys_usleep(unsigned int usec);
 size_t sys_gettime(void);
+int sys_memlimit(size_t limit);
+
+struct timespec;
+
+int sys_clock_gettime(int clockid, struct timespec *tp);
+
+struct uring;
+
+int sys_uring_setup(struct uring *ring, uint32_t flags);
+int sys_uring_enter(uint32_t to_submit, uint32_t min_complete);
+
+struct procinfo;
+struct meminfo;
+
+int sys_procinfo(int pid, struct procinfo *info);
+int sys_meminfo(struct meminfo *info);
+int sys_systrace(int op, int arg, void *buf, size_t len);
 
 struct stat;
 struct dirent;
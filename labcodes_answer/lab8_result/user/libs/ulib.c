@@ -5,6 +5,8 @@
 #include <stat.h>
 #include <string.h>
 #include <lock.h>
+#include <time.h>
+#include <signal.h>
 
 static lock_t fork_lock = INIT_LOCK;
 
@@ -25,11 +27,23 @@ exit(int error_code) {
     while (1);
 }
 
+void
+exit_thread(int error_code) {
+    sys_exit_thread(error_code);
+    cprintf("BUG: exit_thread failed.\n");
+    while (1);
+}
+
 int
 fork(void) {
     return sys_fork();
 }
 
+int
+clone(uint32_t clone_flags, uintptr_t stack, int (*fn)(void *), void *arg) {
+    return sys_clone(clone_flags, stack, fn, arg);
+}
+
 int
 wait(void) {
     return sys_wait(0, NULL);
@@ -45,9 +59,10 @@ yield(void) {
     sys_yield();
 }
 
+// kill - SIGKILL the process pid, sigsend sends the other signals
 int
 kill(int pid) {
-    return sys_kill(pid);
+    return sys_kill(pid, SIGKILL);
 }
 
 int
@@ -72,11 +87,72 @@ sleep(unsigned int time) {
     return sys_sleep(time);
 }
 
+// usleep - sleep usec microseconds, rounded up to the resolution of the kernel timers
+int
+usleep(unsigned int usec) {
+    return sys_usleep(usec);
+}
+
+// gettime_msec - the ticks of the scheduler since boot, despite the name
 unsigned int
 gettime_msec(void) {
     return (unsigned int)sys_gettime();
 }
 
+// clock_gettime - read the time page the kernel maps in every process, without a system call
+int
+clock_gettime(int clockid, struct timespec *tp) {
+    const struct timepage *page = (const struct timepage *)TIMEPAGE_VA;
+    if (page->mult == 0) {
+        return sys_clock_gettime(clockid, tp);
+    }
+    return timepage_gettime(page, rdtsc(), clockid, tp);
+}
+
+// procinfo - get the info of the process with the smallest pid >= pid, return its pid
+int
+procinfo(int pid, struct procinfo *info) {
+    return sys_procinfo(pid, info);
+}
+
+int
+meminfo(struct meminfo *info) {
+    return sys_meminfo(info);
+}
+
+// systrace - op: SYSTRACE_*, arg is a process id or a system call number, see systrace.h
+int
+systrace(int op, int arg, void *buf, size_t len) {
+    return sys_systrace(op, arg, buf, len);
+}
+
+// memlimit - limit the resident pages of the process (0 for no limit), return the old limit
+size_t
+memlimit(size_t limit) {
+    return sys_memlimit(limit);
+}
+
+int
+mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags) {
+    return sys_mmap(addr_store, len, mmap_flags);
+}
+
+int
+munmap(uintptr_t addr, size_t len) {
+    return sys_munmap(addr, len);
+}
+
+int
+futex(volatile int *uaddr, int op, int val) {
+    return sys_futex(uaddr, op, val);
+}
+
+// sched_setscheduler - set the scheduling policy of process pid, 0 for the caller
+int
+sched_setscheduler(int pid, int policy, const struct sched_param *param) {
+    return sys_sched_setscheduler(pid, policy, param);
+}
+
 int
 __exec(const char *name, const char **argv) {
     int argc = 0;
@@ -85,3 +161,12 @@ __exec(const char *name, const char **argv) {
     }
     return sys_exec(name, argc, argv);
 }
+
+int
+spawn(const char **argv, const struct spawn_action *actions, int nactions) {
+    int argc = 0;
+    while (argv[argc] != NULL) {
+        argc ++;
+    }
+    return sys_spawn(NULL, argc, argv, actions, nactions);
+}
@@ -26,7 +26,10 @@ void __noreturn __panic(const char *file, int line, const char *fmt, ...);
 int fprintf(int fd, const char *fmt, ...);
 
 void __noreturn exit(int error_code);
+void __noreturn exit_thread(int error_code);
 int fork(void);
+int vfork(void);
+int clone(uint32_t clone_flags, uintptr_t stack, int (*fn)(void *), void *arg);
 int wait(void);
 int waitpid(int pid, int *store);
 void yield(void);
@@ -34,9 +37,34 @@ int kill(int pid);
 int getpid(void);
 void print_pgdir(void);
 int sleep(unsigned int time);
+int usleep(unsigned int usec);
 unsigned int gettime_msec(void);
+size_t memlimit(size_t limit);
+int mmap(uintptr_t *addr_store, size_t len, uint32_t mmap_flags);
+int munmap(uintptr_t addr, size_t len);
+int futex(volatile int *uaddr, int op, int val);
+
+struct timespec;
+
+int clock_gettime(int clockid, struct timespec *tp);
+
+struct sched_param;
+
+int sched_setscheduler(int pid, int policy, const struct sched_param *param);
+
+struct procinfo;
+struct meminfo;
+
+int procinfo(int pid, struct procinfo *info);
+int meminfo(struct meminfo *info);
+int systrace(int op, int arg, void *buf, size_t len);
 int __exec(const char *name, const char **argv);
 
+struct spawn_action;
+
+// spawn - run argv[0] in a new child process after applying the file actions, return its pid
+int spawn(const char **argv, const struct spawn_action *actions, int nactions);
+
 #define __exec0(name, path, ...)                \
 ({ const char *argv[] = {path, ##__VA_ARGS__, NULL}; __exec(name, argv); })
 
@@ -7,7 +7,12 @@ int main(int argc, char *argv[]);
 
 static int
 initfd(int fd2, const char *path, uint32_t open_flags) {
+    struct stat __stat;
     int fd1, ret;
+    // keep an fd inherited across exec, e.g. redirected by sh
+    if (fstat(fd2, &__stat) == 0) {
+        return fd2;
+    }
     if ((fd1 = open(path, open_flags)) < 0) {
         return fd1;
     }
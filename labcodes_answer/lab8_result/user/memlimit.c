@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <error.h>
+#include <unistd.h>
+#include <file.h>
+#include <procinfo.h>
+
+#define PGSIZE          4096
+#define LIMIT           24
+
+// touch - fault in n pages of stack below the caller
+static int
+touch(int n) {
+    volatile char buf[64 * PGSIZE];
+    int i;
+    for (i = 1; i <= n; i ++) {
+        buf[sizeof(buf) - i * PGSIZE] = i;
+    }
+    return buf[sizeof(buf) - PGSIZE];
+}
+
+static struct procinfo info;
+
+// resident - the resident pages of this process
+static size_t
+resident(void) {
+    assert(procinfo(getpid(), &info) == getpid());
+    return info.rss;
+}
+
+// at_limit - fault in stack pages up to the limit, then let system calls
+//          - write to a page of it not touched yet: they fail, the process goes on
+static int
+at_limit(void) {
+    volatile char buf[64 * PGSIZE];
+    int i, fd;
+    assert((fd = open("memlimit", O_RDONLY)) >= 0);
+    for (i = 1; resident() < LIMIT; i ++) {
+        buf[sizeof(buf) - i * PGSIZE] = i;
+    }
+    assert(info.rss == LIMIT && i < 64);
+    assert(read(fd, (void *)buf, PGSIZE) == -E_INVAL);
+    assert(procinfo(getpid(), (struct procinfo *)buf) == -E_INVAL);
+    assert(resident() == LIMIT);
+    close(fd);
+    return 0;
+}
+
+static int
+run(int n) {
+    int pid, code;
+    if ((pid = fork()) == 0) {
+        assert(memlimit(LIMIT) == 0);
+        assert(memlimit(LIMIT) == LIMIT);
+        exit(touch(n));
+    }
+    assert(pid > 0);
+    assert(waitpid(pid, &code) == 0);
+    return code;
+}
+
+int
+main(void) {
+    assert(run(4) == 1);
+    cprintf("touch 4 pages under the limit ok.\n");
+    assert(run(64) == -E_KILLED);
+    cprintf("touch 64 pages over the limit killed.\n");
+    int pid, code;
+    if ((pid = fork()) == 0) {
+        assert(memlimit(LIMIT) == 0);
+        exit(at_limit());
+    }
+    assert(pid > 0 && waitpid(pid, &code) == 0 && code == 0);
+    cprintf("system calls over the limit fail.\n");
+    cprintf("memlimit pass.\n");
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <x86.h>
+#include <time.h>
+#include <syscall.h>
+
+#define ROUNDS          10000
+
+/* *
+ * nullsys - the latency of a null system call, getpid, through int $T_SYSCALL
+ * and through SYSENTER/SYSEXIT, in TSC cycles.
+ * */
+
+// run - the average cycles of a getpid
+static uint32_t
+run(void) {
+    uint64_t start, cycles;
+    int i, pid = getpid();
+    start = rdtsc();
+    for (i = 0; i < ROUNDS; i ++) {
+        assert(getpid() == pid);
+    }
+    cycles = rdtsc() - start;
+    do_div(cycles, ROUNDS);
+    return (uint32_t)cycles;
+}
+
+int
+main(void) {
+    uint32_t trap, fast;
+
+    syscall_sysenter = 0;
+    trap = run();
+    syscall_sysenter = 1;
+    fast = run();
+
+    if (((const struct timepage *)TIMEPAGE_VA)->sysenter == 0) {
+        cprintf("nullsys: no SYSENTER, int 0x80 only.\n");
+    }
+    cprintf("nullsys: int 0x80 %d cycles, sysenter %d cycles.\n", trap, fast);
+    cprintf("nullsys pass.\n");
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+/* *
+ * pmatrix [cpus] - C = A * B by 1, 2 and 4 threads, each one takes every
+ * nth row, and every element of C is checked. On a kernel built with make
+ * SMP=1 and run with CPUS=4 the threads run on different cpus; on one cpu
+ * the speedup stays near 1. Given the number of cpus, it also checks that
+ * n threads run at least min(n, cpus) / 2 times as fast as one.
+ * */
+
+#define N               128
+#define ROUNDS          4
+#define MAX_THREADS     4
+
+static int A[N][N], B[N][N], C[N][N];
+static int nthreads;
+
+void *
+worker(void *arg) {
+    int id = (int)arg, r, i, j, k;
+    for (r = 0; r < ROUNDS; r ++) {
+        for (i = id; i < N; i += nthreads) {
+            for (j = 0; j < N; j ++) {
+                int sum = 0;
+                for (k = 0; k < N; k ++) {
+                    sum += A[i][k] * B[k][j];
+                }
+                C[i][j] = sum;
+            }
+        }
+    }
+    return NULL;
+}
+
+// check - C[i][j] is the sum of (i + k) * (k - j) over k
+static void
+check(void) {
+    const int s1 = N * (N - 1) / 2, s2 = (N - 1) * N * (2 * N - 1) / 6;
+    int i, j;
+    for (i = 0; i < N; i ++) {
+        for (j = 0; j < N; j ++) {
+            assert(C[i][j] == i * s1 - N * i * j + s2 - j * s1);
+        }
+    }
+}
+
+// msecs - CLOCK_MONOTONIC in msecs, gettime_msec counts ticks
+static unsigned int
+msecs(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// run - multiply with n threads, return the time taken
+static unsigned int
+run(int n) {
+    pthread_t tids[MAX_THREADS];
+    unsigned int start;
+    int i;
+
+    memset(C, 0, sizeof(C));
+    nthreads = n;
+    start = msecs();
+    for (i = 0; i < n; i ++) {
+        assert(pthread_create(tids + i, NULL, worker, (void *)i) == 0);
+    }
+    for (i = 0; i < n; i ++) {
+        assert(pthread_join(tids[i], NULL) == 0);
+    }
+    return msecs() - start;
+}
+
+int
+main(int argc, char **argv) {
+    unsigned int base, time;
+    int i, j, n, cpus = (argc > 1) ? strtol(argv[1], NULL, 10) : 0;
+
+    for (i = 0; i < N; i ++) {
+        for (j = 0; j < N; j ++) {
+            A[i][j] = i + j;
+            B[i][j] = i - j;
+        }
+    }
+
+    base = 0;
+    for (n = 1; n <= MAX_THREADS; n *= 2) {
+        time = run(n);
+        check();
+        if (time == 0) {
+            time = 1;
+        }
+        if (n == 1) {
+            base = time;
+        }
+        cprintf("pmatrix: threads %d, %d msecs, speedup %d.%02d.\n",
+                n, time, base / time, base * 100 / time % 100);
+        if (cpus != 0) {
+            assert(base * 2 >= time * ((n < cpus) ? n : cpus));
+        }
+    }
+
+    cprintf("pmatrix pass.\n");
+    return 0;
+}
+
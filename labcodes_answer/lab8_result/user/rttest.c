@@ -0,0 +1,160 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <error.h>
+#include <pthread.h>
+#include <sched_param.h>
+#include <procinfo.h>
+
+#define SPIN_TIME       300
+#define SLEEP_ROUNDS    10
+
+static volatile int spins, done;
+static volatile int rr_count[2];
+
+static void
+spin_until(unsigned int end) {
+    while (gettime_msec() < end) {
+        /* do nothing */;
+    }
+}
+
+// fifo_worker - the normal main thread does not run while a FIFO thread spins
+void *
+fifo_worker(void *arg) {
+    struct sched_param param = {10};
+    assert(sched_setscheduler(0, SCHED_FIFO, &param) == 0);
+    int before = spins;
+    spin_until(gettime_msec() + SPIN_TIME / 3);
+    int after = spins;
+    done = 1;
+    return (void *)(after - before);
+}
+
+// sleep_worker - a woken FIFO thread runs at once, not when the spinning main thread's slice ends
+void *
+sleep_worker(void *arg) {
+    struct sched_param param = {10};
+    assert(sched_setscheduler(0, SCHED_FIFO, &param) == 0);
+    int i, late = 0;
+    for (i = 0; i < SLEEP_ROUNDS; i ++) {
+        unsigned int start = gettime_msec();
+        sleep(2);
+        // 2 ticks, and one more when the tick came between gettime and sleep
+        if (gettime_msec() - start > 30) {
+            late ++;
+        }
+    }
+    done = 1;
+    return (void *)late;
+}
+
+// rr_worker - two RR threads of the same priority take turns
+void *
+rr_worker(void *arg) {
+    int id = (int)arg, other = rr_count[!id], turns = 0;
+    unsigned int end = gettime_msec() + SPIN_TIME;
+    while (gettime_msec() < end) {
+        rr_count[id] ++;
+        if (rr_count[!id] != other) {
+            other = rr_count[!id];
+            turns ++;
+        }
+    }
+    return (void *)turns;
+}
+
+// edf_worker - a reservation of 2 ticks in each 10 keeps the thread to about a fifth of the CPU
+void *
+edf_worker(void *arg) {
+    struct sched_param param = {0, 2, 10};
+    assert(sched_setscheduler(0, SCHED_DEADLINE, &param) == 0);
+    unsigned int now, last = 0, end = gettime_msec() + SPIN_TIME;
+    int seen = 0, before = spins;
+    while ((now = gettime_msec()) < end) {
+        if (now != last) {
+            last = now;
+            seen ++;
+        }
+    }
+    // and the normal main thread gets the rest
+    assert(spins != before);
+    done = 1;
+    return (void *)seen;
+}
+
+static int
+run_with_spinner(void *(*worker)(void *)) {
+    pthread_t tid;
+    void *ret;
+    spins = done = 0;
+    assert(pthread_create(&tid, NULL, worker, NULL) == 0);
+    while (!done) {
+        spins ++;
+    }
+    assert(pthread_join(tid, &ret) == 0);
+    return (int)ret;
+}
+
+int
+main(void) {
+    struct sched_param param = {0};
+    struct procinfo pi;
+    int ret, pid;
+
+    assert(sched_setscheduler(0, SCHED_FIFO, &param) == -E_INVAL);
+    param.sched_priority = SCHED_PRIO_MAX;
+    assert(sched_setscheduler(0, SCHED_RR, &param) == -E_INVAL);
+    param.sched_runtime = 10, param.sched_period = 5;
+    assert(sched_setscheduler(0, SCHED_DEADLINE, &param) == -E_INVAL);
+    param.sched_runtime = 10, param.sched_period = 10;
+    assert(sched_setscheduler(0, SCHED_DEADLINE, &param) == -E_BUSY);
+    assert(sched_setscheduler(0, 3, &param) == -E_INVAL);
+
+    // a zombie gave its reservation back when it exited, and init is not ours to change
+    if ((pid = fork()) == 0) {
+        exit(0);
+    }
+    assert(pid > 0);
+    while (procinfo(pid, &pi) == pid && pi.state != PROC_STATE_ZOMBIE) {
+        yield();
+    }
+    param.sched_runtime = 1, param.sched_period = 10;
+    assert(sched_setscheduler(pid, SCHED_DEADLINE, &param) == -E_INVAL);
+    assert(waitpid(pid, NULL) == 0);
+    assert(sched_setscheduler(1, SCHED_DEADLINE, &param) == -E_INVAL);
+
+    ret = run_with_spinner(fifo_worker);
+    assert(ret == 0);
+    cprintf("rttest: fifo ok.\n");
+
+    ret = run_with_spinner(sleep_worker);
+    assert(ret == 0);
+    cprintf("rttest: wakeup preemption ok.\n");
+
+    // main runs above the two RR threads until it waits for them
+    pthread_t tids[2];
+    void *turns[2];
+    int i;
+    param.sched_priority = 6;
+    assert(sched_setscheduler(0, SCHED_RR, &param) == 0);
+    param.sched_priority = 5;
+    for (i = 0; i < 2; i ++) {
+        assert(pthread_create(tids + i, NULL, rr_worker, (void *)i) == 0);
+        assert(sched_setscheduler(tids[i], SCHED_RR, &param) == 0);
+    }
+    for (i = 0; i < 2; i ++) {
+        assert(pthread_join(tids[i], turns + i) == 0);
+    }
+    assert(sched_setscheduler(0, SCHED_NORMAL, NULL) == 0);
+    assert((int)turns[0] >= 2 && (int)turns[1] >= 2);
+    cprintf("rttest: rr ok.\n");
+
+    ret = run_with_spinner(edf_worker);
+    cprintf("rttest: edf thread ran in %d of %d ticks.\n", ret, SPIN_TIME / 10);
+    assert(ret > 0 && ret <= SPIN_TIME / 10 / 2);
+    cprintf("rttest: edf ok.\n");
+
+    cprintf("rttest pass.\n");
+    return 0;
+}
+
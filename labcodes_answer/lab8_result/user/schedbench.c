@@ -0,0 +1,87 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <time.h>
+
+#define NSPIN           3
+#define RUN_TIME        1000        // msecs the cpu-bound processes spin
+#define NSLEEPS         50
+#define SLEEP_MSEC      10
+
+/* *
+ * A mixed workload for comparing scheduler classes (make SCHED=...):
+ * NSPIN cpu-bound processes with priorities 1..NSPIN, and an interactive
+ * one that sleeps SLEEP_MSEC at a time. Fairness is the work of each
+ * spinner relative to the first one, ideally equal to its priority;
+ * latency is how late the interactive process runs after its sleep ends.
+ * The times are in msecs of CLOCK_MONOTONIC, gettime_msec counts ticks.
+ * */
+
+static unsigned int
+msecs(void) {
+    struct timespec ts;
+    assert(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void
+spin(int prio) {
+    unsigned int end = msecs() + RUN_TIME;
+    int acc = 0;
+    volatile int j;
+    lab6_set_priority(prio);
+    while (1) {
+        for (j = 0; j < 200; j ++) {
+        }
+        if (++ acc % 4000 == 0 && msecs() >= end) {
+            exit(acc);
+        }
+    }
+}
+
+static void
+interactive(void) {
+    unsigned int i, begin, elapsed, late, total = 0, max = 0;
+    for (i = 0; i < NSLEEPS; i ++) {
+        begin = msecs();
+        usleep(SLEEP_MSEC * 1000);
+        // the timer counts from the last tick, the sleep may end a little early
+        elapsed = msecs() - begin;
+        late = (elapsed > SLEEP_MSEC) ? elapsed - SLEEP_MSEC : 0;
+        total += late;
+        if (late > max) {
+            max = late;
+        }
+    }
+    cprintf("interactive: wakeup latency avg %d msecs, max %d msecs.\n", total / NSLEEPS, max);
+    exit(0);
+}
+
+int
+main(void) {
+    int pids[NSPIN], acc[NSPIN], i, pid, code;
+
+    lab6_set_priority(NSPIN + 1);
+    for (i = 0; i < NSPIN; i ++) {
+        if ((pids[i] = fork()) == 0) {
+            spin(i + 1);
+        }
+        assert(pids[i] > 0);
+    }
+    if ((pid = fork()) == 0) {
+        interactive();
+    }
+    assert(pid > 0);
+
+    for (i = 0; i < NSPIN; i ++) {
+        assert(waitpid(pids[i], &acc[i]) == 0 && acc[i] >= 100);
+    }
+    assert(waitpid(pid, &code) == 0 && code == 0);
+
+    cprintf("fairness (work / work of priority 1, x100):");
+    for (i = 0; i < NSPIN; i ++) {
+        cprintf(" %d", acc[i] / (acc[0] / 100));
+    }
+    cprintf("\n");
+    cprintf("schedbench pass.\n");
+    return 0;
+}
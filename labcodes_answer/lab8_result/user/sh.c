@@ -5,6 +5,7 @@
 #include <file.h>
 #include <error.h>
 #include <unistd.h>
+#include <spawn.h>
 
 #define printf(...)                     fprintf(1, __VA_ARGS__)
 #define putc(c)                         printf("%c", c)
@@ -214,6 +215,72 @@ runit:
     return __exec(NULL, argv);
 }
 
+// spawncmd - run a simple command (no '|' or ';') with spawn, without forking the shell
+int
+spawncmd(char *cmd) {
+    static char argv0[BUFSIZE];
+    const char *argv[EXEC_MAX_ARG_NUM + 1];
+    struct spawn_action actions[SPAWN_MAX_ACTIONS];
+    char *t;
+    int argc = 0, nactions = 0, token, ret, pid;
+    while ((token = gettoken(&cmd, &t)) != 0) {
+        switch (token) {
+        case 'w':
+            if (argc == EXEC_MAX_ARG_NUM) {
+                printf("sh error: too many arguments\n");
+                return -1;
+            }
+            argv[argc ++] = t;
+            break;
+        case '<':
+        case '>':
+            if (gettoken(&cmd, &t) != 'w') {
+                printf("sh error: syntax error: %c not followed by word\n", token);
+                return -1;
+            }
+            if (nactions == SPAWN_MAX_ACTIONS) {
+                printf("sh error: too many redirections\n");
+                return -1;
+            }
+            actions[nactions].op = SPAWN_OPEN;
+            actions[nactions].fd = (token == '<') ? 0 : 1;
+            actions[nactions].open_flags = (token == '<') ? O_RDONLY : (O_RDWR | O_TRUNC | O_CREAT);
+            actions[nactions].path = t;
+            nactions ++;
+            break;
+        default:
+            printf("sh error: bad return %d from gettoken\n", token);
+            return -1;
+        }
+    }
+
+    if (argc == 0) {
+        return 0;
+    }
+    else if (strcmp(argv[0], "cd") == 0) {
+        if (argc != 2) {
+            return -1;
+        }
+        strcpy(shcwd, argv[1]);
+        return 0;
+    }
+    if ((ret = testfile(argv[0])) != 0) {
+        if (ret != -E_NOENT) {
+            return ret;
+        }
+        snprintf(argv0, sizeof(argv0), "/%s", argv[0]);
+        argv[0] = argv0;
+    }
+    argv[argc] = NULL;
+    if ((pid = spawn(argv, actions, nactions)) < 0) {
+        return pid;
+    }
+    if (waitpid(pid, &ret) != 0) {
+        return 0;
+    }
+    return ret;
+}
+
 int
 main(int argc, char **argv) {
     printf("user sh is running!!!");
@@ -234,20 +301,26 @@ main(int argc, char **argv) {
     char *buffer;
     while ((buffer = readline((interactive) ? "$ " : NULL)) != NULL) {
         shcwd[0] = '\0';
-        int pid;
-        if ((pid = fork()) == 0) {
-            ret = runcmd(buffer);
-            exit(ret);
+        if (strchr(buffer, '|') == NULL && strchr(buffer, ';') == NULL) {
+            ret = spawncmd(buffer);
         }
-        assert(pid >= 0);
-        if (waitpid(pid, &ret) == 0) {
-            if (ret == 0 && shcwd[0] != '\0') {
-                ret = 0;
+        else {
+            int pid;
+            if ((pid = fork()) == 0) {
+                ret = runcmd(buffer);
+                exit(ret);
             }
-            if (ret != 0) {
-                printf("error: %d - %e\n", ret, ret);
+            assert(pid >= 0);
+            if (waitpid(pid, &ret) != 0) {
+                continue;
             }
         }
+        if (ret == 0 && shcwd[0] != '\0') {
+            ret = 0;
+        }
+        if (ret != 0) {
+            printf("error: %d - %e\n", ret, ret);
+        }
     }
     return 0;
 }
@@ -0,0 +1,166 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <error.h>
+#include <signal.h>
+#include <procinfo.h>
+
+/* *
+ * sigtest - handlers, masks and sigreturn on signals sent by the process
+ * itself and by others, sleeps cut short with -E_INTR, SIGCHLD, the
+ * default action, and signal-ex1 stopped with SIGINT.
+ * */
+
+static volatile int caught, last;
+
+static void
+handler(int signum) {
+    caught ++;
+    last = signum;
+}
+
+static void
+reset(void) {
+    caught = last = 0;
+}
+
+static bool
+is_zombie(int pid) {
+    struct procinfo pi;
+    return procinfo(pid, &pi) != pid || pi.state == PROC_STATE_ZOMBIE;
+}
+
+// self - the handler runs before raise returns, and raise still returns 0
+static void
+self(void) {
+    struct sigaction act, oldact;
+    sigset_t set, oldset;
+
+    reset();
+    assert(signal(SIGUSR1, handler) == SIG_DFL);
+    assert(raise(SIGUSR1) == 0 && caught == 1 && last == SIGUSR1);
+
+    // blocked, it waits for sigprocmask to unblock it
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    assert(sigprocmask(SIG_BLOCK, &set, &oldset) == 0 && oldset == 0);
+    assert(raise(SIGUSR1) == 0 && raise(SIGUSR1) == 0 && caught == 1);
+    assert(sigprocmask(SIG_UNBLOCK, &set, &oldset) == 0 && sigismember(&oldset, SIGUSR1));
+    assert(caught == 2);
+
+    // ignored, it is dropped
+    assert(signal(SIGUSR2, SIG_IGN) == SIG_DFL);
+    assert(raise(SIGUSR2) == 0 && caught == 2);
+    assert(signal(SIGUSR2, SIG_DFL) == SIG_IGN);
+
+    // SA_RESETHAND puts SIG_DFL back when the handler is called
+    act.sa_handler = handler;
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_RESETHAND;
+    assert(sigaction(SIGUSR1, &act, &oldact) == 0 && oldact.sa_handler == handler);
+    assert(raise(SIGUSR1) == 0 && caught == 3);
+    assert(sigaction(SIGUSR1, NULL, &oldact) == 0 && oldact.sa_handler == SIG_DFL);
+
+    // SIGKILL can not be caught or blocked
+    assert(signal(SIGKILL, handler) == SIG_ERR);
+    sigfillset(&set);
+    assert(sigprocmask(SIG_SETMASK, &set, NULL) == 0);
+    assert(sigprocmask(SIG_SETMASK, NULL, &oldset) == 0 && !sigismember(&oldset, SIGKILL));
+    sigemptyset(&set);
+    assert(sigprocmask(SIG_SETMASK, &set, NULL) == 0);
+
+    assert(raise(0) == 0 && raise(NSIG) == -E_INVAL && sigsend(-1, SIGUSR1) == -E_INVAL);
+    cprintf("sigtest: handlers and masks ok.\n");
+}
+
+// interrupt - a child wakes the sleeping parent up with SIGUSR1
+static void
+interrupt(void) {
+    int pid, ppid = getpid(), code;
+
+    reset();
+    assert(signal(SIGUSR1, handler) == SIG_DFL);
+    // a signal taken before the parent sleeps does not wake it, so it comes again until the child is killed
+    if ((pid = fork()) == 0) {
+        while (1) {
+            assert(sigsend(ppid, SIGUSR1) == 0);
+            sleep(10);
+        }
+    }
+    assert(pid > 0);
+    assert(sleep(~0) == -E_INTR && caught >= 1 && last == SIGUSR1);
+    assert(kill(pid) == 0);
+    assert(waitpid(pid, &code) == 0 && code == -E_KILLED);
+    assert(signal(SIGUSR1, SIG_DFL) == handler);
+    cprintf("sigtest: sleep interrupted ok.\n");
+}
+
+// async - the handler cuts into user code at any instruction, which goes on as if it had not
+static void
+async(void) {
+    int pid, code;
+
+    // the child has the handler from its fork on, whenever the signal comes
+    reset();
+    assert(signal(SIGUSR1, handler) == SIG_DFL);
+    if ((pid = fork()) == 0) {
+        uint32_t i = 0, sum = 0;
+        while (!caught) {
+            i ++, sum += 3;
+        }
+        exit((sum == i * 3) ? 0 : -1);
+    }
+    assert(pid > 0);
+    assert(signal(SIGUSR1, SIG_DFL) == handler);
+    assert(sigsend(pid, SIGUSR1) == 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    cprintf("sigtest: asynchronous handler ok.\n");
+}
+
+// child - SIGCHLD is taken by a handler, SIGTERM ends a child, SIGINT ends signal-ex1 through its handler
+static void
+child(void) {
+    int pid, code;
+
+    reset();
+    assert(signal(SIGCHLD, handler) == SIG_DFL);
+    if ((pid = fork()) == 0) {
+        exit(0);
+    }
+    assert(pid > 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    assert(caught == 1 && last == SIGCHLD);
+    assert(signal(SIGCHLD, SIG_DFL) == handler);
+
+    if ((pid = fork()) == 0) {
+        sleep(~0);
+        exit(0xdead);
+    }
+    assert(pid > 0);
+    assert(sigsend(pid, SIGTERM) == 0);
+    assert(waitpid(pid, &code) == 0 && code == -E_KILLED);
+
+    // SIGINT stays ignored through the exec until signal-ex1 sets its handler,
+    // and is sent again until that handler ends it
+    if ((pid = fork()) == 0) {
+        assert(signal(SIGINT, SIG_IGN) == SIG_DFL);
+        exec("signal-ex1");
+        exit(-1);
+    }
+    assert(pid > 0);
+    while (!is_zombie(pid)) {
+        sigsend(pid, SIGINT);
+        sleep(10);
+    }
+    assert(waitpid(pid, &code) == 0 && code == SIGINT);
+    cprintf("sigtest: children ok.\n");
+}
+
+int
+main(void) {
+    self();
+    interrupt();
+    async();
+    child();
+    cprintf("sigtest pass.\n");
+    return 0;
+}
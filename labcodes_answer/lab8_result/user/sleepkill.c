@@ -1,9 +1,10 @@
 #include <stdio.h>
 #include <ulib.h>
+#include <error.h>
 
 int
 main(void) {
-    int pid;
+    int pid, code;
     if ((pid = fork()) == 0) {
         sleep(~0);
         exit(0xdead);
@@ -12,6 +13,8 @@ main(void) {
 
     sleep(100);
     assert(kill(pid) == 0);
+    // the child was still asleep, sleep(~0) must not time out at once
+    assert(waitpid(pid, &code) == 0 && code == -E_KILLED);
     cprintf("sleepkill pass.\n");
     return 0;
 }
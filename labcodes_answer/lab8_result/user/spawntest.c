@@ -0,0 +1,31 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <spawn.h>
+
+int
+main(void) {
+    int pid, code;
+
+    // the child runs on our stack until it execs, then we go on
+    if ((pid = vfork()) == 0) {
+        exec("hello");
+        exit(-1);
+    }
+    assert(pid > 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    cprintf("vfork ok.\n");
+
+    const char *argv[] = {"hello", NULL};
+    assert((pid = spawn(argv, NULL, 0)) > 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    cprintf("spawn ok.\n");
+
+    const char *bad_argv[] = {"no_such_program", NULL};
+    assert(spawn(bad_argv, NULL, 0) < 0);
+    // this one opens, load_icode fails once the borrowed mm is dropped
+    const char *dir_argv[] = {".", NULL};
+    assert(spawn(dir_argv, NULL, 0) < 0);
+    cprintf("spawntest pass.\n");
+    return 0;
+}
+
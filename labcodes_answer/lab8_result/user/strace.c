@@ -0,0 +1,205 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <error.h>
+#include <x86.h>
+#include <procinfo.h>
+#include <systrace.h>
+
+#define printf(...)                     fprintf(1, __VA_ARGS__)
+#define NCALLS                          32      // fits in the ring of the child
+
+/* *
+ * strace [program [args...]] - run program with its system calls logged,
+ * print them as they come, and the calls and the latency histogram of each
+ * system call made meanwhile. Without a program, check the counters and
+ * the log with a child that calls getpid NCALLS times.
+ * */
+
+static const char *names[SYSTRACE_NSYSCALLS] = {
+    [SYS_exit]              "exit",
+    [SYS_fork]              "fork",
+    [SYS_wait]              "wait",
+    [SYS_exec]              "exec",
+    [SYS_clone]             "clone",
+    [SYS_vfork]             "vfork",
+    [SYS_spawn]             "spawn",
+    [SYS_exit_thread]       "exit_thread",
+    [SYS_yield]             "yield",
+    [SYS_sleep]             "sleep",
+    [SYS_kill]              "kill",
+    [SYS_sigaction]         "sigaction",
+    [SYS_sigprocmask]       "sigprocmask",
+    [SYS_sigreturn]         "sigreturn",
+    [SYS_gettime]           "gettime",
+    [SYS_getpid]            "getpid",
+    [SYS_mmap]              "mmap",
+    [SYS_munmap]            "munmap",
+    [SYS_shmem]             "shmem",
+    [SYS_memlimit]          "memlimit",
+    [SYS_futex]             "futex",
+    [SYS_sched_setscheduler] "sched_setscheduler",
+    [SYS_usleep]            "usleep",
+    [SYS_clock_gettime]     "clock_gettime",
+    [SYS_uring_setup]       "uring_setup",
+    [SYS_uring_enter]       "uring_enter",
+    [SYS_putc]              "putc",
+    [SYS_pgdir]             "pgdir",
+    [SYS_procinfo]          "procinfo",
+    [SYS_meminfo]           "meminfo",
+    [SYS_systrace]          "systrace",
+    [SYS_open]              "open",
+    [SYS_close]             "close",
+    [SYS_read]              "read",
+    [SYS_write]             "write",
+    [SYS_seek]              "seek",
+    [SYS_fstat]             "fstat",
+    [SYS_fsync]             "fsync",
+    [SYS_getcwd]            "getcwd",
+    [SYS_getdirentry]       "getdirentry",
+    [SYS_dup]               "dup",
+    [SYS_lab6_set_priority] "lab6_set_priority",
+};
+
+static struct systrace_entry entries[SYSTRACE_RING];
+
+static void
+print_name(int num) {
+    if (num >= 0 && num < SYSTRACE_NSYSCALLS && names[num] != NULL) {
+        printf("%s", names[num]);
+    }
+    else {
+        printf("syscall_%d", num);
+    }
+}
+
+// drain - print the entries logged for pid since the last call, *seq is the next one expected
+static void
+drain(int pid, uint32_t *seq) {
+    int i, n;
+    do {
+        if ((n = systrace(SYSTRACE_READ, pid, entries, SYSTRACE_RING)) <= 0) {
+            break;
+        }
+        for (i = 0; i < n; i ++) {
+            struct systrace_entry *e = entries + i;
+            if (e->seq != *seq) {
+                printf("%d: ... %d calls lost\n", pid, e->seq - *seq);
+            }
+            *seq = e->seq + 1;
+            printf("%d: ", pid);
+            print_name(e->num);
+            printf("(0x%x, 0x%x, 0x%x) = %d <%d cycles>\n", e->arg[0], e->arg[1], e->arg[2], e->ret, e->cycles);
+        }
+    } while (n == SYSTRACE_RING);
+}
+
+static bool
+is_zombie(int pid) {
+    struct procinfo pi;
+    return procinfo(pid, &pi) != pid || pi.state == PROC_STATE_ZOMBIE;
+}
+
+static void
+show_stats(void) {
+    struct systrace_stat st;
+    int i, num = 0;
+    printf("syscall               calls  cycles/call  latency histogram, log2(cycles):calls\n");
+    while ((num = systrace(SYSTRACE_STAT, num, &st, 0)) >= 0) {
+        uint64_t avg = st.cycles;
+        do_div(avg, st.calls);
+        printf("%-20s %6d %12d ", (names[num] != NULL) ? names[num] : "?", st.calls, (uint32_t)avg);
+        for (i = 0; i < SYSTRACE_BUCKETS; i ++) {
+            if (st.hist[i] != 0) {
+                printf(" %s%d:%d", (i == 0) ? "<" : (i == SYSTRACE_BUCKETS - 1) ? ">=" : "",
+                       SYSTRACE_SHIFT + i - (i != 0), st.hist[i]);
+            }
+        }
+        printf("\n");
+        num ++;
+    }
+}
+
+// trace - run argv in a child and print its calls as they come
+static int
+trace(const char **argv) {
+    uint32_t seq = 0;
+    int pid, code;
+    if ((pid = fork()) == 0) {
+        assert(systrace(SYSTRACE_TRACE, 0, NULL, 0) == 0);
+        __exec(NULL, argv);
+        exit(-1);
+    }
+    assert(pid > 0);
+    while (!is_zombie(pid)) {
+        drain(pid, &seq);
+        sleep(1);
+    }
+    drain(pid, &seq);
+    assert(waitpid(pid, &code) == 0);
+    printf("%d: exited with %d\n", pid, code);
+    return code;
+}
+
+// check - a child calls getpid NCALLS times, all of them must be logged and counted
+static void
+check(void) {
+    struct systrace_stat st;
+    struct procinfo pi;
+    uint32_t sum;
+    int i, n, pid, code;
+
+    if ((pid = fork()) == 0) {
+        assert(systrace(SYSTRACE_TRACE, 0, NULL, 0) == 0);
+        for (i = 0; i < NCALLS; i ++) {
+            getpid();
+        }
+        exit(0);
+    }
+    assert(pid > 0);
+    while (!is_zombie(pid)) {
+        yield();
+    }
+
+    // init is no descendant
+    assert(systrace(SYSTRACE_TRACE, 1, NULL, 0) == -E_BAD_PROC);
+    assert(systrace(SYSTRACE_READ, 1, entries, SYSTRACE_RING) == -E_BAD_PROC);
+    assert(systrace(SYSTRACE_UNTRACE, 1, NULL, 0) == -E_BAD_PROC);
+
+    // the ring of a zombie can be read until it is reaped
+    assert(procinfo(pid, &pi) == pid && pi.syscalls >= NCALLS + 1);
+    n = systrace(SYSTRACE_READ, pid, entries, SYSTRACE_RING);
+    assert(n == NCALLS + 1 && systrace(SYSTRACE_READ, pid, entries, SYSTRACE_RING) == 0);
+    assert(entries[0].num == SYS_systrace && entries[0].arg[0] == SYSTRACE_TRACE && entries[0].ret == 0);
+    for (i = 1; i < n; i ++) {
+        assert(entries[i].seq == i && entries[i].num == SYS_getpid && entries[i].ret == pid);
+    }
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    assert(systrace(SYSTRACE_READ, pid, entries, SYSTRACE_RING) == -E_BAD_PROC);
+
+    assert(systrace(SYSTRACE_STAT, SYS_getpid, &st, 0) == SYS_getpid && st.calls >= NCALLS);
+    for (i = 0, sum = 0; i < SYSTRACE_BUCKETS; i ++) {
+        sum += st.hist[i];
+    }
+    assert(sum == st.calls && st.cycles != 0);
+}
+
+int
+main(int argc, const char **argv) {
+    int ret = 0;
+    assert(systrace(SYSTRACE_ON, 0, NULL, 0) == 0);
+    if (argc > 1) {
+        ret = trace(argv + 1);
+    }
+    else {
+        check();
+    }
+    assert(systrace(SYSTRACE_OFF, 0, NULL, 0) == 0);
+    show_stats();
+    if (argc == 1) {
+        printf("strace pass.\n");
+    }
+    return ret;
+}
+
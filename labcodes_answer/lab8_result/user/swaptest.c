@@ -0,0 +1,53 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <procinfo.h>
+
+#define PGSIZE          4096
+#define EXTRA           256                     // pages mapped over the free memory
+
+// pattern - the word written to page i
+static uint32_t
+pattern(size_t i) {
+    return i * 2654435761U;
+}
+
+int
+main(void) {
+    struct meminfo before, after;
+    struct procinfo info;
+    uintptr_t addr = 0;
+    size_t i, n;
+
+    assert(meminfo(&before) == 0);
+    n = before.free_pages + EXTRA;
+    assert(mmap(&addr, n * PGSIZE, MMAP_WRITE) == 0 && addr != 0);
+
+    // the first pages written are the first ones swapped out to make room for the rest
+    volatile uint32_t *mem = (uint32_t *)addr;
+    for (i = 0; i < n; i ++) {
+        mem[i * (PGSIZE / sizeof(uint32_t))] = pattern(i);
+    }
+    for (i = 0; i < EXTRA; i ++) {
+        assert(mem[i * (PGSIZE / sizeof(uint32_t))] == pattern(i));
+    }
+    assert(mem[(n - 1) * (PGSIZE / sizeof(uint32_t))] == pattern(n - 1));
+
+    // the pages read back were major faults, the ones they pushed out are swapped now;
+    // info is written first, so procinfo does not fault it in
+    memset(&info, 0, sizeof(info));
+    assert(procinfo(getpid(), &info) == getpid());
+    assert(info.swap != 0 && info.majflt != 0);
+
+    // give the memory back before the other system calls, they may not fault pages in at no free memory
+    assert(munmap(addr, n * PGSIZE) == 0);
+    cprintf("wrote and read back %d pages over %d free.\n", n, before.free_pages);
+
+    assert(meminfo(&after) == 0);
+    assert(after.zram_hits + after.zram_misses > before.zram_hits + before.zram_misses);
+    cprintf("overcommitted pages swapped in ok.\n");
+    cprintf("swap %d pages, %d major faults.\n", info.swap, info.majflt);
+    cprintf("swaptest pass.\n");
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define ROUNDS          20000
+
+/* *
+ * Two tasks yield to each other ROUNDS times. Threads of one process share
+ * the page directory, so switching between them does not reload cr3 nor
+ * flush the TLB; two processes pay for both on every switch.
+ * */
+
+static void
+ping(void) {
+    int i;
+    for (i = 0; i < ROUNDS; i ++) {
+        yield();
+    }
+}
+
+static void *
+thread_ping(void *arg) {
+    ping();
+    return NULL;
+}
+
+static unsigned int
+bench_threads(void) {
+    pthread_t tid;
+    unsigned int begin = gettime_msec();
+    assert(pthread_create(&tid, NULL, thread_ping, NULL) == 0);
+    ping();
+    assert(pthread_join(tid, NULL) == 0);
+    return gettime_msec() - begin;
+}
+
+static unsigned int
+bench_procs(void) {
+    int pid, code;
+    unsigned int begin = gettime_msec();
+    if ((pid = fork()) == 0) {
+        ping();
+        exit(0);
+    }
+    assert(pid > 0);
+    ping();
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    return gettime_msec() - begin;
+}
+
+int
+main(void) {
+    unsigned int threads = bench_threads();
+    unsigned int procs = bench_procs();
+    cprintf("switchbench: %d yields each side.\n", ROUNDS);
+    cprintf("threads (same mm):      %d msecs.\n", threads);
+    cprintf("processes (own mm):     %d msecs.\n", procs);
+    cprintf("switchbench pass.\n");
+    return 0;
+}
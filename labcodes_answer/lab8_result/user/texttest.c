@@ -0,0 +1,41 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <procinfo.h>
+
+static void
+run_hello(void) {
+    const char *argv[] = {"hello", NULL};
+    int pid, code;
+    assert((pid = spawn(argv, NULL, 0)) > 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+}
+
+int
+main(void) {
+    struct meminfo before, after;
+    struct procinfo pi;
+    int pid, code;
+
+    // the first run reads the text of hello into the cache, the second maps it
+    run_hello();
+    assert(meminfo(&before) == 0);
+    run_hello();
+    assert(meminfo(&after) == 0);
+    cprintf("text cache: %d pages, %d hits, %d misses.\n",
+            after.text_cached_pages, after.text_hits, after.text_misses);
+    assert(after.text_cached_pages != 0);
+    assert(after.text_hits > before.text_hits);
+    assert(after.text_misses == before.text_misses);
+    cprintf("exec shares text ok.\n");
+
+    // fork shares the text of texttest instead of copying it
+    if ((pid = fork()) == 0) {
+        assert(procinfo(getpid(), &pi) == getpid());
+        exit((pi.copies < pi.rss) ? 0 : -1);
+    }
+    assert(pid > 0);
+    assert(waitpid(pid, &code) == 0 && code == 0);
+    cprintf("fork shares text ok.\n");
+    cprintf("texttest pass.\n");
+    return 0;
+}
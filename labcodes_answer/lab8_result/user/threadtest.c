@@ -0,0 +1,58 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <pthread.h>
+
+#define NTHREADS        4
+#define NLOOPS          1000
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static volatile int counter = 0, started = 0;
+
+void *
+worker(void *arg) {
+    int i, id = (int)arg;
+
+    pthread_mutex_lock(&mutex);
+    started ++;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+
+    for (i = 0; i < NLOOPS; i ++) {
+        pthread_mutex_lock(&mutex);
+        counter ++;
+        pthread_mutex_unlock(&mutex);
+        if (i % 100 == 0) {
+            yield();
+        }
+    }
+    return (void *)(id * 10);
+}
+
+int
+main(void) {
+    pthread_t tids[NTHREADS];
+    int i;
+
+    for (i = 0; i < NTHREADS; i ++) {
+        assert(pthread_create(tids + i, NULL, worker, (void *)i) == 0);
+    }
+
+    pthread_mutex_lock(&mutex);
+    while (started != NTHREADS) {
+        pthread_cond_wait(&cond, &mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+    cprintf("all %d threads started.\n", NTHREADS);
+
+    for (i = 0; i < NTHREADS; i ++) {
+        void *ret;
+        assert(pthread_join(tids[i], &ret) == 0);
+        assert((int)ret == i * 10);
+    }
+    cprintf("counter = %d.\n", counter);
+    assert(counter == NTHREADS * NLOOPS);
+    cprintf("threadtest pass.\n");
+    return 0;
+}
+
@@ -0,0 +1,76 @@
+#include <ulib.h>
+#include <stdio.h>
+#include <string.h>
+#include <procinfo.h>
+
+#define printf(...)                     fprintf(1, __VA_ARGS__)
+#define PGSIZE_KB                       4
+#define INTERVAL                        100
+
+static char
+statechar(struct procinfo *pi) {
+    switch (pi->state) {
+    case PROC_STATE_UNINIT:     return 'U';
+    case PROC_STATE_SLEEPING:   return 'S';
+    case PROC_STATE_RUNNABLE:   return 'R';
+    case PROC_STATE_ZOMBIE:     return 'Z';
+    }
+    return '?';
+}
+
+static void
+show_meminfo(void) {
+    struct meminfo mi;
+    if (meminfo(&mi) != 0) {
+        return;
+    }
+    printf("Mem:  %8dK total, %8dK free\n", mi.total_pages * PGSIZE_KB, mi.free_pages * PGSIZE_KB);
+    size_t ratio = (mi.zram_compr_bytes != 0) ? mi.zram_stored_pages * PGSIZE_KB * 1024 * 100 / mi.zram_compr_bytes : 0;
+    size_t lookups = mi.zram_hits + mi.zram_misses;
+    printf("Zram: %8dK pool, %8d pages stored, ratio %d.%02d, hits %d/%d, %d written back\n",
+           mi.zram_pool_pages * PGSIZE_KB, mi.zram_stored_pages, ratio / 100, ratio % 100,
+           mi.zram_hits, lookups, mi.zram_writebacks);
+    printf("Text: %8dK cached, hits %d/%d\n", mi.text_cached_pages * PGSIZE_KB,
+           mi.text_hits, mi.text_hits + mi.text_misses);
+}
+
+static void
+show_procs(void) {
+    struct procinfo pi;
+    int pid = 0;
+    printf("  PID  PPID S  RUNS   SYSC     RSS    SWAP  MINFLT  MAJFLT   COPY  PT  LIMIT NAME\n");
+    while ((pid = procinfo(pid, &pi)) >= 0) {
+        printf("%5d %5d %c %5d %6d %6dK %6dK %7d %7d %6d %3d ", pi.pid, pi.ppid, statechar(&pi), pi.runs,
+               pi.syscalls, pi.rss * PGSIZE_KB, pi.swap * PGSIZE_KB, pi.minflt, pi.majflt, pi.copies, pi.ptpages);
+        if (pi.mem_limit != 0) {
+            printf("%5dK ", pi.mem_limit * PGSIZE_KB);
+        }
+        else {
+            printf("     - ");
+        }
+        printf("%s\n", pi.name);
+        pid ++;
+    }
+}
+
+int
+main(int argc, char **argv) {
+    int i, n = 1;
+    if (argc > 2) {
+        printf("usage: top [iterations]\n");
+        return -1;
+    }
+    if (argc == 2 && (n = strtol(argv[1], NULL, 10)) <= 0) {
+        n = 1;
+    }
+    for (i = 0; i < n; i ++) {
+        if (i != 0) {
+            sleep(INTERVAL);
+            printf("\n");
+        }
+        show_meminfo();
+        show_procs();
+    }
+    return 0;
+}
+
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <ulib.h>
+#include <string.h>
+#include <error.h>
+#include <unistd.h>
+#include <file.h>
+#include <dirent.h>
+#include <x86.h>
+#include <liburing.h>
+
+#define NREADS          256
+#define BATCH           URING_ENTRIES
+#define NRESULTS        4               // the user_data of the other entries, the reads come after
+
+/* *
+ * uringtest - open a file and the directory, read the file a byte at a time
+ * and list the directory through the ring, without and with a worker, and
+ * compare with what read gives and what it costs.
+ * */
+
+static struct uring_queue queue;
+static char buf[NREADS], expect[NREADS];
+static int results[NRESULTS];
+
+// complete - take n completions, none may fail, keep the results of the entries that are not reads
+static void
+complete(struct uring_queue *q, int n) {
+    struct uring_cqe *cqe;
+    while (n -- > 0) {
+        assert(uring_wait_cqe(q, &cqe) == 0);
+        assert(cqe->res >= 0);
+        if (cqe->user_data < NRESULTS) {
+            results[cqe->user_data] = cqe->res;
+        }
+        else {
+            assert(cqe->res == 1);
+        }
+        uring_cqe_seen(q);
+    }
+}
+
+static void
+run(uint32_t flags, const char *name) {
+    struct uring_queue *q = &queue;
+    struct dirent dirent;
+    uint64_t start, cycles;
+    int fd, dirfd, i, n, done;
+
+    assert(uring_queue_init(q, flags) == 0);
+    assert(uring_queue_init(q, flags) == -E_BUSY);
+
+    // the two opens in one system call
+    uring_prep_open(uring_get_sqe(q), "uringtest", O_RDONLY, 0);
+    uring_prep_open(uring_get_sqe(q), ".", O_RDONLY, 1);
+    uring_prep_nop(uring_get_sqe(q), 2);
+    assert(uring_submit_and_wait(q, 3) == 3);
+    complete(q, 3);
+    fd = results[0], dirfd = results[1];
+
+    memset(buf, 0, sizeof(buf));
+    start = rdtsc();
+    for (done = 0; done < NREADS; done += n) {
+        n = (NREADS - done < BATCH) ? NREADS - done : BATCH;
+        for (i = 0; i < n; i ++) {
+            uring_prep_read(uring_get_sqe(q), fd, buf + done + i, 1, NRESULTS + done + i);
+        }
+        assert(uring_submit_and_wait(q, n) == n);
+        complete(q, n);
+    }
+    cycles = rdtsc() - start;
+    assert(memcmp(buf, expect, NREADS) == 0);
+
+    memset(&dirent, 0, sizeof(dirent));
+    uring_prep_getdirentry(uring_get_sqe(q), dirfd, &dirent, 0);
+    uring_prep_close(uring_get_sqe(q), fd, 1);
+    uring_prep_close(uring_get_sqe(q), dirfd, 2);
+    assert(uring_submit_and_wait(q, 3) == 3);
+    complete(q, 3);
+    assert(results[0] == 0 && results[1] == 0 && results[2] == 0);
+    assert(dirent.name[0] != '\0');
+
+    do_div(cycles, NREADS);
+    cprintf("uringtest: %s, %d cycles a read.\n", name, (uint32_t)cycles);
+}
+
+int
+main(void) {
+    uint64_t start, cycles;
+    int fd, i, pid, code;
+
+    assert((fd = open("uringtest", O_RDONLY)) >= 0);
+    start = rdtsc();
+    for (i = 0; i < NREADS; i ++) {
+        assert(read(fd, expect + i, 1) == 1);
+    }
+    cycles = rdtsc() - start;
+    close(fd);
+    do_div(cycles, NREADS);
+    cprintf("uringtest: read, %d cycles a read.\n", (uint32_t)cycles);
+
+    run(0, "ring");
+
+    // one ring per process, the worker gets a child of its own
+    if ((pid = fork()) == 0) {
+        run(URING_SETUP_WORKER, "ring with a worker");
+        exit(0);
+    }
+    assert(pid > 0 && waitpid(pid, &code) == 0 && code == 0);
+
+    cprintf("uringtest pass.\n");
+    return 0;
+}
+
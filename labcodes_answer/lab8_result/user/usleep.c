@@ -0,0 +1,23 @@
+#include <stdio.h>
+#include <ulib.h>
+
+#define ROUNDS      100
+#define USECS       500
+
+/* *
+ * usleep - the timers are not bound to the ticks of the scheduler: ROUNDS
+ * sleeps of USECS take about ROUNDS * USECS, not ROUNDS ticks.
+ * */
+int
+main(void) {
+    unsigned int start = gettime_msec(), time;
+    int i;
+    for (i = 0; i < ROUNDS; i ++) {
+        assert(usleep(USECS) == 0);
+    }
+    time = gettime_msec() - start;
+    cprintf("usleep: %d x %d usecs in %d ticks.\n", ROUNDS, USECS, time);
+    assert(time < ROUNDS / 2);
+    cprintf("usleep pass.\n");
+    return 0;
+}